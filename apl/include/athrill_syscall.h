@@ -28,6 +28,10 @@ struct sys_sockaddr_in {
     sys_uint32 sin_addr;
     sys_int8   sin_zero[8];
 };
+#define ATHRILL_SYSCALL_SOCKET_DOMAIN_AF_INET   0
+#define ATHRILL_SYSCALL_SOCKET_TYPE_STREAM   0
+#define ATHRILL_SYSCALL_SOCKET_TYPE_DGRAM    1
+#define ATHRILL_SYSCALL_SOCKET_PROTOCOL_ZERO   0
 struct api_arg_socket {
     sys_int32 domain;
     sys_int32 type;
@@ -84,6 +88,40 @@ struct api_arg_shutdown {
     sys_int32 sockfd;
     sys_int32 how;
 };
+/*
+ * sockaddr is in network byte order as bind/connect.
+ */
+struct api_arg_sendto {
+    sys_int32 sockfd;
+    sys_addr buf;
+    sys_uint32 len;
+    sys_int32 flags;
+    sys_addr sockaddr;
+};
+struct api_arg_recvfrom {
+    sys_int32 sockfd;
+    sys_addr buf;
+    sys_uint32 len;
+    sys_int32 flags;
+    sys_addr sockaddr;  /* output: 0 if not needed */
+};
+/*
+ * batched datagrams: msgvec is an array of struct sys_mmsghdr.
+ * ret_value is number of messages sent/received.
+ */
+struct sys_mmsghdr {
+    sys_addr buf;
+    sys_uint32 len;
+    sys_addr sockaddr;  /* sendmmsg: destination(0: connected), recvmmsg: output(0 if not needed) */
+    sys_uint32 msg_len; /* output: bytes sent/received */
+};
+#define SYS_MMSG_VLEN_MAX   64
+struct api_arg_mmsg {
+    sys_int32 sockfd;
+    sys_addr msgvec;
+    sys_uint32 vlen;
+    sys_int32 flags;
+};
 struct api_arg_system {
     sys_uint32 id;
 };
@@ -177,6 +215,63 @@ struct api_arg_exit {
 	sys_int32 status;
 };
 
+/*
+ * syscall rings: submission queue(SQ) and completion queue(CQ) on guest memory.
+ *
+ * guest puts entries on SQ and advances sq_tail, host consumes them and advances sq_head.
+ * host puts entries on CQ and advances cq_tail, guest consumes them and advances cq_head.
+ * entry num of each queue must be power of 2(mask = num - 1).
+ * SQ entry refers AthrillSyscallArgType, which is handled same as athrill_syscall().
+ * entry num and entry arrays are fixed on SYS_API_ID_RING_SETUP: only heads and tails
+ * may be changed after setup.
+ * SQ is drained on SYS_API_ID_RING_ENTER. when SYS_RING_FLAG_SQPOLL is set, it is also
+ * drained on the next device clock after guest writes the ring header(sq_tail or cq_head).
+ * intno is raised after a batch is completed(0: no interrupt).
+ */
+#define SYS_RING_FLAG_SQPOLL    0x00000001
+typedef struct {
+    sys_uint32 user_data;
+    sys_addr   argp;
+} AthrillSyscallRingSqEntryType;
+
+typedef struct {
+    sys_uint32 user_data;
+    sys_int32  ret_value;
+    sys_int32  ret_errno;
+} AthrillSyscallRingCqEntryType;
+
+typedef struct {
+    sys_uint32 sq_head;
+    sys_uint32 sq_tail;
+    sys_uint32 sq_mask;
+    sys_addr   sq_entries;
+    sys_uint32 cq_head;
+    sys_uint32 cq_tail;
+    sys_uint32 cq_mask;
+    sys_addr   cq_entries;
+} AthrillSyscallRingType;
+
+struct api_arg_ring_setup {
+    sys_addr   ring;    /* 0: unregister */
+    sys_uint32 flags;
+    sys_uint32 intno;
+};
+
+/*
+ * socket readiness bitmaps.
+ *
+ * host sets the bit of readfds/writefds when the socket becomes readable/writable,
+ * and raises intno(0: no interrupt).
+ * the bit is cleared when recv/accept(readfds) or send(writefds) returns SYS_API_ERR_AGAIN,
+ * so guest must call them until SYS_API_ERR_AGAIN before waiting for the next interrupt.
+ * bitmaps are written by host only.
+ */
+struct api_arg_epoll_setup {
+    sys_addr   readfds;
+    sys_addr   writefds;
+    sys_uint32 intno;
+};
+
 typedef enum {
     SYS_API_ID_NONE = 0,
     SYS_API_ID_SOCKET,
@@ -206,6 +301,13 @@ typedef enum {
     SYS_API_ID_EV3_CLOSEDIR,
     SYS_API_ID_EV3_SERIAL_OPEN,
 	SYS_API_ID_EXIT,
+    SYS_API_ID_RING_SETUP,
+    SYS_API_ID_RING_ENTER,
+    SYS_API_ID_EPOLL_SETUP,
+    SYS_API_ID_SENDTO,
+    SYS_API_ID_RECVFROM,
+    SYS_API_ID_SENDMMSG,
+    SYS_API_ID_RECVMMSG,
     SYS_API_ID_NUM,
 } AthrillSyscallApiIdType;
 
@@ -254,6 +356,11 @@ typedef struct {
         struct api_arg_ev3_closedir api_ev3_closedir;
         struct api_arg_ev3_serial_open api_ev3_serial_open;
         struct api_arg_exit api_exit;
+        struct api_arg_ring_setup api_ring_setup;
+        struct api_arg_epoll_setup api_epoll_setup;
+        struct api_arg_sendto api_sendto;
+        struct api_arg_recvfrom api_recvfrom;
+        struct api_arg_mmsg api_mmsg;
     } body;
 } AthrillSyscallArgType;
 
@@ -327,6 +434,14 @@ static inline int athrill_syscall_open_r_flag(int inf_flags)
 #include <errno.h>
 extern sys_addr athrill_device_func_call __attribute__ ((section(".athrill_device_section")));
 
+/*
+ * doorbell registers of athrill device.
+ * define ATHRILL_DEVICE_DOORBELL_ADDR as DEVICE_CONFIG_ATHRILL_DOORBELL_ADDR of device config
+ * to call syscalls by the doorbell instead of athrill_device_func_call.
+ */
+#define ATHRILL_DEVICE_DOORBELL_FUNC_CALL_OFF			0x0U
+#define ATHRILL_DEVICE_DOORBELL_RAISE_INTERRUPT_OFF		0x4U
+
 
 #if 0
 /* compiler optimization changes the order of putting the values in valiables.
@@ -345,9 +460,6 @@ extern void athrill_syscall(AthrillSyscallArgType *param);
 #define volatile
 #endif
 
-#define ATHRILL_SYSCALL_SOCKET_DOMAIN_AF_INET   0
-#define ATHRILL_SYSCALL_SOCKET_TYPE_STREAM   0
-#define ATHRILL_SYSCALL_SOCKET_PROTOCOL_ZERO   0
 static inline sys_int32 athrill_posix_socket(sys_int32 domain, sys_int32 type, sys_int32 protocol)
 {
     volatile AthrillSyscallArgType args;
@@ -494,6 +606,68 @@ static inline sys_uint32 athrill_posix_recv(sys_int32 sockfd, sys_addr buf, sys_
 }
 
 #define ATHRILL_POSIX_SHUT_RDWR 0
+static inline sys_int32 athrill_posix_sendto(sys_int32 sockfd, const sys_addr buf, sys_uint32 len, sys_int32 flags, const struct sys_sockaddr_in *addr)
+{
+    volatile AthrillSyscallArgType args;
+
+    args.api_id = SYS_API_ID_SENDTO;
+    args.ret_value = SYS_API_ERR_INVAL;
+    args.body.api_sendto.sockfd = sockfd;
+    args.body.api_sendto.buf = buf;
+    args.body.api_sendto.len = len;
+    args.body.api_sendto.flags = flags;
+    args.body.api_sendto.sockaddr = (sys_addr)addr;
+
+    ATHRILL_SYSCALL(&args);
+
+    return args.ret_value;
+}
+static inline sys_int32 athrill_posix_recvfrom(sys_int32 sockfd, sys_addr buf, sys_uint32 len, sys_int32 flags, struct sys_sockaddr_in *addr)
+{
+    volatile AthrillSyscallArgType args;
+
+    args.api_id = SYS_API_ID_RECVFROM;
+    args.ret_value = SYS_API_ERR_INVAL;
+    args.body.api_recvfrom.sockfd = sockfd;
+    args.body.api_recvfrom.buf = buf;
+    args.body.api_recvfrom.len = len;
+    args.body.api_recvfrom.flags = flags;
+    args.body.api_recvfrom.sockaddr = (sys_addr)addr;
+
+    ATHRILL_SYSCALL(&args);
+
+    return args.ret_value;
+}
+static inline sys_int32 athrill_posix_sendmmsg(sys_int32 sockfd, struct sys_mmsghdr *msgvec, sys_uint32 vlen, sys_int32 flags)
+{
+    volatile AthrillSyscallArgType args;
+
+    args.api_id = SYS_API_ID_SENDMMSG;
+    args.ret_value = SYS_API_ERR_INVAL;
+    args.body.api_mmsg.sockfd = sockfd;
+    args.body.api_mmsg.msgvec = (sys_addr)msgvec;
+    args.body.api_mmsg.vlen = vlen;
+    args.body.api_mmsg.flags = flags;
+
+    ATHRILL_SYSCALL(&args);
+
+    return args.ret_value;
+}
+static inline sys_int32 athrill_posix_recvmmsg(sys_int32 sockfd, struct sys_mmsghdr *msgvec, sys_uint32 vlen, sys_int32 flags)
+{
+    volatile AthrillSyscallArgType args;
+
+    args.api_id = SYS_API_ID_RECVMMSG;
+    args.ret_value = SYS_API_ERR_INVAL;
+    args.body.api_mmsg.sockfd = sockfd;
+    args.body.api_mmsg.msgvec = (sys_addr)msgvec;
+    args.body.api_mmsg.vlen = vlen;
+    args.body.api_mmsg.flags = flags;
+
+    ATHRILL_SYSCALL(&args);
+
+    return args.ret_value;
+}
 static inline sys_int32 athrill_posix_shutdown(sys_int32 sockfd, sys_int32 how)
 {
     volatile AthrillSyscallArgType args;
@@ -736,6 +910,84 @@ static inline sys_int32 athrill_posix_exit(sys_int32 status)
     return args.ret_value;
 }
 
+static inline sys_int32 athrill_ring_setup(AthrillSyscallRingType *ring, sys_uint32 flags, sys_uint32 intno)
+{
+    volatile AthrillSyscallArgType args;
+    args.api_id = SYS_API_ID_RING_SETUP;
+    args.ret_value = SYS_API_ERR_INVAL;
+    args.body.api_ring_setup.ring = (sys_addr)ring;
+    args.body.api_ring_setup.flags = flags;
+    args.body.api_ring_setup.intno = intno;
+
+    ATHRILL_SYSCALL(&args);
+
+    return args.ret_value;
+}
+
+static inline sys_int32 athrill_epoll_setup(sys_fd_set *readfds, sys_fd_set *writefds, sys_uint32 intno)
+{
+    volatile AthrillSyscallArgType args;
+    args.api_id = SYS_API_ID_EPOLL_SETUP;
+    args.ret_value = SYS_API_ERR_INVAL;
+    args.body.api_epoll_setup.readfds = (sys_addr)readfds;
+    args.body.api_epoll_setup.writefds = (sys_addr)writefds;
+    args.body.api_epoll_setup.intno = intno;
+
+    ATHRILL_SYSCALL(&args);
+
+    return args.ret_value;
+}
+
+/*
+ * returns number of completed entries.
+ */
+static inline sys_int32 athrill_ring_enter(void)
+{
+    volatile AthrillSyscallArgType args;
+    args.api_id = SYS_API_ID_RING_ENTER;
+    args.ret_value = SYS_API_ERR_INVAL;
+
+    ATHRILL_SYSCALL(&args);
+
+    return args.ret_value;
+}
+
+/*
+ * returns SYS_API_ERR_AGAIN when SQ is full.
+ * args must be kept until the completion is reaped.
+ */
+static inline sys_int32 athrill_ring_submit(AthrillSyscallRingType *ring, AthrillSyscallArgType *args, sys_uint32 user_data)
+{
+    volatile AthrillSyscallRingType *r = ring;
+    AthrillSyscallRingSqEntryType *sqe;
+    sys_uint32 tail = r->sq_tail;
+
+    if ((tail - r->sq_head) > r->sq_mask) {
+        return SYS_API_ERR_AGAIN;
+    }
+    sqe = &((AthrillSyscallRingSqEntryType *)r->sq_entries)[tail & r->sq_mask];
+    sqe->user_data = user_data;
+    sqe->argp = (sys_addr)args;
+    r->sq_tail = tail + 1;
+    return SYS_API_ERR_OK;
+}
+
+/*
+ * returns SYS_API_ERR_AGAIN when CQ is empty.
+ */
+static inline sys_int32 athrill_ring_reap(AthrillSyscallRingType *ring, AthrillSyscallRingCqEntryType *cqe)
+{
+    volatile AthrillSyscallRingType *r = ring;
+    sys_uint32 head = r->cq_head;
+
+    if (head == r->cq_tail) {
+        return SYS_API_ERR_AGAIN;
+    }
+    *cqe = ((AthrillSyscallRingCqEntryType *)r->cq_entries)[head & r->cq_mask];
+    r->cq_head = head + 1;
+    return SYS_API_ERR_OK;
+}
+
 #endif /* ATHRILL_SYSCALL_DEVICE */
 
 #endif /* _ATHRILL_SYSCALL_H_ */
@@ -2,5 +2,9 @@
 
 void athrill_syscall(AthrillSyscallArgType *param)
 {
+#ifdef ATHRILL_DEVICE_DOORBELL_ADDR
+	*((sys_addr*)(ATHRILL_DEVICE_DOORBELL_ADDR + ATHRILL_DEVICE_DOORBELL_FUNC_CALL_OFF)) = (sys_addr)(param);
+#else
 	athrill_device_func_call = (sys_addr)(param);
+#endif /* ATHRILL_DEVICE_DOORBELL_ADDR */
 }
@@ -0,0 +1,15 @@
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include "std_types.h"
+#include <time.h>
+
+static inline double bench_now(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((double)ts.tv_sec) + (((double)ts.tv_nsec) * 1e-9);
+}
+
+#endif /* _BENCH_H_ */
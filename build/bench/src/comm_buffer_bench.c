@@ -0,0 +1,104 @@
+#include "comm_buffer.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+/*
+ * comm_fifo_buffer throughput.
+ *
+ * one producer and one consumer thread move bytes through the fifo with fixed chunk size.
+ * small chunks show the cost per call, large chunks the cost of copies.
+ *
+ * usage: comm_buffer_bench [bytes] [fifo_size]
+ */
+#define COMM_BUFFER_BENCH_CHUNK_MAX		65536U
+
+typedef struct {
+	CommFifoBufferType	fifo;
+	uint64				bytes;
+	uint32				chunk;
+} CommBufferBenchType;
+
+static void *comm_buffer_bench_producer(void *arg)
+{
+	CommBufferBenchType *bench = (CommBufferBenchType *)arg;
+	static char buf[COMM_BUFFER_BENCH_CHUNK_MAX];
+	uint64 done = 0U;
+	uint32 len;
+	uint32 res;
+
+	memset(buf, 'a', sizeof(buf));
+	while (done < bench->bytes) {
+		len = bench->chunk;
+		if (len > (bench->bytes - done)) {
+			len = (uint32)(bench->bytes - done);
+		}
+		res = 0U;
+		(void)comm_fifo_buffer_add(&bench->fifo, buf, len, &res);
+		if (res == 0U) {
+			sched_yield();
+		}
+		done += res;
+	}
+	return NULL;
+}
+
+static void comm_buffer_bench_run(uint32 size, uint32 chunk, uint64 bytes)
+{
+	CommBufferBenchType bench;
+	static char buf[COMM_BUFFER_BENCH_CHUNK_MAX];
+	pthread_t producer;
+	uint64 done = 0U;
+	uint32 res;
+	double t0;
+	double t1;
+
+	if (comm_fifo_buffer_create(size, &bench.fifo) != STD_E_OK) {
+		printf("ERROR: can not create fifo size=%u\n", size);
+		exit(1);
+	}
+	bench.bytes = bytes;
+	bench.chunk = chunk;
+	t0 = bench_now();
+	(void)pthread_create(&producer, NULL, comm_buffer_bench_producer, &bench);
+	while (done < bytes) {
+		res = 0U;
+		(void)comm_fifo_buffer_get(&bench.fifo, buf, chunk, &res);
+		if (res == 0U) {
+			sched_yield();
+		}
+		done += res;
+	}
+	t1 = bench_now();
+	(void)pthread_join(producer, NULL);
+	printf("%8u %8u %10.1f\n", size, chunk, ((double)bytes) / (t1 - t0) / 1e6);
+	comm_fifo_buffer_destroy(&bench.fifo);
+	return;
+}
+
+int main(int argc, char **argv)
+{
+	static const uint32 chunks[] = { 1U, 16U, 256U, 4096U, 65536U };
+	uint64 bytes = 256ULL * 1024ULL * 1024ULL;
+	uint32 size = 65536U;
+	uint32 i;
+
+	if (argc > 1) {
+		bytes = strtoull(argv[1], NULL, 0);
+	}
+	if (argc > 2) {
+		size = (uint32)strtoul(argv[2], NULL, 0);
+	}
+	printf("bytes=%llu\n", (unsigned long long)bytes);
+	printf("%8s %8s %10s\n", "size", "chunk", "MB/s");
+	for (i = 0; i < (sizeof(chunks) / sizeof(chunks[0])); i++) {
+		/*
+		 * one byte chunks are slow: fewer bytes.
+		 */
+		comm_buffer_bench_run(size, chunks[i], (chunks[i] < 16U) ? (bytes / 16U) : bytes);
+	}
+	return 0;
+}
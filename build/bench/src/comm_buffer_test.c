@@ -0,0 +1,128 @@
+#include "comm_buffer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+/*
+ * comm_fifo_buffer stress test.
+ *
+ * one producer and one consumer thread move a byte sequence through the fifo
+ * without lock, with random chunk sizes(1..COMM_BUFFER_TEST_CHUNK_MAX), and the consumer
+ * checks every byte. fifo sizes include small and odd sizes to wrap around often.
+ * consumer also uses peek/consume, and consumes only a part of peeked data.
+ *
+ * usage: comm_buffer_test [bytes]
+ */
+#define COMM_BUFFER_TEST_CHUNK_MAX		600U
+
+typedef struct {
+	CommFifoBufferType	fifo;
+	uint64				bytes;
+} CommBufferTestType;
+
+static inline char comm_buffer_test_data(uint64 seq)
+{
+	return (char)((seq * 7U) + (seq >> 8U));
+}
+
+static void *comm_buffer_test_producer(void *arg)
+{
+	CommBufferTestType *test = (CommBufferTestType *)arg;
+	char buf[COMM_BUFFER_TEST_CHUNK_MAX];
+	unsigned int seed = 1U;
+	uint64 seq = 0U;
+	uint32 len;
+	uint32 res;
+	uint32 i;
+
+	while (seq < test->bytes) {
+		len = (rand_r(&seed) % COMM_BUFFER_TEST_CHUNK_MAX) + 1U;
+		if (len > (test->bytes - seq)) {
+			len = (uint32)(test->bytes - seq);
+		}
+		for (i = 0; i < len; i++) {
+			buf[i] = comm_buffer_test_data(seq + i);
+		}
+		res = 0U;
+		(void)comm_fifo_buffer_add(&test->fifo, buf, len, &res);
+		if (res == 0U) {
+			sched_yield();
+		}
+		seq += res;
+	}
+	return NULL;
+}
+
+static uint64 comm_buffer_test_consumer(CommBufferTestType *test)
+{
+	char buf[COMM_BUFFER_TEST_CHUNK_MAX];
+	unsigned int seed = 2U;
+	uint64 seq = 0U;
+	uint64 errors = 0U;
+	uint32 len;
+	uint32 res;
+	uint32 i;
+
+	while (seq < test->bytes) {
+		len = (rand_r(&seed) % COMM_BUFFER_TEST_CHUNK_MAX) + 1U;
+		res = 0U;
+		if ((seq & 1U) == 0U) {
+			(void)comm_fifo_buffer_get(&test->fifo, buf, len, &res);
+		}
+		else {
+			(void)comm_fifo_buffer_peek(&test->fifo, buf, len, &res);
+			res = (res + 1U) / 2U;
+			comm_fifo_buffer_consume(&test->fifo, res);
+		}
+		for (i = 0; i < res; i++) {
+			if (buf[i] != comm_buffer_test_data(seq + i)) {
+				errors++;
+			}
+		}
+		if (res == 0U) {
+			sched_yield();
+		}
+		seq += res;
+	}
+	return errors;
+}
+
+static int comm_buffer_test_run(uint32 size, uint64 bytes)
+{
+	CommBufferTestType test;
+	pthread_t producer;
+	uint64 errors;
+
+	if (comm_fifo_buffer_create(size, &test.fifo) != STD_E_OK) {
+		printf("ERROR: can not create fifo size=%u\n", size);
+		return 1;
+	}
+	test.bytes = bytes;
+	(void)pthread_create(&producer, NULL, comm_buffer_test_producer, &test);
+	errors = comm_buffer_test_consumer(&test);
+	(void)pthread_join(producer, NULL);
+	if (test.fifo.count != 0U) {
+		errors++;
+	}
+	printf("size=%-6u bytes=%llu errors=%llu: %s\n", size, (unsigned long long)bytes,
+			(unsigned long long)errors, (errors == 0U) ? "OK" : "NG");
+	comm_fifo_buffer_destroy(&test.fifo);
+	return (errors == 0U) ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+	static const uint32 sizes[] = { 1U, 7U, 64U, 1000U, 4096U, 65536U };
+	uint64 bytes = 64ULL * 1024ULL * 1024ULL;
+	int ret = 0;
+	uint32 i;
+
+	if (argc > 1) {
+		bytes = strtoull(argv[1], NULL, 0);
+	}
+	for (i = 0; i < (sizeof(sizes) / sizeof(sizes[0])); i++) {
+		ret |= comm_buffer_test_run(sizes[i], (sizes[i] < 64U) ? (bytes / 64U) : bytes);
+	}
+	return ret;
+}
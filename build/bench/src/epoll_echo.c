@@ -0,0 +1,326 @@
+#include "epoll_echo.h"
+#include "athrill_device.h"
+#include "athrill_mpthread.h"
+#include "std_device_ops.h"
+#include "mpu_ops.h"
+#include "snapshot.h"
+#define ATHRILL_SYSCALL_DEVICE
+#include "athrill_syscall.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+/*
+ * guest thread works as cpu and devices of athrill:
+ * it ticks athrill_syscall_epoll_supply_clock() like device_supply_clock_athrill_device(),
+ * and handles only sockets whose bits are set on the guest bitmaps, like a guest
+ * which waits the interrupt. accept/recv/send clear the bits on EAGAIN as the syscall
+ * device does, so a lost edge stops the connection and the client times out.
+ * guest is idle(yields the host cpu) when no bits are set.
+ * guest bitmaps are plain memory of this file.
+ */
+#define EPOLL_ECHO_READFDS_ADDR		0x00001000U
+#define EPOLL_ECHO_WRITEFDS_ADDR	0x00002000U
+#define EPOLL_ECHO_INTNO			1U
+#define EPOLL_ECHO_BUF_SIZE			4096U
+
+typedef struct {
+	bool	is_used;
+	uint32	len;
+	uint32	off;
+	char	buf[EPOLL_ECHO_BUF_SIZE];
+} EpollEchoConnType;
+
+static sys_fd_set epoll_echo_readfds;
+static sys_fd_set epoll_echo_writefds;
+static EpollEchoConnType epoll_echo_conn[ATHRILL_FD_SETSIZE];
+static int epoll_echo_listen_fd = -1;
+static uint32 epoll_echo_conns = 0U;
+static uint64 epoll_echo_intr = 0U;
+static pthread_t epoll_echo_guest_thread;
+static volatile bool epoll_echo_stop_req = FALSE;
+
+/*
+ * environment of the epoll reactor
+ */
+Std_ReturnType mpu_get_pointer(CoreIdType core_id, uint32 addr, uint8 **data)
+{
+	if (addr == EPOLL_ECHO_READFDS_ADDR) {
+		*data = (uint8 *)&epoll_echo_readfds;
+		return STD_E_OK;
+	}
+	if (addr == EPOLL_ECHO_WRITEFDS_ADDR) {
+		*data = (uint8 *)&epoll_echo_writefds;
+		return STD_E_OK;
+	}
+	return STD_E_SEGV;
+}
+int intc_raise_intr(uint32 intno)
+{
+	__atomic_add_fetch(&epoll_echo_intr, 1U, __ATOMIC_RELAXED);
+	return 0;
+}
+Std_ReturnType snapshot_register_fork_child(SnapshotForkChildType func)
+{
+	return STD_E_OK;
+}
+
+/*
+ * guest: echo server.
+ */
+static inline bool epoll_echo_isset(const sys_fd_set *fds, int fd)
+{
+	return ((fds->fd_bits[fd / 8] & (1U << (fd % 8))) != 0U);
+}
+static void epoll_echo_close(int fd)
+{
+	athrill_syscall_epoll_remove(fd);
+	(void)close(fd);
+	epoll_echo_conn[fd].is_used = FALSE;
+	__atomic_sub_fetch(&epoll_echo_conns, 1U, __ATOMIC_RELEASE);
+	return;
+}
+static void epoll_echo_accept(void)
+{
+	int on = 1;
+	int fd;
+
+	while (TRUE) {
+		fd = accept(epoll_echo_listen_fd, NULL, NULL);
+		if (fd < 0) {
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+				athrill_syscall_epoll_clear(epoll_echo_listen_fd, FALSE);
+			}
+			else {
+				printf("ERROR: accept errno=%d\n", errno);
+			}
+			return;
+		}
+		if (fd >= ATHRILL_FD_SETSIZE) {
+			printf("ERROR: fd=%d exceeds ATHRILL_FD_SETSIZE\n", fd);
+			(void)close(fd);
+			continue;
+		}
+		(void)fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+		(void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+		epoll_echo_conn[fd].is_used = TRUE;
+		epoll_echo_conn[fd].len = 0U;
+		epoll_echo_conn[fd].off = 0U;
+		__atomic_add_fetch(&epoll_echo_conns, 1U, __ATOMIC_RELEASE);
+		athrill_syscall_epoll_add(fd);
+	}
+}
+/*
+ * returns TRUE when all pending data is sent.
+ */
+static bool epoll_echo_flush(int fd)
+{
+	EpollEchoConnType *conn = &epoll_echo_conn[fd];
+	ssize_t ret;
+
+	while (conn->off < conn->len) {
+		ret = send(fd, &conn->buf[conn->off], conn->len - conn->off, MSG_NOSIGNAL);
+		if (ret > 0) {
+			conn->off += (uint32)ret;
+		}
+		else if ((ret < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) {
+			athrill_syscall_epoll_clear(fd, TRUE);
+			return FALSE;
+		}
+		else {
+			epoll_echo_close(fd);
+			return FALSE;
+		}
+	}
+	conn->len = 0U;
+	conn->off = 0U;
+	return TRUE;
+}
+static void epoll_echo_recv(int fd)
+{
+	EpollEchoConnType *conn = &epoll_echo_conn[fd];
+	ssize_t ret;
+
+	while (TRUE) {
+		if ((conn->len > 0U) && (epoll_echo_flush(fd) == FALSE)) {
+			return;
+		}
+		ret = recv(fd, conn->buf, sizeof(conn->buf), 0);
+		if (ret > 0) {
+			conn->len = (uint32)ret;
+			conn->off = 0U;
+		}
+		else if ((ret < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) {
+			athrill_syscall_epoll_clear(fd, FALSE);
+			return;
+		}
+		else {
+			epoll_echo_close(fd);
+			return;
+		}
+	}
+}
+static void *epoll_echo_guest(void *arg)
+{
+	bool is_idle;
+	int fd;
+
+	while (epoll_echo_stop_req == FALSE) {
+		athrill_syscall_epoll_supply_clock();
+		is_idle = TRUE;
+		for (fd = 0; fd < ATHRILL_FD_SETSIZE; fd++) {
+			if ((epoll_echo_readfds.fd_bits[fd / 8] | epoll_echo_writefds.fd_bits[fd / 8]) == 0U) {
+				fd += 7;
+				continue;
+			}
+			if (fd == epoll_echo_listen_fd) {
+				if (epoll_echo_isset(&epoll_echo_readfds, fd)) {
+					epoll_echo_accept();
+					is_idle = FALSE;
+				}
+				continue;
+			}
+			if (epoll_echo_conn[fd].is_used == FALSE) {
+				continue;
+			}
+			if (epoll_echo_isset(&epoll_echo_writefds, fd) && (epoll_echo_conn[fd].len > 0U)) {
+				if (epoll_echo_flush(fd) == FALSE) {
+					continue;
+				}
+				is_idle = FALSE;
+			}
+			if (epoll_echo_isset(&epoll_echo_readfds, fd)) {
+				epoll_echo_recv(fd);
+				is_idle = FALSE;
+			}
+		}
+		if (is_idle == TRUE) {
+			sched_yield();
+		}
+	}
+	return NULL;
+}
+
+Std_ReturnType epoll_echo_start(uint16 *port)
+{
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+	int on = 1;
+
+	(void)mpthread_init();
+	epoll_echo_listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (epoll_echo_listen_fd < 0) {
+		printf("ERROR: socket errno=%d\n", errno);
+		return STD_E_INVALID;
+	}
+	(void)setsockopt(epoll_echo_listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+	if ((bind(epoll_echo_listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+			|| (listen(epoll_echo_listen_fd, 128) < 0)
+			|| (getsockname(epoll_echo_listen_fd, (struct sockaddr *)&addr, &addrlen) < 0)) {
+		printf("ERROR: listen errno=%d\n", errno);
+		return STD_E_INVALID;
+	}
+	athrill_syscall_epoll_add(epoll_echo_listen_fd);
+	if (athrill_syscall_epoll_setup(EPOLL_ECHO_READFDS_ADDR, EPOLL_ECHO_WRITEFDS_ADDR, EPOLL_ECHO_INTNO) != SYS_API_ERR_OK) {
+		printf("ERROR: athrill_syscall_epoll_setup\n");
+		return STD_E_INVALID;
+	}
+	*port = ntohs(addr.sin_port);
+	(void)pthread_create(&epoll_echo_guest_thread, NULL, epoll_echo_guest, NULL);
+	return STD_E_OK;
+}
+/*
+ * reactor thread is not stopped: caller exits after this.
+ */
+void epoll_echo_stop(void)
+{
+	epoll_echo_stop_req = TRUE;
+	(void)pthread_join(epoll_echo_guest_thread, NULL);
+	return;
+}
+uint32 epoll_echo_conn_num(void)
+{
+	return __atomic_load_n(&epoll_echo_conns, __ATOMIC_ACQUIRE);
+}
+uint64 epoll_echo_intr_count(void)
+{
+	return __atomic_load_n(&epoll_echo_intr, __ATOMIC_RELAXED);
+}
+
+/*
+ * host: clients
+ */
+int epoll_echo_connect(uint16 port, uint32 timeout_ms)
+{
+	struct sockaddr_in addr;
+	struct timeval tv;
+	int on = 1;
+	int fd;
+
+	fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		printf("ERROR: socket errno=%d\n", errno);
+		return -1;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(port);
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		printf("ERROR: connect errno=%d\n", errno);
+		(void)close(fd);
+		return -1;
+	}
+	tv.tv_sec = timeout_ms / 1000U;
+	tv.tv_usec = (timeout_ms % 1000U) * 1000U;
+	(void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	(void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+	return fd;
+}
+Std_ReturnType epoll_echo_send_all(int fd, const char *buf, uint32 len)
+{
+	uint32 done = 0U;
+	ssize_t ret;
+
+	while (done < len) {
+		ret = send(fd, &buf[done], len - done, MSG_NOSIGNAL);
+		if (ret <= 0) {
+			if ((ret < 0) && (errno == EINTR)) {
+				continue;
+			}
+			return STD_E_INVALID;
+		}
+		done += (uint32)ret;
+	}
+	return STD_E_OK;
+}
+Std_ReturnType epoll_echo_recv_all(int fd, char *buf, uint32 len)
+{
+	uint32 done = 0U;
+	ssize_t ret;
+
+	while (done < len) {
+		ret = recv(fd, &buf[done], len - done, 0);
+		if (ret <= 0) {
+			if ((ret < 0) && (errno == EINTR)) {
+				continue;
+			}
+			return ((ret < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) ? STD_E_TIMEOUT : STD_E_INVALID;
+		}
+		done += (uint32)ret;
+	}
+	return STD_E_OK;
+}
@@ -0,0 +1,23 @@
+#ifndef _EPOLL_ECHO_H_
+#define _EPOLL_ECHO_H_
+
+#include "std_types.h"
+#include "std_errno.h"
+
+/*
+ * loopback echo server on the epoll reactor of the syscall device(athrill_syscall_epoll.c).
+ * server runs on the guest thread, clients are host threads with blocking sockets.
+ */
+extern Std_ReturnType epoll_echo_start(uint16 *port);
+extern void epoll_echo_stop(void);
+extern uint32 epoll_echo_conn_num(void);
+extern uint64 epoll_echo_intr_count(void);
+
+/*
+ * clients: recv fails after timeout_ms, so a lost wakeup of the server is an error.
+ */
+extern int epoll_echo_connect(uint16 port, uint32 timeout_ms);
+extern Std_ReturnType epoll_echo_send_all(int fd, const char *buf, uint32 len);
+extern Std_ReturnType epoll_echo_recv_all(int fd, char *buf, uint32 len);
+
+#endif /* _EPOLL_ECHO_H_ */
@@ -0,0 +1,161 @@
+#include "epoll_echo.h"
+#include "target/target_os_api.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/*
+ * epoll reactor loopback echo benchmark.
+ *
+ * echo server runs on the guest thread(see epoll_echo.c), clients are host threads.
+ * - echo rtt: one client, one byte ping-pong.
+ * - throughput: 1, 4 and 16 clients, ping-pong of EPOLL_ECHO_BENCH_MSG_SIZE messages.
+ * interrupts are raised by athrill_syscall_epoll_supply_clock() when new bits are set.
+ *
+ * usage: epoll_echo_bench [echo_count] [messages]
+ */
+#define EPOLL_ECHO_BENCH_MSG_SIZE	4096U
+#define EPOLL_ECHO_BENCH_TIMEOUT	5000U
+
+typedef struct {
+	uint16		port;
+	uint32		messages;
+	uint32		errors;
+	pthread_t	thread;
+} EpollEchoBenchClientType;
+
+static void *epoll_echo_bench_client(void *arg)
+{
+	EpollEchoBenchClientType *client = (EpollEchoBenchClientType *)arg;
+	static __thread char buf[EPOLL_ECHO_BENCH_MSG_SIZE];
+	uint32 i;
+	int fd;
+
+	fd = epoll_echo_connect(client->port, EPOLL_ECHO_BENCH_TIMEOUT);
+	if (fd < 0) {
+		client->errors++;
+		return NULL;
+	}
+	memset(buf, 'a', sizeof(buf));
+	for (i = 0; i < client->messages; i++) {
+		if ((epoll_echo_send_all(fd, buf, sizeof(buf)) != STD_E_OK)
+				|| (epoll_echo_recv_all(fd, buf, sizeof(buf)) != STD_E_OK)) {
+			printf("ERROR: echo failed message=%u\n", i);
+			client->errors++;
+			break;
+		}
+	}
+	(void)close(fd);
+	return NULL;
+}
+static int epoll_echo_bench_cmp(const void *a, const void *b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+
+	return (x < y) ? -1 : (x > y);
+}
+
+static int epoll_echo_bench_rtt(uint16 port, uint32 echo_count)
+{
+	double *rtt;
+	double t0;
+	uint64 intr;
+	uint32 i;
+	char ch;
+	int fd;
+
+	rtt = calloc(echo_count + 1U, sizeof(double));
+	fd = epoll_echo_connect(port, EPOLL_ECHO_BENCH_TIMEOUT);
+	if ((rtt == NULL) || (fd < 0)) {
+		return 1;
+	}
+	intr = epoll_echo_intr_count();
+	for (i = 0; i < echo_count; i++) {
+		ch = 'x';
+		t0 = bench_now();
+		if ((epoll_echo_send_all(fd, &ch, 1U) != STD_E_OK) || (epoll_echo_recv_all(fd, &ch, 1U) != STD_E_OK)) {
+			printf("ERROR: echo failed count=%u\n", i);
+			return 1;
+		}
+		rtt[i] = (bench_now() - t0) * 1e6;
+	}
+	intr = epoll_echo_intr_count() - intr;
+	(void)close(fd);
+	if (echo_count > 0U) {
+		qsort(rtt, echo_count, sizeof(double), epoll_echo_bench_cmp);
+		printf("echo rtt: n=%u p50 %.1f us p99 %.1f us max %.1f us interrupts/echo %.2f\n",
+				echo_count, rtt[echo_count / 2U], rtt[(echo_count * 99U) / 100U], rtt[echo_count - 1U],
+				((double)intr) / ((double)echo_count));
+	}
+	free(rtt);
+	return 0;
+}
+
+static int epoll_echo_bench_throughput(uint16 port, uint32 clients, uint32 messages)
+{
+	EpollEchoBenchClientType *client;
+	uint32 errors = 0U;
+	uint64 total;
+	uint64 intr;
+	double t0;
+	double t1;
+	uint32 i;
+
+	client = calloc(clients, sizeof(EpollEchoBenchClientType));
+	if (client == NULL) {
+		return 1;
+	}
+	intr = epoll_echo_intr_count();
+	t0 = bench_now();
+	for (i = 0; i < clients; i++) {
+		client[i].port = port;
+		client[i].messages = messages;
+		(void)pthread_create(&client[i].thread, NULL, epoll_echo_bench_client, &client[i]);
+	}
+	for (i = 0; i < clients; i++) {
+		(void)pthread_join(client[i].thread, NULL);
+		errors += client[i].errors;
+	}
+	t1 = bench_now();
+	intr = epoll_echo_intr_count() - intr;
+	free(client);
+	if (errors > 0U) {
+		return 1;
+	}
+	total = ((uint64)clients) * messages;
+	printf("clients=%-3u throughput: %"FMT_UINT64" echoes %.3f s %.0f echoes/s %.2f MB/s interrupts/echo %.2f\n",
+			clients, total, t1 - t0, ((double)total) / (t1 - t0),
+			((double)(total * EPOLL_ECHO_BENCH_MSG_SIZE)) / (t1 - t0) / 1e6,
+			((double)intr) / ((double)total));
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	static const uint32 clients[] = { 1U, 4U, 16U };
+	uint32 echo_count = 20000U;
+	uint32 messages = 20000U;
+	uint16 port;
+	int ret;
+	uint32 i;
+
+	if (argc > 1) {
+		echo_count = (uint32)strtoul(argv[1], NULL, 0);
+	}
+	if (argc > 2) {
+		messages = (uint32)strtoul(argv[2], NULL, 0);
+	}
+	if (epoll_echo_start(&port) != STD_E_OK) {
+		return 1;
+	}
+	ret = epoll_echo_bench_rtt(port, echo_count);
+	for (i = 0; (ret == 0) && (i < (sizeof(clients) / sizeof(clients[0]))); i++) {
+		ret = epoll_echo_bench_throughput(port, clients[i], messages / clients[i]);
+	}
+	epoll_echo_stop();
+	return ret;
+}
@@ -0,0 +1,137 @@
+#include "epoll_echo.h"
+#include "target/target_os_api.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/*
+ * epoll reactor loopback echo test.
+ *
+ * EPOLL_ECHO_TEST_CLIENTS client threads connect to the echo server on the guest,
+ * send messages of random sizes(1..EPOLL_ECHO_TEST_MSG_MAX) and check every echoed byte.
+ * each client reconnects EPOLL_ECHO_TEST_ROUNDS times, so fd numbers are reused
+ * after remove/close. a lost edge or a stale bit stops the echo, and the client
+ * times out. all connections must be closed by the server after the clients.
+ *
+ * usage: epoll_echo_test [messages]
+ */
+#define EPOLL_ECHO_TEST_CLIENTS		16U
+#define EPOLL_ECHO_TEST_ROUNDS		4U
+#define EPOLL_ECHO_TEST_MSG_MAX		16384U
+#define EPOLL_ECHO_TEST_TIMEOUT		5000U
+
+typedef struct {
+	uint16		port;
+	uint32		id;
+	uint32		messages;
+	uint64		bytes;
+	uint32		errors;
+	pthread_t	thread;
+} EpollEchoTestClientType;
+
+static inline char epoll_echo_test_data(uint32 id, uint32 seq)
+{
+	return (char)((seq * 7U) + (seq >> 8U) + id);
+}
+
+static void *epoll_echo_test_client(void *arg)
+{
+	EpollEchoTestClientType *client = (EpollEchoTestClientType *)arg;
+	static __thread char sbuf[EPOLL_ECHO_TEST_MSG_MAX];
+	static __thread char rbuf[EPOLL_ECHO_TEST_MSG_MAX];
+	unsigned int seed = client->id + 1U;
+	Std_ReturnType err;
+	uint32 seq = 0U;
+	uint32 round;
+	uint32 len;
+	uint32 i;
+	uint32 j;
+	int fd;
+
+	for (round = 0; round < EPOLL_ECHO_TEST_ROUNDS; round++) {
+		fd = epoll_echo_connect(client->port, EPOLL_ECHO_TEST_TIMEOUT);
+		if (fd < 0) {
+			client->errors++;
+			return NULL;
+		}
+		for (i = 0; i < (client->messages / EPOLL_ECHO_TEST_ROUNDS); i++) {
+			len = (rand_r(&seed) % EPOLL_ECHO_TEST_MSG_MAX) + 1U;
+			for (j = 0; j < len; j++) {
+				sbuf[j] = epoll_echo_test_data(client->id, seq + j);
+			}
+			if (epoll_echo_send_all(fd, sbuf, len) != STD_E_OK) {
+				printf("ERROR: client=%u send failed\n", client->id);
+				client->errors++;
+				break;
+			}
+			err = epoll_echo_recv_all(fd, rbuf, len);
+			if (err != STD_E_OK) {
+				printf("ERROR: client=%u recv %s round=%u message=%u len=%u\n", client->id,
+						(err == STD_E_TIMEOUT) ? "timeout" : "failed", round, i, len);
+				client->errors++;
+				break;
+			}
+			for (j = 0; j < len; j++) {
+				if (rbuf[j] != sbuf[j]) {
+					printf("ERROR: client=%u data mismatch seq=%u\n", client->id, seq + j);
+					client->errors++;
+					break;
+				}
+			}
+			seq += len;
+			client->bytes += len;
+		}
+		(void)close(fd);
+		if (client->errors > 0U) {
+			break;
+		}
+	}
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	EpollEchoTestClientType client[EPOLL_ECHO_TEST_CLIENTS];
+	uint32 messages = 2000U;
+	uint64 bytes = 0U;
+	uint32 errors = 0U;
+	uint32 wait;
+	uint16 port;
+	uint32 i;
+
+	if (argc > 1) {
+		messages = (uint32)strtoul(argv[1], NULL, 0);
+	}
+	if (epoll_echo_start(&port) != STD_E_OK) {
+		return 1;
+	}
+	for (i = 0; i < EPOLL_ECHO_TEST_CLIENTS; i++) {
+		client[i].port = port;
+		client[i].id = i;
+		client[i].messages = messages;
+		client[i].bytes = 0U;
+		client[i].errors = 0U;
+		(void)pthread_create(&client[i].thread, NULL, epoll_echo_test_client, &client[i]);
+	}
+	for (i = 0; i < EPOLL_ECHO_TEST_CLIENTS; i++) {
+		(void)pthread_join(client[i].thread, NULL);
+		bytes += client[i].bytes;
+		errors += client[i].errors;
+	}
+	/*
+	 * server sees EOF of the last connections.
+	 */
+	for (wait = 0; (wait < EPOLL_ECHO_TEST_TIMEOUT) && (epoll_echo_conn_num() > 0U); wait++) {
+		(void)usleep(1000);
+	}
+	if (epoll_echo_conn_num() > 0U) {
+		printf("ERROR: %u connections are not closed by the server\n", epoll_echo_conn_num());
+		errors++;
+	}
+	epoll_echo_stop();
+	printf("clients=%u rounds=%u messages=%u bytes=%"FMT_UINT64" interrupts=%"FMT_UINT64" errors=%u: %s\n",
+			EPOLL_ECHO_TEST_CLIENTS, EPOLL_ECHO_TEST_ROUNDS, messages, bytes, epoll_echo_intr_count(),
+			errors, (errors == 0U) ? "OK" : "NG");
+	return (errors == 0U) ? 0 : 1;
+}
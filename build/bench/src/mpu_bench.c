@@ -0,0 +1,226 @@
+#include "cpu.h"
+#include "bus.h"
+#include "mpu.h"
+#include "mpu_ops.h"
+#include "mpu_malloc.h"
+#include "athrill_device.h"
+#include "snapshot.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * mpu load/store throughput.
+ *
+ * memory layout like loader.c builds:
+ * - dynamic regions: ROM, RAM and MPU_BENCH_MALLOC_NUM MALLOC units(allocated).
+ * - static regions: MPU_CONFIG_REGION_NUM RAM regions after them.
+ * search_region() scans dynamic regions first, so later MALLOC units and
+ * static regions cost more on linear search.
+ *
+ * modes:
+ * - linear: all pages are SLOWPATH, so every access is resolved by the linear
+ *           region search(search_region before page table, plus one table lookup).
+ * - page  : mpu_get/put_data32() resolve the region by the page table.
+ * - tlb   : bus_get/put_data32() hit the per core TLB, mpu on miss.
+ *
+ * usage: mpu_bench [accesses]
+ */
+#define MPU_BENCH_ROM_BASE		0x00000000U
+#define MPU_BENCH_ROM_SIZE		(1024U * 1024U)
+#define MPU_BENCH_RAM_BASE		0x00100000U
+#define MPU_BENCH_RAM_SIZE		(1024U * 1024U)
+#define MPU_BENCH_MALLOC_BASE	0x01000000U
+#define MPU_BENCH_MALLOC_SIZE	(MPU_MALLOC_REGION_UNIT_SIZE * 1024U)
+#define MPU_BENCH_MALLOC_NUM	64U
+#define MPU_BENCH_REGION_SIZE	0x10000U
+#define MPU_BENCH_REGION_BASE	0x10000000U
+
+typedef enum {
+	MpuBenchMode_LINEAR = 0,
+	MpuBenchMode_PAGE,
+	MpuBenchMode_TLB,
+	MpuBenchMode_NUM,
+} MpuBenchModeType;
+
+static const char *mpu_bench_mode_name[MpuBenchMode_NUM] = {
+	"linear",
+	"page",
+	"tlb",
+};
+
+typedef struct {
+	const char	*name;
+	uint32		start;
+	uint32		size;
+	bool		is_rom;
+} MpuBenchAreaType;
+
+static const MpuBenchAreaType mpu_bench_area[] = {
+	{ "rom", MPU_BENCH_ROM_BASE, MPU_BENCH_ROM_SIZE, TRUE },
+	{ "ram", MPU_BENCH_RAM_BASE, MPU_BENCH_RAM_SIZE, FALSE },
+	{ "malloc(all)", MPU_BENCH_MALLOC_BASE, (MPU_BENCH_MALLOC_SIZE * MPU_BENCH_MALLOC_NUM), FALSE },
+	{ "malloc(last)", (MPU_BENCH_MALLOC_BASE + (MPU_BENCH_MALLOC_SIZE * (MPU_BENCH_MALLOC_NUM - 1U))), MPU_BENCH_MALLOC_SIZE, FALSE },
+	{ "static(last)", (MPU_BENCH_REGION_BASE + (MPU_BENCH_REGION_SIZE * (MPU_CONFIG_REGION_NUM - 1U))), MPU_BENCH_REGION_SIZE, FALSE },
+};
+#define MPU_BENCH_AREA_NUM	(sizeof(mpu_bench_area) / sizeof(mpu_bench_area[0]))
+
+CpuType virtual_cpu;
+MpuAddressMapType mpu_address_map;
+
+void cpuemu_mt_exclusive_enter(void)
+{
+	return;
+}
+void cpuemu_mt_exclusive_leave(void)
+{
+	return;
+}
+void mpu_malloc_add_region(MpuAddressRegionType *region)
+{
+	return;
+}
+void device_add_athrill_exdev(void *devp, uint32 region_index)
+{
+	return;
+}
+void bus_access_set_log(CoreIdType core_id, BusAccessType type, uint32 size, uint32 access_addr, uint32 data)
+{
+	return;
+}
+Std_ReturnType snapshot_write(SnapshotStreamType *stream, const void *data, uint32 size)
+{
+	return STD_E_OK;
+}
+Std_ReturnType snapshot_read(SnapshotStreamType *stream, void *data, uint32 size)
+{
+	return STD_E_OK;
+}
+
+static void mpu_bench_setup(void)
+{
+	uint32 i;
+	MpuAddressRegionType *region;
+
+	(void)mpu_address_set_rom_ram(MpuAddressGetType_ROM, MPU_BENCH_ROM_BASE, MPU_BENCH_ROM_SIZE, NULL);
+	(void)mpu_address_set_rom_ram(MpuAddressGetType_RAM, MPU_BENCH_RAM_BASE, MPU_BENCH_RAM_SIZE, NULL);
+	for (i = 0; i < MPU_BENCH_MALLOC_NUM; i++) {
+		(void)mpu_address_set_rom_ram(MpuAddressGetType_MALLOC, MPU_BENCH_MALLOC_BASE + (i * MPU_BENCH_MALLOC_SIZE), MPU_BENCH_MALLOC_SIZE, NULL);
+	}
+	/*
+	 * all units are allocated by mpu_malloc_get_memory().
+	 */
+	for (i = 0; i < mpu_address_map.dynamic_map_num; i++) {
+		region = &mpu_address_map.dynamic_map[i];
+		if (region->is_malloc != FALSE) {
+			region->data = calloc(1, region->size);
+		}
+	}
+	for (i = 0; i < MPU_CONFIG_REGION_NUM; i++) {
+		region = &mpu_address_map.map[i];
+		region->type = GLOBAL_MEMORY;
+		region->permission = MPU_ADDRESS_REGION_PERM_ALL;
+		region->start = MPU_BENCH_REGION_BASE + (i * MPU_BENCH_REGION_SIZE);
+		region->size = MPU_BENCH_REGION_SIZE;
+		region->mask = MPU_ADDRESS_REGION_MASK_ALL;
+		region->data = calloc(1, MPU_BENCH_REGION_SIZE);
+		region->ops = &default_memory_operation;
+	}
+	return;
+}
+
+static void mpu_bench_set_mode(MpuBenchModeType mode)
+{
+	uint32 i;
+	uint32 addr;
+	MpuAddressPageEntryType *entry;
+
+	mpu_address_map_build();
+	if (mode != MpuBenchMode_LINEAR) {
+		return;
+	}
+	for (i = 0; i < MPU_BENCH_AREA_NUM; i++) {
+		for (addr = mpu_bench_area[i].start; addr < (mpu_bench_area[i].start + mpu_bench_area[i].size); addr += MPU_ADDRESS_PAGE_SIZE) {
+			entry = mpu_address_page_get(addr);
+			entry->state = MpuAddressPageState_SLOWPATH;
+			entry->region = NULL;
+			entry->host_base = NULL;
+		}
+	}
+	for (i = 0; i < CPU_CONFIG_CORE_NUM; i++) {
+		mpu_address_tlb_invalidate(i);
+	}
+	return;
+}
+
+static double mpu_bench_run(MpuBenchModeType mode, const MpuBenchAreaType *area, bool is_store, uint64 accesses)
+{
+	uint64 i;
+	uint32 addr;
+	uint32 data = 0U;
+	uint32 sum = 0U;
+	Std_ReturnType err;
+	double t0;
+	double t1;
+
+	t0 = bench_now();
+	for (i = 0; i < accesses; i++) {
+		addr = area->start + ((uint32)(i * 4U) % area->size);
+		if (is_store == FALSE) {
+			err = (mode == MpuBenchMode_TLB) ? bus_get_data32(0U, addr, &data) : mpu_get_data32(0U, addr, &data);
+			sum += data;
+		}
+		else {
+			err = (mode == MpuBenchMode_TLB) ? bus_put_data32(0U, addr, (uint32)i) : mpu_put_data32(0U, addr, (uint32)i);
+		}
+		if (err != STD_E_OK) {
+			printf("ERROR: access failed addr=0x%x\n", addr);
+			exit(1);
+		}
+	}
+	t1 = bench_now();
+	if (sum == 0xFFFFFFFFU) {
+		printf("sum=%u\n", sum);
+	}
+	return ((double)accesses) / (t1 - t0) / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+	uint64 accesses = 10000000ULL;
+	double result[MPU_BENCH_AREA_NUM][2][MpuBenchMode_NUM];
+	uint32 i;
+	uint32 is_store;
+	uint32 mode;
+
+	if (argc > 1) {
+		accesses = strtoull(argv[1], NULL, 0);
+	}
+	mpu_bench_setup();
+	printf("dynamic regions=%u static regions=%u accesses=%llu\n",
+			mpu_address_map.dynamic_map_num, MPU_CONFIG_REGION_NUM, (unsigned long long)accesses);
+	for (mode = 0; mode < MpuBenchMode_NUM; mode++) {
+		mpu_bench_set_mode((MpuBenchModeType)mode);
+		for (i = 0; i < MPU_BENCH_AREA_NUM; i++) {
+			for (is_store = 0; is_store < 2U; is_store++) {
+				if ((is_store != 0U) && (mpu_bench_area[i].is_rom == TRUE)) {
+					result[i][is_store][mode] = 0.0;
+					continue;
+				}
+				result[i][is_store][mode] = mpu_bench_run((MpuBenchModeType)mode, &mpu_bench_area[i], (is_store != 0U), accesses);
+			}
+		}
+	}
+	printf("%-14s %-6s %12s %12s %12s  (M accesses/s)\n", "area", "access",
+			mpu_bench_mode_name[MpuBenchMode_LINEAR], mpu_bench_mode_name[MpuBenchMode_PAGE], mpu_bench_mode_name[MpuBenchMode_TLB]);
+	for (i = 0; i < MPU_BENCH_AREA_NUM; i++) {
+		for (is_store = 0; is_store < 2U; is_store++) {
+			if ((is_store != 0U) && (mpu_bench_area[i].is_rom == TRUE)) {
+				continue;
+			}
+			printf("%-14s %-6s %12.1f %12.1f %12.1f\n", mpu_bench_area[i].name, (is_store != 0U) ? "store" : "load",
+					result[i][is_store][MpuBenchMode_LINEAR], result[i][is_store][MpuBenchMode_PAGE], result[i][is_store][MpuBenchMode_TLB]);
+		}
+	}
+	return 0;
+}
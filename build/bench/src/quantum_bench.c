@@ -0,0 +1,379 @@
+/*
+ * DEVICE_CONFIG_CLOCK_QUANTUM benchmark.
+ *
+ * runs the main loop of cpuemu.c(cpuemu_thread_run) on the benchmark target.
+ * cpu and devices are stubs, so the result is the cost of the main loop itself.
+ * - cpu: one instruction per clock. idle guest halts BUSY_CLOCKS after the timer interrupt.
+ * - timer: device event every TIMER_PERIOD clocks, wakes the core.
+ * - host interrupt: polled register which is set every HOST_INTR_PERIOD clocks,
+ *   and is seen on the next device tick(deadline is not known).
+ * lateness is device clocks between the due clock and the device tick which handles it.
+ *
+ * each run is a child process: cpuemu_thread_run() exits on the end clock.
+ *
+ * usage: quantum_bench [clocks]
+ */
+#include "bench.h"
+#include "cpu.h"
+#include "bus.h"
+#include "cpuemu_ops.h"
+#include "std_device_ops.h"
+#include "std_cpu_ops.h"
+#include "dbg_log.h"
+#include "cpu_control/dbg_cpu_control.h"
+#include "cpu_control/dbg_cpu_thread_control.h"
+#include "cpu_control/dbg_cpu_callback.h"
+#include "elf_section.h"
+#include "symbol_ops.h"
+#include "athrill_device.h"
+#include "device_event.h"
+#include "snapshot.h"
+#include "mpu_ops.h"
+#include "mpu_malloc.h"
+#include "target/target_os_api.h"
+#include "option/option.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define TIMER_PERIOD		10000ULL
+#define HOST_INTR_PERIOD	7919ULL
+#define BUSY_CLOCKS			1000ULL
+
+typedef struct {
+	uint64	count;
+	uint64	total;
+	uint64	max;
+} LatenessType;
+
+static DeviceClockType *dev_clock;
+static DeviceEventType timer_event;
+static LatenessType timer_late;
+static LatenessType host_late;
+static uint64 host_intr_next;
+static uint64 busy_end;
+static bool is_idle;
+static uint32 run_quantum;
+static int report_fd;
+static double start;
+
+CpuType virtual_cpu;
+
+/*
+ * stub cpu.
+ */
+void cpu_init(void)
+{
+	virtual_cpu.core_id_num = 1U;
+	virtual_cpu.current_core = &virtual_cpu.cores[0];
+	return;
+}
+Std_ReturnType cpu_supply_clock(CoreIdType core_id)
+{
+	TargetCoreType *core = &virtual_cpu.cores[core_id].core;
+
+	if (core->is_halt == TRUE) {
+		return STD_E_OK;
+	}
+	core->reg[1] = (core->reg[1] * 1103515245U) + 12345U;
+	core->pc += 2U;
+	if ((is_idle == TRUE) && (cpuemu_get_total_clocks() >= busy_end)) {
+		core->is_halt = TRUE;
+	}
+	return STD_E_OK;
+}
+void cpu_set_core_pc(CoreIdType core_id, uint32 pc)
+{
+	virtual_cpu.cores[core_id].core.pc = pc;
+	return;
+}
+uint32 cpu_get_return_addr(const TargetCoreType *core)
+{
+	return 0U;
+}
+bool cpu_illegal_access(CoreIdType core_id)
+{
+	return FALSE;
+}
+
+/*
+ * stub devices.
+ */
+static void lateness_add(LatenessType *late, uint64 due)
+{
+	uint64 value = dev_clock->clock - due;
+
+	late->count++;
+	late->total += value;
+	if (value > late->max) {
+		late->max = value;
+	}
+	return;
+}
+
+static void timer_handler(DeviceEventType *event, DeviceClockType *clock)
+{
+	lateness_add(&timer_late, event->clock);
+	busy_end = clock->clock + BUSY_CLOCKS;
+	virtual_cpu.cores[0].core.is_halt = FALSE;
+	(void)device_event_set(event, event->clock + TIMER_PERIOD);
+	return;
+}
+
+void device_init(CpuType *cpu, DeviceClockType *clock)
+{
+	dev_clock = clock;
+	device_event_init(&timer_event, timer_handler, NULL);
+	(void)device_event_set(&timer_event, TIMER_PERIOD);
+	host_intr_next = HOST_INTR_PERIOD;
+	busy_end = BUSY_CLOCKS;
+	return;
+}
+/*
+ * like device.c of targets: one clock is counted per device tick.
+ */
+void device_supply_clock(DeviceClockType *clock)
+{
+	clock->clock++;
+	while (host_intr_next <= clock->clock) {
+		lateness_add(&host_late, host_intr_next);
+		host_intr_next += HOST_INTR_PERIOD;
+	}
+	clock->min_intr_interval = timer_event.clock - clock->clock;
+	clock->can_skip_clock = TRUE;
+	return;
+}
+void device_init_athrill_device(void)
+{
+	return;
+}
+void device_supply_clock_athrill_device(void)
+{
+	return;
+}
+void athrill_device_set_mmap_info(AthrillDeviceMmapInfoType *info)
+{
+	return;
+}
+void athrill_system_helper_init(void)
+{
+	return;
+}
+int intc_raise_intr(uint32 intno)
+{
+	return 0;
+}
+
+/*
+ * stub debugger.
+ */
+void bus_access_set_log(CoreIdType core_id, BusAccessType type, uint32 size, uint32 access_addr, uint32 data)
+{
+	return;
+}
+void cpuctrl_init(void)
+{
+	return;
+}
+void cpuctrl_set_force_break(void)
+{
+	return;
+}
+void cputhr_control_init(void)
+{
+	return;
+}
+void cputhr_control_start(void *(*cpu_run) (void *))
+{
+	return;
+}
+void dbg_cpu_callback_start(uint32 pc, uint32 sp)
+{
+	return;
+}
+void dbg_cpu_callback_start_nodbg(uint32 pc, uint32 sp)
+{
+	return;
+}
+void dbg_cpu_debug_mode_set(uint32 core_id, bool dbg_mode)
+{
+	return;
+}
+void dbg_log_init(char *filepath)
+{
+	return;
+}
+void dbg_log_sync(void)
+{
+	return;
+}
+void dbg_notify_cpu_clock_supply_start(const TargetCoreType *core)
+{
+	return;
+}
+void dbg_notify_cpu_clock_supply_end(const TargetCoreType *core, const DbgCpuCallbackFuncEnableType *enable_dbg)
+{
+	return;
+}
+Std_ReturnType elfsym_get_symbol_num(uint32 *sym_num)
+{
+	*sym_num = 0U;
+	return STD_E_OK;
+}
+Std_ReturnType elfsym_get_symbol(uint32 index, ElfSymbolType *elfsym)
+{
+	return STD_E_NOENT;
+}
+int symbol_func_add(DbgSymbolType *sym)
+{
+	return -1;
+}
+int symbol_gl_add(DbgSymbolType *sym)
+{
+	return -1;
+}
+int symbol_get_func(char *funcname, uint32 func_len, uint32 *addrp, uint32 *size)
+{
+	return -1;
+}
+int symbol_get_gl(char *gl_name, uint32 gl_len, uint32 *addrp, uint32 *size)
+{
+	return -1;
+}
+
+/*
+ * stub memory and snapshot.
+ */
+const SnapshotOperationType mpu_address_snapshot_operation;
+const SnapshotOperationType mpu_malloc_snapshot_operation;
+
+Std_ReturnType mpu_get_pointer(CoreIdType core_id, uint32 addr, uint8 **data)
+{
+	return STD_E_SEGV;
+}
+void mpu_address_notify_host_write(uint32 addr, uint32 size)
+{
+	return;
+}
+Std_ReturnType snapshot_register(const char *name, const SnapshotOperationType *ops, void *arg)
+{
+	return STD_E_OK;
+}
+Std_ReturnType snapshot_write(SnapshotStreamType *stream, const void *data, uint32 size)
+{
+	return STD_E_INVALID;
+}
+Std_ReturnType snapshot_read(SnapshotStreamType *stream, void *data, uint32 size)
+{
+	return STD_E_INVALID;
+}
+Std_ReturnType snapshot_save(const char *path)
+{
+	return STD_E_INVALID;
+}
+Std_ReturnType snapshot_load(const char *path)
+{
+	return STD_E_INVALID;
+}
+void snapshot_fork_server(uint32 max_jobs)
+{
+	return;
+}
+
+/*
+ * called by exit() of cpuemu_thread_run() on the end clock.
+ */
+static void report(void)
+{
+	double sec = bench_now() - start;
+
+	dprintf(report_fd, "%5s %8u %10.1f %10"FMT_UINT64" %10.1f %10"FMT_UINT64"\n",
+			(is_idle == TRUE) ? "idle" : "busy",
+			run_quantum,
+			((double)dev_clock->clock) / sec / 1e6,
+			timer_late.max,
+			(host_late.count > 0U) ? (((double)host_late.total) / ((double)host_late.count)) : 0.0,
+			host_late.max);
+	return;
+}
+
+static void run(uint64 clocks, uint32 quantum, bool idle, const char *dir)
+{
+	static CmdOptionType opt;
+	char path[4096];
+	FILE *fp;
+	pid_t pid;
+	int status;
+
+	pid = fork();
+	if (pid < 0) {
+		printf("ERROR: can not fork\n");
+		exit(1);
+	}
+	if (pid > 0) {
+		(void)waitpid(pid, &status, 0);
+		return;
+	}
+	(void)snprintf(path, sizeof(path), "%s/device_config.txt", dir);
+	fp = fopen(path, "w");
+	if (fp == NULL) {
+		printf("ERROR: can not create %s\n", path);
+		exit(1);
+	}
+	fprintf(fp, "DEVICE_CONFIG_CLOCK_QUANTUM %u\n", quantum);
+	fprintf(fp, "DEBUG_FUNC_ENABLE_SKIP_CLOCK 1\n");
+	fclose(fp);
+	if (cpuemu_load_devcfg(path) != STD_E_OK) {
+		printf("ERROR: can not load %s\n", path);
+		exit(1);
+	}
+	(void)unlink(path);
+
+	/*
+	 * messages of cpuemu are not reported.
+	 */
+	fflush(stdout);
+	report_fd = dup(STDOUT_FILENO);
+	(void)freopen("/dev/null", "w", stdout);
+
+	memset(&opt, 0, sizeof(opt));
+	opt.core_id_num = 1;
+	is_idle = idle;
+	run_quantum = quantum;
+	cpuemu_init(NULL, &opt);
+	cpuemu_set_cpu_end_clock(clocks);
+	(void)atexit(report);
+	start = bench_now();
+	(void)cpuemu_thread_run(NULL);
+	exit(0);
+}
+
+int main(int argc, const char *argv[])
+{
+	static const uint32 quantum[] = { 1U, 4U, 16U, 64U, 256U, 1024U };
+	uint64 clocks = 20000000ULL;
+	char dir[] = "/tmp/quantum_bench.XXXXXX";
+	uint32 idle;
+	uint32 i;
+
+	if (argc > 1) {
+		clocks = strtoull(argv[1], NULL, 0);
+	}
+	if (mkdtemp(dir) == NULL) {
+		printf("ERROR: can not create work directory\n");
+		return 1;
+	}
+	printf("clocks=%"FMT_UINT64" timer_period=%"FMT_UINT64" host_intr_period=%"FMT_UINT64" busy_clocks=%"FMT_UINT64"\n",
+			clocks, (uint64)TIMER_PERIOD, (uint64)HOST_INTR_PERIOD, (uint64)BUSY_CLOCKS);
+	printf("%5s %8s %10s %10s %10s %10s\n", "guest", "quantum", "Mclocks/s", "timer_max", "host_avg", "host_max");
+	fflush(stdout);
+	for (idle = 0; idle < 2U; idle++) {
+		for (i = 0; i < (sizeof(quantum) / sizeof(quantum[0])); i++) {
+			run(clocks, quantum[i], (idle != 0U) ? TRUE : FALSE, dir);
+		}
+	}
+	(void)rmdir(dir);
+	return 0;
+}
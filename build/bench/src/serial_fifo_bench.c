@@ -0,0 +1,357 @@
+#include "cpu.h"
+#include "serial_fifo.h"
+#include "mpu_ops.h"
+#include "cpuemu_ops.h"
+#include "device_event.h"
+#include "snapshot.h"
+#include "bench.h"
+#include "target/target_os_api.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+/*
+ * serial fifo loopback benchmark.
+ *
+ * channel 0 uses the fifo backend: host writes RD_FIFO, and reads WR_FIFO.
+ * guest thread echoes rd data to wr by dma registers, and ticks the device
+ * with athrill_device_supply_clock_serial_fifo() like device_supply_clock().
+ * registers and the dma buffer are plain memory of this benchmark.
+ * - throughput: bytes echoed per second.
+ * - echo rtt: host write of one byte to host read of its echo.
+ *
+ * usage: serial_fifo_bench [bytes] [fifo_size] [echo_count]
+ */
+#define SERIAL_FIFO_BENCH_REG_ADDR		0x00001000U
+#define SERIAL_FIFO_BENCH_BUF_ADDR		0x00100000U
+#define SERIAL_FIFO_BENCH_BUF_SIZE		0x10000U
+#define SERIAL_FIFO_BENCH_HOST_LEN		65536U
+
+CpuType virtual_cpu;
+static uint8 serial_fifo_bench_reg[SERIAL_FIFO_REG_SIZE];
+static uint8 serial_fifo_bench_buf[SERIAL_FIFO_BENCH_BUF_SIZE];
+static MpuAddressWriteHookType serial_fifo_bench_hook;
+static DeviceClockType serial_fifo_bench_clock;
+static uint32 serial_fifo_bench_fifo_size = 8192U;
+static char serial_fifo_bench_rd_path[256];
+static char serial_fifo_bench_wr_path[256];
+static volatile bool serial_fifo_bench_stop = FALSE;
+
+/*
+ * environment of serial fifo device
+ */
+Std_ReturnType cpuemu_get_devcfg_value(const char* key, uint32 *value)
+{
+	if (strcmp(key, "DEVICE_CONFIG_SERIAL_FILFO_0_SIZE") == 0) {
+		*value = serial_fifo_bench_fifo_size;
+		return STD_E_OK;
+	}
+	if ((strcmp(key, "DEVICE_CONFIG_SERIAL_FILFO_0_DMA_ENABLE") == 0)
+			|| (strcmp(key, "DEVICE_CONFIG_SERIAL_FILFO_0_RD_INTNO") == 0)
+			|| (strcmp(key, "DEVICE_CONFIG_SERIAL_FILFO_0_WR_INTNO") == 0)
+			|| (strcmp(key, "DEVICE_CONFIG_SERIAL_FILFO_0_RD_INTOFF") == 0)
+			|| (strcmp(key, "DEVICE_CONFIG_SERIAL_FILFO_0_WR_INTOFF") == 0)) {
+		*value = 1U;
+		return STD_E_OK;
+	}
+	return STD_E_NOENT;
+}
+Std_ReturnType cpuemu_get_devcfg_value_hex(const char* key, uint32 *value)
+{
+	if (strcmp(key, "DEVICE_CONFIG_SERIAL_FILFO_BASE_ADDR") == 0) {
+		*value = SERIAL_FIFO_BENCH_REG_ADDR;
+		return STD_E_OK;
+	}
+	return STD_E_NOENT;
+}
+Std_ReturnType cpuemu_get_devcfg_string(const char* key, char **value)
+{
+	if (strcmp(key, "DEVICE_CONFIG_SERIAL_FILFO_0_RD_FIFO") == 0) {
+		*value = serial_fifo_bench_rd_path;
+		return STD_E_OK;
+	}
+	if (strcmp(key, "DEVICE_CONFIG_SERIAL_FILFO_0_WR_FIFO") == 0) {
+		*value = serial_fifo_bench_wr_path;
+		return STD_E_OK;
+	}
+	return STD_E_NOENT;
+}
+uint64 cpuemu_get_total_clocks(void)
+{
+	return serial_fifo_bench_clock.clock;
+}
+void device_raise_int(uint16 intno)
+{
+	return;
+}
+Std_ReturnType snapshot_register(const char *name, const SnapshotOperationType *ops, void *arg)
+{
+	return STD_E_OK;
+}
+Std_ReturnType snapshot_register_fork_child(SnapshotForkChildType func)
+{
+	return STD_E_OK;
+}
+Std_ReturnType snapshot_write(SnapshotStreamType *stream, const void *data, uint32 size)
+{
+	return STD_E_OK;
+}
+Std_ReturnType snapshot_read(SnapshotStreamType *stream, void *data, uint32 size)
+{
+	return STD_E_OK;
+}
+Std_ReturnType mpu_address_set_write_hook(uint32 addr, uint32 size, MpuAddressWriteHookType hook)
+{
+	serial_fifo_bench_hook = hook;
+	return STD_E_OK;
+}
+
+/*
+ * memory: registers and the dma buffer.
+ */
+static uint8 *serial_fifo_bench_reg_ptr(uint32 addr, uint32 size)
+{
+	if ((addr < SERIAL_FIFO_BENCH_REG_ADDR) || ((addr + size) > (SERIAL_FIFO_BENCH_REG_ADDR + SERIAL_FIFO_REG_SIZE))) {
+		printf("ERROR: register access addr=0x%x\n", addr);
+		exit(1);
+	}
+	return &serial_fifo_bench_reg[addr - SERIAL_FIFO_BENCH_REG_ADDR];
+}
+Std_ReturnType mpu_get_data8(CoreIdType core_id, uint32 addr, uint8 *data)
+{
+	*data = *serial_fifo_bench_reg_ptr(addr, 1U);
+	return STD_E_OK;
+}
+Std_ReturnType mpu_put_data8(CoreIdType core_id, uint32 addr, uint8 data)
+{
+	*serial_fifo_bench_reg_ptr(addr, 1U) = data;
+	return STD_E_OK;
+}
+Std_ReturnType mpu_get_data32(CoreIdType core_id, uint32 addr, uint32 *data)
+{
+	memcpy(data, serial_fifo_bench_reg_ptr(addr, 4U), 4U);
+	return STD_E_OK;
+}
+Std_ReturnType mpu_put_data32(CoreIdType core_id, uint32 addr, uint32 data)
+{
+	memcpy(serial_fifo_bench_reg_ptr(addr, 4U), &data, 4U);
+	return STD_E_OK;
+}
+Std_ReturnType mpu_get_pointer_range(CoreIdType core_id, uint32 addr, uint8 **data, uint32 *size)
+{
+	if ((addr < SERIAL_FIFO_BENCH_BUF_ADDR) || (addr >= (SERIAL_FIFO_BENCH_BUF_ADDR + SERIAL_FIFO_BENCH_BUF_SIZE))) {
+		return STD_E_SEGV;
+	}
+	*data = &serial_fifo_bench_buf[addr - SERIAL_FIFO_BENCH_BUF_ADDR];
+	*size = (SERIAL_FIFO_BENCH_BUF_ADDR + SERIAL_FIFO_BENCH_BUF_SIZE) - addr;
+	return STD_E_OK;
+}
+Std_ReturnType mpu_get_block(CoreIdType core_id, uint32 addr, uint8 *data, uint32 size)
+{
+	uint8 *ptr;
+	uint32 len;
+
+	if ((mpu_get_pointer_range(core_id, addr, &ptr, &len) != STD_E_OK) || (size > len)) {
+		return STD_E_SEGV;
+	}
+	memcpy(data, ptr, size);
+	return STD_E_OK;
+}
+Std_ReturnType mpu_put_block(CoreIdType core_id, uint32 addr, const uint8 *data, uint32 size)
+{
+	uint8 *ptr;
+	uint32 len;
+
+	if ((mpu_get_pointer_range(core_id, addr, &ptr, &len) != STD_E_OK) || (size > len)) {
+		return STD_E_SEGV;
+	}
+	memcpy(ptr, data, size);
+	return STD_E_OK;
+}
+
+/*
+ * guest: echo by dma.
+ */
+static void serial_fifo_bench_guest_write32(uint32 addr, uint32 data)
+{
+	(void)mpu_put_data32(0U, addr, data);
+	if (serial_fifo_bench_hook != NULL) {
+		serial_fifo_bench_hook(0U, addr);
+	}
+	return;
+}
+static void serial_fifo_bench_dma_start(uint32 dir, uint32 len)
+{
+	serial_fifo_bench_guest_write32(SERIAL_FIFO_DMA_ADDR_ADDR(SERIAL_FIFO_BENCH_REG_ADDR, 0U, dir), SERIAL_FIFO_BENCH_BUF_ADDR);
+	serial_fifo_bench_guest_write32(SERIAL_FIFO_DMA_LEN_ADDR(SERIAL_FIFO_BENCH_REG_ADDR, 0U, dir), len);
+	serial_fifo_bench_guest_write32(SERIAL_FIFO_DMA_CMD_ADDR(SERIAL_FIFO_BENCH_REG_ADDR, 0U, dir), SERIAL_FIFO_DMA_CMD_START);
+	return;
+}
+static bool serial_fifo_bench_dma_is_done(uint32 dir)
+{
+	uint32 cmd;
+
+	(void)mpu_get_data32(0U, SERIAL_FIFO_DMA_CMD_ADDR(SERIAL_FIFO_BENCH_REG_ADDR, 0U, dir), &cmd);
+	if ((cmd & SERIAL_FIFO_DMA_CMD_ERROR) != 0U) {
+		printf("ERROR: dma error dir=0x%x\n", dir);
+		exit(1);
+	}
+	return (cmd == SERIAL_FIFO_DMA_CMD_NONE);
+}
+static void *serial_fifo_bench_guest(void *arg)
+{
+	bool is_writing = FALSE;
+	uint32 len;
+
+	serial_fifo_bench_dma_start(SERIAL_FIFO_DMA_READ, SERIAL_FIFO_BENCH_BUF_SIZE);
+	while (serial_fifo_bench_stop == FALSE) {
+		serial_fifo_bench_clock.clock++;
+		device_event_dispatch(&serial_fifo_bench_clock);
+		athrill_device_supply_clock_serial_fifo(&serial_fifo_bench_clock);
+		if (is_writing == TRUE) {
+			if (serial_fifo_bench_dma_is_done(SERIAL_FIFO_DMA_WRITE) == TRUE) {
+				is_writing = FALSE;
+				serial_fifo_bench_dma_start(SERIAL_FIFO_DMA_READ, SERIAL_FIFO_BENCH_BUF_SIZE);
+			}
+		}
+		else if (serial_fifo_bench_dma_is_done(SERIAL_FIFO_DMA_READ) == TRUE) {
+			(void)mpu_get_data32(0U, SERIAL_FIFO_DMA_LEN_ADDR(SERIAL_FIFO_BENCH_REG_ADDR, 0U, SERIAL_FIFO_DMA_READ), &len);
+			serial_fifo_bench_dma_start(SERIAL_FIFO_DMA_WRITE, SERIAL_FIFO_BENCH_BUF_SIZE - len);
+			is_writing = TRUE;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * host
+ */
+typedef struct {
+	int		fd;
+	uint64	bytes;
+} SerialFifoBenchWriterType;
+static void *serial_fifo_bench_writer(void *arg)
+{
+	SerialFifoBenchWriterType *writer = (SerialFifoBenchWriterType *)arg;
+	static char buf[SERIAL_FIFO_BENCH_HOST_LEN];
+	uint64 done = 0U;
+	size_t len;
+	ssize_t ret;
+
+	memset(buf, 'a', sizeof(buf));
+	while (done < writer->bytes) {
+		len = ((writer->bytes - done) < sizeof(buf)) ? (size_t)(writer->bytes - done) : sizeof(buf);
+		ret = write(writer->fd, buf, len);
+		if (ret > 0) {
+			done += ret;
+		}
+	}
+	return NULL;
+}
+static int serial_fifo_bench_cmp(const void *a, const void *b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+
+	return (x < y) ? -1 : (x > y);
+}
+
+int main(int argc, char **argv)
+{
+	static char buf[SERIAL_FIFO_BENCH_HOST_LEN];
+	char dir[] = "/tmp/serial_fifo_bench.XXXXXX";
+	SerialFifoBenchWriterType writer;
+	pthread_t guest;
+	pthread_t host;
+	uint64 bytes = 256ULL * 1024ULL * 1024ULL;
+	uint64 done = 0U;
+	uint32 echo_count = 10000U;
+	double *rtt;
+	double t0;
+	double t1;
+	ssize_t ret;
+	uint32 i;
+	int rfd;
+	int wfd;
+	char ch;
+
+	if (argc > 1) {
+		bytes = strtoull(argv[1], NULL, 0);
+	}
+	if (argc > 2) {
+		serial_fifo_bench_fifo_size = (uint32)strtoul(argv[2], NULL, 0);
+	}
+	if (argc > 3) {
+		echo_count = (uint32)strtoul(argv[3], NULL, 0);
+	}
+	if (mkdtemp(dir) == NULL) {
+		printf("ERROR: can not create %s\n", dir);
+		return 1;
+	}
+	snprintf(serial_fifo_bench_rd_path, sizeof(serial_fifo_bench_rd_path), "%s/rd", dir);
+	snprintf(serial_fifo_bench_wr_path, sizeof(serial_fifo_bench_wr_path), "%s/wr", dir);
+	if ((mkfifo(serial_fifo_bench_rd_path, 0600) < 0) || (mkfifo(serial_fifo_bench_wr_path, 0600) < 0)) {
+		printf("ERROR: can not create fifos on %s\n", dir);
+		return 1;
+	}
+	rtt = calloc(echo_count + 1U, sizeof(double));
+	if (rtt == NULL) {
+		return 1;
+	}
+
+	(void)mpthread_init();
+	athrill_device_init_serial_fifo();
+	rfd = open(serial_fifo_bench_wr_path, O_RDONLY);
+	wfd = open(serial_fifo_bench_rd_path, O_WRONLY);
+	if ((rfd < 0) || (wfd < 0)) {
+		printf("ERROR: can not open fifos on %s\n", dir);
+		return 1;
+	}
+	(void)pthread_create(&guest, NULL, serial_fifo_bench_guest, NULL);
+
+	writer.fd = wfd;
+	writer.bytes = bytes;
+	t0 = bench_now();
+	(void)pthread_create(&host, NULL, serial_fifo_bench_writer, &writer);
+	while (done < bytes) {
+		ret = read(rfd, buf, sizeof(buf));
+		if (ret > 0) {
+			done += ret;
+		}
+	}
+	t1 = bench_now();
+	(void)pthread_join(host, NULL);
+	printf("fifo_size=%u throughput: %"FMT_UINT64" bytes %.3f s %.2f MB/s\n",
+			serial_fifo_bench_fifo_size, bytes, t1 - t0, ((double)bytes) / (t1 - t0) / 1e6);
+
+	for (i = 0; i < echo_count; i++) {
+		ch = 'x';
+		t0 = bench_now();
+		if (write(wfd, &ch, 1) != 1) {
+			printf("ERROR: echo write\n");
+			return 1;
+		}
+		while (read(rfd, &ch, 1) != 1) {
+			;
+		}
+		rtt[i] = (bench_now() - t0) * 1e6;
+	}
+	if (echo_count > 0U) {
+		qsort(rtt, echo_count, sizeof(double), serial_fifo_bench_cmp);
+		printf("echo rtt: n=%u p50 %.1f us p99 %.1f us max %.1f us\n",
+				echo_count, rtt[echo_count / 2U], rtt[(echo_count * 99U) / 100U], rtt[echo_count - 1U]);
+	}
+	(void)unlink(serial_fifo_bench_rd_path);
+	(void)unlink(serial_fifo_bench_wr_path);
+	(void)rmdir(dir);
+	/*
+	 * device threads are not stopped: exit here.
+	 */
+	serial_fifo_bench_stop = TRUE;
+	(void)pthread_join(guest, NULL);
+	return 0;
+}
@@ -0,0 +1,159 @@
+#include "syscall_guest.h"
+#include "athrill_device.h"
+#include "athrill_mpthread.h"
+#include "std_device_ops.h"
+#include "cpuemu_ops.h"
+#include "mpu_ops.h"
+#include "mpu_malloc.h"
+#include "snapshot.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SYSCALL_GUEST_DEVCFG_NUM	8U
+
+typedef struct {
+	const char	*key;
+	uint32		value;
+} SyscallGuestDevcfgType;
+
+static uint8 syscall_guest_memory[SYSCALL_GUEST_SIZE] __attribute__ ((aligned (8)));
+static uint32 syscall_guest_used = 0U;
+static SyscallGuestDevcfgType syscall_guest_devcfg[SYSCALL_GUEST_DEVCFG_NUM];
+static uint32 syscall_guest_devcfg_num = 0U;
+
+/*
+ * environment of the syscall device
+ */
+Std_ReturnType cpuemu_get_devcfg_value(const char* key, uint32 *value)
+{
+	uint32 i;
+
+	for (i = 0; i < syscall_guest_devcfg_num; i++) {
+		if (strcmp(key, syscall_guest_devcfg[i].key) == 0) {
+			*value = syscall_guest_devcfg[i].value;
+			return STD_E_OK;
+		}
+	}
+	return STD_E_NOENT;
+}
+Std_ReturnType cpuemu_get_devcfg_string(const char* key, char **value)
+{
+	return STD_E_NOENT;
+}
+uint64 cpuemu_get_total_clocks(void)
+{
+	return 0U;
+}
+int intc_raise_intr(uint32 intno)
+{
+	return 0;
+}
+Std_ReturnType snapshot_register(const char *name, const SnapshotOperationType *ops, void *arg)
+{
+	return STD_E_OK;
+}
+Std_ReturnType snapshot_register_fork_child(SnapshotForkChildType func)
+{
+	return STD_E_OK;
+}
+Std_ReturnType snapshot_write(SnapshotStreamType *stream, const void *data, uint32 size)
+{
+	return STD_E_OK;
+}
+Std_ReturnType snapshot_read(SnapshotStreamType *stream, void *data, uint32 size)
+{
+	return STD_E_OK;
+}
+Std_ReturnType mpu_address_set_write_hook(uint32 addr, uint32 size, MpuAddressWriteHookType hook)
+{
+	return STD_E_OK;
+}
+void mpu_address_clear_write_hook(uint32 addr, MpuAddressWriteHookType hook)
+{
+	return;
+}
+void mpu_address_notify_host_write(uint32 addr, uint32 size)
+{
+	return;
+}
+uint32 mpu_malloc_get_memory(uint32 size)
+{
+	return 0U;
+}
+void mpu_malloc_rel_memory(uint32 addr)
+{
+	return;
+}
+uint32 mpu_malloc_ref_size(uint32 addr)
+{
+	return 0U;
+}
+
+/*
+ * memory
+ */
+Std_ReturnType mpu_get_pointer_range(CoreIdType core_id, uint32 addr, uint8 **data, uint32 *size)
+{
+	if ((addr < SYSCALL_GUEST_BASE) || (addr >= (SYSCALL_GUEST_BASE + SYSCALL_GUEST_SIZE))) {
+		return STD_E_SEGV;
+	}
+	*data = &syscall_guest_memory[addr - SYSCALL_GUEST_BASE];
+	*size = (SYSCALL_GUEST_BASE + SYSCALL_GUEST_SIZE) - addr;
+	return STD_E_OK;
+}
+Std_ReturnType mpu_get_pointer(CoreIdType core_id, uint32 addr, uint8 **data)
+{
+	uint32 size;
+
+	return mpu_get_pointer_range(core_id, addr, data, &size);
+}
+sys_addr syscall_guest_alloc(uint32 size)
+{
+	sys_addr addr;
+
+	size = (size + 7U) & ~7U;
+	if (size > (SYSCALL_GUEST_SIZE - syscall_guest_used)) {
+		printf("ERROR: guest memory is exhausted size=%u\n", size);
+		exit(1);
+	}
+	addr = SYSCALL_GUEST_BASE + syscall_guest_used;
+	syscall_guest_used += size;
+	return addr;
+}
+void *syscall_guest_ptr(sys_addr addr)
+{
+	uint8 *data;
+
+	if (mpu_get_pointer(0U, addr, &data) != STD_E_OK) {
+		printf("ERROR: guest address 0x%x\n", addr);
+		exit(1);
+	}
+	return data;
+}
+
+void syscall_guest_set_devcfg(const char *key, uint32 value)
+{
+	if (syscall_guest_devcfg_num >= SYSCALL_GUEST_DEVCFG_NUM) {
+		return;
+	}
+	syscall_guest_devcfg[syscall_guest_devcfg_num].key = key;
+	syscall_guest_devcfg[syscall_guest_devcfg_num].value = value;
+	syscall_guest_devcfg_num++;
+	return;
+}
+/*
+ * like cpuemu_init(): system helper is started before threads.
+ */
+void syscall_guest_init(void)
+{
+	athrill_system_helper_init();
+	(void)mpthread_init();
+	athrill_syscall_device_init();
+	return;
+}
+sys_int32 syscall_guest_call(sys_addr args)
+{
+	athrill_syscall_device(args);
+	return ((AthrillSyscallArgType *)syscall_guest_ptr(args))->ret_value;
+}
@@ -0,0 +1,33 @@
+#ifndef _SYSCALL_GUEST_H_
+#define _SYSCALL_GUEST_H_
+
+#include "std_types.h"
+#include "std_errno.h"
+#define ATHRILL_SYSCALL_DEVICE
+#include "athrill_syscall.h"
+
+/*
+ * guest of the syscall device(athrill_syscall_device.c).
+ * guest memory is one plain buffer of SYSCALL_GUEST_SIZE at SYSCALL_GUEST_BASE,
+ * and guest objects are allocated from it(never freed).
+ * syscalls are issued by athrill_syscall_device() like the store to the syscall register.
+ */
+#define SYSCALL_GUEST_BASE		0x00100000U
+#define SYSCALL_GUEST_SIZE		(4U * 1024U * 1024U)
+
+/*
+ * devcfg values are set before syscall_guest_init().
+ */
+extern void syscall_guest_set_devcfg(const char *key, uint32 value);
+extern void syscall_guest_init(void);
+
+extern sys_addr syscall_guest_alloc(uint32 size);
+extern void *syscall_guest_ptr(sys_addr addr);
+
+/*
+ * args is a guest AthrillSyscallArgType which is filled by the caller.
+ * returns ret_value.
+ */
+extern sys_int32 syscall_guest_call(sys_addr args);
+
+#endif /* _SYSCALL_GUEST_H_ */
@@ -0,0 +1,124 @@
+#include "syscall_guest.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+/*
+ * per-call latency of the system syscall(SYS_API_ID_SYSTEM).
+ *
+ * athrill_extfunc.sh of this benchmark only exits with its argument, and is found by PATH.
+ * - system: per-call system() of the shell(default).
+ * - helper: persistent shell(DEVICE_CONFIG_SYSTEM_HELPER=1).
+ * each mode is a child process, because the helper is started on init.
+ * helper returns the exit status, and system() returns SYS_API_ERR_OK: both are checked.
+ *
+ * usage: system_bench [calls]
+ */
+#define SYSTEM_BENCH_STATUS_NUM		100U
+
+static int system_bench_cmp(const void *a, const void *b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+
+	return (x < y) ? -1 : (x > y);
+}
+
+static int system_bench_run(const char *name, uint32 helper, uint32 calls)
+{
+	AthrillSyscallArgType *args;
+	sys_addr addr;
+	sys_int32 expect;
+	uint32 errors = 0U;
+	double *latency;
+	double total = 0.0;
+	double t0;
+	pid_t pid;
+	int status;
+	uint32 i;
+
+	fflush(stdout);
+	pid = fork();
+	if (pid < 0) {
+		printf("ERROR: can not fork\n");
+		exit(1);
+	}
+	if (pid > 0) {
+		(void)waitpid(pid, &status, 0);
+		return (WIFEXITED(status) && (WEXITSTATUS(status) == 0)) ? 0 : 1;
+	}
+	latency = calloc(calls + 1U, sizeof(double));
+	if (latency == NULL) {
+		exit(1);
+	}
+	syscall_guest_set_devcfg("DEVICE_CONFIG_SYSTEM_HELPER", helper);
+	syscall_guest_init();
+	addr = syscall_guest_alloc(sizeof(AthrillSyscallArgType));
+	args = syscall_guest_ptr(addr);
+	for (i = 0; i < calls; i++) {
+		memset(args, 0, sizeof(*args));
+		args->api_id = SYS_API_ID_SYSTEM;
+		args->ret_value = SYS_API_ERR_INVAL;
+		args->body.api_system.id = i % SYSTEM_BENCH_STATUS_NUM;
+		expect = (helper != 0U) ? (sys_int32)(i % SYSTEM_BENCH_STATUS_NUM) : SYS_API_ERR_OK;
+		t0 = bench_now();
+		if (syscall_guest_call(addr) != expect) {
+			errors++;
+		}
+		latency[i] = (bench_now() - t0) * 1e6;
+		total += latency[i];
+	}
+	if (calls > 0U) {
+		qsort(latency, calls, sizeof(double), system_bench_cmp);
+		printf("%-7s %6u %10.1f %10.1f %10.1f %10.1f %6u\n", name, calls, total / ((double)calls),
+				latency[calls / 2U], latency[(calls * 99U) / 100U], latency[calls - 1U], errors);
+	}
+	fflush(stdout);
+	/*
+	 * helper is killed on exit(stdin is closed).
+	 */
+	exit((errors == 0U) ? 0 : 1);
+}
+
+int main(int argc, char **argv)
+{
+	char dir[] = "/tmp/system_bench.XXXXXX";
+	char path[4096];
+	char *env;
+	FILE *fp;
+	uint32 calls = 200U;
+	int ret;
+
+	if (argc > 1) {
+		calls = (uint32)strtoul(argv[1], NULL, 0);
+	}
+	if (mkdtemp(dir) == NULL) {
+		printf("ERROR: can not create work directory\n");
+		return 1;
+	}
+	(void)snprintf(path, sizeof(path), "%s/athrill_extfunc.sh", dir);
+	fp = fopen(path, "w");
+	if (fp == NULL) {
+		printf("ERROR: can not create %s\n", path);
+		return 1;
+	}
+	fprintf(fp, "#!/bin/sh\nexit $1\n");
+	fclose(fp);
+	(void)chmod(path, 0755);
+	env = getenv("PATH");
+	(void)snprintf(path, sizeof(path), "%s:%s", dir, (env != NULL) ? env : "/usr/bin:/bin");
+	(void)setenv("PATH", path, 1);
+
+	printf("%-7s %6s %10s %10s %10s %10s %6s  (us/call)\n", "mode", "calls", "mean", "p50", "p99", "max", "errors");
+	ret = system_bench_run("system", 0U, calls);
+	ret |= system_bench_run("helper", 1U, calls);
+
+	(void)snprintf(path, sizeof(path), "%s/athrill_extfunc.sh", dir);
+	(void)unlink(path);
+	(void)rmdir(dir);
+	return ret;
+}
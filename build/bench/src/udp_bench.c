@@ -0,0 +1,261 @@
+#include "syscall_guest.h"
+#include "bench.h"
+#include "target/target_os_api.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/*
+ * UDP loopback throughput of the syscall device.
+ *
+ * guest sends datagrams from one UDP socket to another over 127.0.0.1 and receives them,
+ * in rounds of UDP_BENCH_BATCH datagrams(one thread, so the receive queue does not overflow).
+ * - single: one SYS_API_ID_SENDTO/SYS_API_ID_RECVFROM per datagram.
+ * - mmsg N: SYS_API_ID_SENDMMSG/SYS_API_ID_RECVMMSG with vlen N.
+ * every datagram has its sequence number, and the receiver checks the order.
+ * result is packets per second through the guest syscalls.
+ *
+ * usage: udp_bench [packets]
+ */
+#define UDP_BENCH_BATCH			SYS_MMSG_VLEN_MAX
+#define UDP_BENCH_BUF_SIZE		2048U
+#define UDP_BENCH_RCVBUF		(4 * 1024 * 1024)
+
+typedef struct {
+	sys_addr	args;
+	sys_addr	dst;
+	sys_addr	tx_msgs;
+	sys_addr	rx_msgs;
+	sys_addr	tx_buf;
+	sys_addr	rx_buf;
+	sys_int32	tx_fd;
+	sys_int32	rx_fd;
+	uint32		tx_seq;
+	uint32		rx_seq;
+	uint64		errors;
+	uint64		syscalls;
+} UdpBenchType;
+
+static UdpBenchType udp_bench;
+
+static AthrillSyscallArgType *udp_bench_args(uint32 api_id)
+{
+	AthrillSyscallArgType *args = syscall_guest_ptr(udp_bench.args);
+
+	memset(args, 0, sizeof(*args));
+	args->api_id = api_id;
+	args->ret_value = -1;
+	return args;
+}
+static sys_int32 udp_bench_call(void)
+{
+	udp_bench.syscalls++;
+	return syscall_guest_call(udp_bench.args);
+}
+
+static void udp_bench_setup(void)
+{
+	AthrillSyscallArgType *args;
+	struct sys_sockaddr_in *addrp;
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+	int rcvbuf = UDP_BENCH_RCVBUF;
+
+	udp_bench.args = syscall_guest_alloc(sizeof(AthrillSyscallArgType));
+	udp_bench.dst = syscall_guest_alloc(sizeof(struct sys_sockaddr_in));
+	udp_bench.tx_msgs = syscall_guest_alloc(sizeof(struct sys_mmsghdr) * UDP_BENCH_BATCH);
+	udp_bench.rx_msgs = syscall_guest_alloc(sizeof(struct sys_mmsghdr) * UDP_BENCH_BATCH);
+	udp_bench.tx_buf = syscall_guest_alloc(UDP_BENCH_BUF_SIZE * UDP_BENCH_BATCH);
+	udp_bench.rx_buf = syscall_guest_alloc(UDP_BENCH_BUF_SIZE * UDP_BENCH_BATCH);
+
+	args = udp_bench_args(SYS_API_ID_SOCKET);
+	args->body.api_socket.domain = ATHRILL_SYSCALL_SOCKET_DOMAIN_AF_INET;
+	args->body.api_socket.type = ATHRILL_SYSCALL_SOCKET_TYPE_DGRAM;
+	udp_bench.tx_fd = udp_bench_call();
+	args = udp_bench_args(SYS_API_ID_SOCKET);
+	args->body.api_socket.domain = ATHRILL_SYSCALL_SOCKET_DOMAIN_AF_INET;
+	args->body.api_socket.type = ATHRILL_SYSCALL_SOCKET_TYPE_DGRAM;
+	udp_bench.rx_fd = udp_bench_call();
+	if ((udp_bench.tx_fd < 0) || (udp_bench.rx_fd < 0)) {
+		printf("ERROR: can not create udp sockets\n");
+		exit(1);
+	}
+
+	addrp = syscall_guest_ptr(udp_bench.dst);
+	memset(addrp, 0, sizeof(*addrp));
+	addrp->sin_addr = htonl(INADDR_LOOPBACK);
+	addrp->sin_port = 0;
+	args = udp_bench_args(SYS_API_ID_BIND);
+	args->body.api_bind.sockfd = udp_bench.rx_fd;
+	args->body.api_bind.sockaddr = udp_bench.dst;
+	args->body.api_bind.addrlen = sizeof(struct sys_sockaddr_in);
+	if (udp_bench_call() != SYS_API_ERR_OK) {
+		printf("ERROR: can not bind udp socket\n");
+		exit(1);
+	}
+	/*
+	 * host side: port of the receiver, and the receive queue for a batch of large datagrams.
+	 */
+	(void)getsockname(udp_bench.rx_fd, (struct sockaddr *)&addr, &addrlen);
+	addrp->sin_port = addr.sin_port;
+	(void)setsockopt(udp_bench.rx_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+	udp_bench.syscalls = 0U;
+	return;
+}
+
+static void udp_bench_fill(uint32 index)
+{
+	uint8 *buf = syscall_guest_ptr(udp_bench.tx_buf + (index * UDP_BENCH_BUF_SIZE));
+
+	memcpy(buf, &udp_bench.tx_seq, sizeof(udp_bench.tx_seq));
+	udp_bench.tx_seq++;
+	return;
+}
+static void udp_bench_check(uint32 index, sys_int32 len, uint32 size)
+{
+	uint8 *buf = syscall_guest_ptr(udp_bench.rx_buf + (index * UDP_BENCH_BUF_SIZE));
+	uint32 seq;
+
+	memcpy(&seq, buf, sizeof(seq));
+	if ((len != (sys_int32)size) || (seq != udp_bench.rx_seq)) {
+		udp_bench.errors++;
+	}
+	udp_bench.rx_seq = seq + 1U;
+	return;
+}
+
+static uint32 udp_bench_round_single(uint32 num, uint32 size)
+{
+	AthrillSyscallArgType *args;
+	sys_int32 ret;
+	uint32 i;
+
+	for (i = 0; i < num; i++) {
+		udp_bench_fill(i);
+		args = udp_bench_args(SYS_API_ID_SENDTO);
+		args->body.api_sendto.sockfd = udp_bench.tx_fd;
+		args->body.api_sendto.buf = udp_bench.tx_buf + (i * UDP_BENCH_BUF_SIZE);
+		args->body.api_sendto.len = size;
+		args->body.api_sendto.sockaddr = udp_bench.dst;
+		if (udp_bench_call() != (sys_int32)size) {
+			udp_bench.errors++;
+		}
+	}
+	for (i = 0; i < num; i++) {
+		args = udp_bench_args(SYS_API_ID_RECVFROM);
+		args->body.api_recvfrom.sockfd = udp_bench.rx_fd;
+		args->body.api_recvfrom.buf = udp_bench.rx_buf + (i * UDP_BENCH_BUF_SIZE);
+		args->body.api_recvfrom.len = UDP_BENCH_BUF_SIZE;
+		ret = udp_bench_call();
+		if (ret < 0) {
+			/*
+			 * loopback datagrams are queued on sendto: EAGAIN is a drop.
+			 */
+			udp_bench.errors++;
+			return i;
+		}
+		udp_bench_check(i, ret, size);
+	}
+	return num;
+}
+static uint32 udp_bench_round_mmsg(uint32 num, uint32 size, uint32 vlen)
+{
+	AthrillSyscallArgType *args;
+	struct sys_mmsghdr *msgs;
+	sys_int32 ret;
+	uint32 done;
+	uint32 n;
+	uint32 i;
+
+	msgs = syscall_guest_ptr(udp_bench.tx_msgs);
+	for (i = 0; i < num; i++) {
+		udp_bench_fill(i);
+		msgs[i].buf = udp_bench.tx_buf + (i * UDP_BENCH_BUF_SIZE);
+		msgs[i].len = size;
+		msgs[i].sockaddr = udp_bench.dst;
+		msgs[i].msg_len = 0U;
+	}
+	for (done = 0; done < num; done += (uint32)ret) {
+		n = ((num - done) < vlen) ? (num - done) : vlen;
+		args = udp_bench_args(SYS_API_ID_SENDMMSG);
+		args->body.api_mmsg.sockfd = udp_bench.tx_fd;
+		args->body.api_mmsg.msgvec = udp_bench.tx_msgs + (done * sizeof(struct sys_mmsghdr));
+		args->body.api_mmsg.vlen = n;
+		ret = udp_bench_call();
+		if (ret <= 0) {
+			udp_bench.errors++;
+			return 0U;
+		}
+	}
+	msgs = syscall_guest_ptr(udp_bench.rx_msgs);
+	for (i = 0; i < num; i++) {
+		msgs[i].buf = udp_bench.rx_buf + (i * UDP_BENCH_BUF_SIZE);
+		msgs[i].len = UDP_BENCH_BUF_SIZE;
+		msgs[i].sockaddr = 0U;
+		msgs[i].msg_len = 0U;
+	}
+	for (done = 0; done < num; done += (uint32)ret) {
+		n = ((num - done) < vlen) ? (num - done) : vlen;
+		args = udp_bench_args(SYS_API_ID_RECVMMSG);
+		args->body.api_mmsg.sockfd = udp_bench.rx_fd;
+		args->body.api_mmsg.msgvec = udp_bench.rx_msgs + (done * sizeof(struct sys_mmsghdr));
+		args->body.api_mmsg.vlen = n;
+		ret = udp_bench_call();
+		if (ret <= 0) {
+			udp_bench.errors++;
+			break;
+		}
+	}
+	for (i = 0; i < done; i++) {
+		udp_bench_check(i, (sys_int32)msgs[i].msg_len, size);
+	}
+	return done;
+}
+
+static void udp_bench_run(const char *name, uint32 vlen, uint32 size, uint64 packets)
+{
+	uint64 received = 0U;
+	uint64 sent = 0U;
+	uint32 num;
+	double t0;
+	double t1;
+
+	udp_bench.errors = 0U;
+	udp_bench.syscalls = 0U;
+	udp_bench.rx_seq = udp_bench.tx_seq;
+	t0 = bench_now();
+	while (sent < packets) {
+		num = ((packets - sent) < UDP_BENCH_BATCH) ? (uint32)(packets - sent) : UDP_BENCH_BATCH;
+		received += (vlen == 0U) ? udp_bench_round_single(num, size) : udp_bench_round_mmsg(num, size, vlen);
+		sent += num;
+	}
+	t1 = bench_now();
+	printf("%-8s %6u %12.0f %10.1f %10.3f %8"FMT_UINT64"\n", name, size,
+			((double)received) / (t1 - t0), ((double)(t1 - t0)) * 1e9 / ((double)received),
+			((double)udp_bench.syscalls) / ((double)received), udp_bench.errors);
+	return;
+}
+
+int main(int argc, char **argv)
+{
+	static const uint32 sizes[] = { 64U, 1024U };
+	uint64 packets = 1000000ULL;
+	uint32 i;
+
+	if (argc > 1) {
+		packets = strtoull(argv[1], NULL, 0);
+	}
+	syscall_guest_init();
+	udp_bench_setup();
+	printf("packets=%"FMT_UINT64" batch=%u\n", packets, UDP_BENCH_BATCH);
+	printf("%-8s %6s %12s %10s %10s %8s\n", "api", "size", "packets/s", "ns/packet", "calls/pkt", "errors");
+	for (i = 0; i < (sizeof(sizes) / sizeof(sizes[0])); i++) {
+		udp_bench_run("single", 0U, sizes[i], packets);
+		udp_bench_run("mmsg 8", 8U, sizes[i], packets);
+		udp_bench_run("mmsg 64", 64U, sizes[i], packets);
+	}
+	return 0;
+}
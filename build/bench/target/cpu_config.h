@@ -0,0 +1,13 @@
+#ifndef _CPU_CONFIG_H_
+#define _CPU_CONFIG_H_
+
+/*
+ * minimal target configuration of benchmarks.
+ */
+#include "std_types.h"
+
+#define CPU_CONFIG_CORE_NUM			2
+#define CPU_CONFIG_CORE_ID_0		0
+#define CPU_CONFIG_CORE_ID_1		1
+
+#endif /* _CPU_CONFIG_H_ */
@@ -0,0 +1,11 @@
+#ifndef _DEVICE_H_
+#define _DEVICE_H_
+
+/*
+ * target devices are not used by benchmarks.
+ */
+#include "std_types.h"
+
+extern void device_raise_int(uint16 intno);
+
+#endif /* _DEVICE_H_ */
@@ -0,0 +1,9 @@
+#ifndef _MPU_CONFIG_H_
+#define _MPU_CONFIG_H_
+
+/*
+ * static regions of benchmarks: mpu_address_map is defined by each benchmark.
+ */
+#define MPU_CONFIG_REGION_NUM		22
+
+#endif /* _MPU_CONFIG_H_ */
@@ -0,0 +1,38 @@
+#ifndef _TARGET_CPU_H_
+#define _TARGET_CPU_H_
+
+/*
+ * minimal target cpu of benchmarks: no instructions are executed.
+ */
+#include "std_types.h"
+
+typedef struct {
+	uint32		pc;
+	uint32		reg[32];
+	bool		is_halt;
+	CoreIdType	core_id;
+} TargetCoreType;
+
+typedef struct {
+	uint32		type_id;
+} OpDecodedCodeType;
+
+typedef uint32 OpCodeId;
+
+typedef enum {
+	CpuMemoryAccess_NONE = 0,
+	CpuMemoryAccess_READ,
+	CpuMemoryAccess_WRITE,
+	CpuMemoryAccess_EXEC,
+} CpuMemoryAccessType;
+
+static inline uint32 cpu_get_pc(const TargetCoreType *core)
+{
+	return core->pc;
+}
+static inline uint32 cpu_get_sp(const TargetCoreType *core)
+{
+	return core->reg[3];
+}
+
+#endif /* _TARGET_CPU_H_ */
@@ -1,4 +1,5 @@
 #include "bus.h"
+#include "cpu.h"
 
 typedef struct {
 	BusAccessType		access_type;
@@ -7,35 +8,66 @@ typedef struct {
 	uint32				access_last_data;
 } BusAccessLogType;
 
-uint32			 bus_access_log_size  = 0;
-BusAccessLogType bus_access_log[BUS_ACCESS_LOG_SIZE];
+/*
+ * per core logs: cores can run on their own host threads.
+ */
+uint32			 bus_access_log_size[CPU_CONFIG_CORE_NUM];
+BusAccessLogType bus_access_log[CPU_CONFIG_CORE_NUM][BUS_ACCESS_LOG_SIZE];
 
-void bus_access_set_log(BusAccessType type, uint32 size, uint32 access_addr, uint32 data)
+void bus_access_set_log(CoreIdType core_id, BusAccessType type, uint32 size, uint32 access_addr, uint32 data)
 {
+	if (core_id >= CPU_CONFIG_CORE_NUM) {
+		return;
+	}
 	if (type == BUS_ACCESS_TYPE_NONE) {
-		bus_access_log_size = 0;
+		bus_access_log_size[core_id] = 0;
 		return;
 	}
-	else if (bus_access_log_size >= BUS_ACCESS_LOG_SIZE) {
+	else if (bus_access_log_size[core_id] >= BUS_ACCESS_LOG_SIZE) {
 		return;
 	}
-	bus_access_log[bus_access_log_size].access_type = type;
-	bus_access_log[bus_access_log_size].access_size = size;
-	bus_access_log[bus_access_log_size].access_addr = access_addr;
-	bus_access_log[bus_access_log_size].access_last_data = data;
-	bus_access_log_size++;
+	bus_access_log[core_id][bus_access_log_size[core_id]].access_type = type;
+	bus_access_log[core_id][bus_access_log_size[core_id]].access_size = size;
+	bus_access_log[core_id][bus_access_log_size[core_id]].access_addr = access_addr;
+	bus_access_log[core_id][bus_access_log_size[core_id]].access_last_data = data;
+	bus_access_log_size[core_id]++;
 	return;
 }
 
+/*
+ * returns the log of current core.
+ */
 Std_ReturnType bus_access_get_log(BusAccessType *type, uint32 *size, uint32 *access_addr, uint32 *last_data)
 {
-	if (bus_access_log_size == 0) {
+	CoreIdType core_id = cpu_get_current_core_id();
+
+	if (bus_access_log_size[core_id] == 0) {
 		return STD_E_NOENT;
 	}
-	bus_access_log_size--;
-	*type = bus_access_log[bus_access_log_size].access_type;
-	*size = bus_access_log[bus_access_log_size].access_size;
-	*access_addr = bus_access_log[bus_access_log_size].access_addr;
-	*last_data = bus_access_log[bus_access_log_size].access_last_data;
+	bus_access_log_size[core_id]--;
+	*type = bus_access_log[core_id][bus_access_log_size[core_id]].access_type;
+	*size = bus_access_log[core_id][bus_access_log_size[core_id]].access_size;
+	*access_addr = bus_access_log[core_id][bus_access_log_size[core_id]].access_addr;
+	*last_data = bus_access_log[core_id][bus_access_log_size[core_id]].access_last_data;
 	return STD_E_OK;
 }
+
+/*
+ * block transfer for devices(DMA).
+ */
+Std_ReturnType bus_read_block(CoreIdType core_id, uint32 addr, uint8 *data, uint32 size)
+{
+	Std_ReturnType err = mpu_get_block(core_id, addr, data, size);
+	if (err != STD_E_OK) {
+		printf("ERROR:can not read block:addr=0x%x size=%u\n", addr, size);
+	}
+	return err;
+}
+Std_ReturnType bus_write_block(CoreIdType core_id, uint32 addr, const uint8 *data, uint32 size)
+{
+	Std_ReturnType err = mpu_put_block(core_id, addr, data, size);
+	if (err != STD_E_OK) {
+		printf("ERROR:can not write block:addr=0x%x size=%u\n", addr, size);
+	}
+	return err;
+}
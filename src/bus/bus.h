@@ -4,6 +4,7 @@
 #include "std_types.h"
 #include "std_errno.h"
 #include "mpu_ops.h"
+#include "mpu.h"
 #include <stdio.h>
 
 typedef enum {
@@ -13,43 +14,72 @@ typedef enum {
 } BusAccessType;
 #define BUS_ACCESS_LOG_SIZE	128
 
-extern void bus_access_set_log(BusAccessType type, uint32 size, uint32 access_addr, uint32 data);
+extern void bus_access_set_log(CoreIdType core_id, BusAccessType type, uint32 size, uint32 access_addr, uint32 data);
 extern Std_ReturnType bus_access_get_log(BusAccessType *type, uint32 *size, uint32 *access_addr, uint32 *data);
 
+/*
+ * ブロック転送(DMA)
+ * 領域単位で権限チェックし，ROM/RAM は memcpy，デバイス領域はレジスタアクセスで転送する．
+ * CPU スレッドから呼び出すこと．
+ */
+extern Std_ReturnType bus_read_block(CoreIdType core_id, uint32 addr, uint8 *data, uint32 size);
+extern Std_ReturnType bus_write_block(CoreIdType core_id, uint32 addr, const uint8 *data, uint32 size);
+
 /*
  * データ取得するための操作関数群
  */
 static inline Std_ReturnType bus_get_data8(CoreIdType core_id, uint32 addr, uint8 *data)
 {
 	Std_ReturnType err;
+	uint8 *hostp = mpu_address_tlb_get_read(core_id, addr, 1U);
 
-	err = mpu_get_data8(core_id, addr, data);
-	if (err != STD_E_OK) {
-		printf("ERROR:can not load data:addr=0x%x size=1byte\n", addr);
+	if (hostp != NULL) {
+		*data = *((uint8*)hostp);
+		err = STD_E_OK;
 	}
-	bus_access_set_log(BUS_ACCESS_TYPE_READ, 1U, addr, *data);
+	else {
+		err = mpu_get_data8(core_id, addr, data);
+		if (err != STD_E_OK) {
+			printf("ERROR:can not load data:addr=0x%x size=1byte\n", addr);
+		}
+	}
+	bus_access_set_log(core_id, BUS_ACCESS_TYPE_READ, 1U, addr, *data);
 	return err;
 }
 static inline Std_ReturnType bus_get_data16(CoreIdType core_id, uint32 addr, uint16 *data)
 {
 	Std_ReturnType err;
+	uint8 *hostp = mpu_address_tlb_get_read(core_id, addr, 2U);
 
-	err = mpu_get_data16(core_id, addr, data);
-	if (err != STD_E_OK) {
-		printf("ERROR:can not load data:addr=0x%x size=2byte\n", addr);
+	if (hostp != NULL) {
+		*data = *((uint16*)hostp);
+		err = STD_E_OK;
+	}
+	else {
+		err = mpu_get_data16(core_id, addr, data);
+		if (err != STD_E_OK) {
+			printf("ERROR:can not load data:addr=0x%x size=2byte\n", addr);
+		}
 	}
-	bus_access_set_log(BUS_ACCESS_TYPE_READ, 2U, addr, *data);
+	bus_access_set_log(core_id, BUS_ACCESS_TYPE_READ, 2U, addr, *data);
 	return err;
 }
 static inline Std_ReturnType bus_get_data32(CoreIdType core_id, uint32 addr, uint32 *data)
 {
 	Std_ReturnType err;
+	uint8 *hostp = mpu_address_tlb_get_read(core_id, addr, 4U);
 
-	err = mpu_get_data32(core_id, addr, data);
-	if (err != STD_E_OK) {
-		printf("ERROR:can not load data:addr=0x%x size=4byte\n", addr);
+	if (hostp != NULL) {
+		*data = *((uint32*)hostp);
+		err = STD_E_OK;
+	}
+	else {
+		err = mpu_get_data32(core_id, addr, data);
+		if (err != STD_E_OK) {
+			printf("ERROR:can not load data:addr=0x%x size=4byte\n", addr);
+		}
 	}
-	bus_access_set_log(BUS_ACCESS_TYPE_READ, 4U, addr, *data);
+	bus_access_set_log(core_id, BUS_ACCESS_TYPE_READ, 4U, addr, *data);
 	return err;
 }
 
@@ -58,17 +88,35 @@ static inline Std_ReturnType bus_get_data32(CoreIdType core_id, uint32 addr, uin
  */
 static inline Std_ReturnType bus_put_data8(CoreIdType core_id, uint32 addr, uint8 data)
 {
-	bus_access_set_log(BUS_ACCESS_TYPE_WRITE, 1U, addr, data);
+	uint8 *hostp = mpu_address_tlb_get_write(core_id, addr, 1U);
+
+	bus_access_set_log(core_id, BUS_ACCESS_TYPE_WRITE, 1U, addr, data);
+	if (hostp != NULL) {
+		*((uint8*)hostp) = data;
+		return STD_E_OK;
+	}
 	return mpu_put_data8(core_id, addr, data);
 }
 static inline Std_ReturnType bus_put_data16(CoreIdType core_id, uint32 addr, uint16 data)
 {
-	bus_access_set_log(BUS_ACCESS_TYPE_WRITE, 2U, addr, data);
+	uint8 *hostp = mpu_address_tlb_get_write(core_id, addr, 2U);
+
+	bus_access_set_log(core_id, BUS_ACCESS_TYPE_WRITE, 2U, addr, data);
+	if (hostp != NULL) {
+		*((uint16*)hostp) = data;
+		return STD_E_OK;
+	}
 	return mpu_put_data16(core_id, addr, data);
 }
 static inline Std_ReturnType bus_put_data32(CoreIdType core_id, uint32 addr, uint32 data)
 {
-	bus_access_set_log(BUS_ACCESS_TYPE_WRITE, 4U, addr, data);
+	uint8 *hostp = mpu_address_tlb_get_write(core_id, addr, 4U);
+
+	bus_access_set_log(core_id, BUS_ACCESS_TYPE_WRITE, 4U, addr, data);
+	if (hostp != NULL) {
+		*((uint32*)hostp) = data;
+		return STD_E_OK;
+	}
 	return mpu_put_data32(core_id, addr, data);
 }
 
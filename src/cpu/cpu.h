@@ -14,26 +14,93 @@ typedef struct {
 	 */
 	TargetCoreType		core;
 	uint64				elaps;
+	/*
+	 * last hit decode cache region of this core.
+	 */
+	struct cached_operation_code_type	*last_cached_code;
 } CpuCoreType;
 
+#ifdef CPU_CONFIG_BLOCK_EXEC_SUPPORT
+/*
+ * block chain link: successor block head of a block end instruction.
+ * decoded entries are never freed, so op pointer is valid while pc is in cache.
+ */
+#define CPU_OPERATION_CODE_LINK_NUM		2U
 typedef struct {
+	uint32								pc;
+	struct cpu_operation_code_type		*op;
+} CpuOperationCodeLinkType;
+#endif /* CPU_CONFIG_BLOCK_EXEC_SUPPORT */
+
+typedef struct cpu_operation_code_type {
 	OpDecodedCodeType	decoded_code;
 #ifndef ARCH_V850ES_FK3
 	OpCodeId			code_id;
 #endif /* ARCH_V850ES_FK3 */
 	int (*op_exec) (TargetCoreType *cpu);
 	/*
-	 * not supported yet..
-	 * use this flag if cache region is rewrite by user program.
-	 * then cache reconstruction is needed!!
+	 * set when cache region is rewrite by user program or host.
+	 * op_exec is cleared at the same time, so cache reconstruction is needed
+	 * before execution, and decoder must clear this flag.
 	 */
 	bool				is_dirty;
+#ifdef CPU_CONFIG_BLOCK_EXEC_SUPPORT
+	/*
+	 * basic block information(set by decoder).
+	 * only on targets which chain blocks: entries are allocated per instruction slot.
+	 * op_size: instruction length(byte).
+	 * is_block_end: TRUE when the instruction may set pc other than pc + op_size,
+	 *               or may store on device visible memory.
+	 */
+	uint8				op_size;
+	bool				is_block_end;
+	/*
+	 * successor blocks of this block end(most recently used first).
+	 */
+	CpuOperationCodeLinkType	link[CPU_OPERATION_CODE_LINK_NUM];
+#endif /* CPU_CONFIG_BLOCK_EXEC_SUPPORT */
 } CpuOperationCodeType;
 
-typedef struct {
+/*
+ * maximum instruction length(byte).
+ * a write on addr can break the instruction which starts before addr.
+ */
+#define VIRTUAL_CPU_OPCODE_MAX_SIZE	8U
+
+/*
+ * decoded operation cache.
+ *
+ * decoders should get entries by virtual_cpu_get_cached_opcode(cached_code, pc).
+ *
+ * default:
+ *   instructions are halfword aligned, so one entry is assigned per 2 bytes.
+ *   entries are allocated per page when an instruction on the page is executed at first.
+ * target which defines CPU_CONFIG_CACHED_CODE_DENSE in cpu_config.h(compatibility):
+ *   one entry per byte is allocated for whole region on codes[], and decoders may
+ *   index codes[pc - code_start_addr] directly. pages[] point into codes[] from the start,
+ *   and whole region is write tracked, because such decoders never allocate pages.
+ */
+#define CACHED_CODE_PAGE_SHIFT		12U
+#define CACHED_CODE_PAGE_SIZE		(1U << CACHED_CODE_PAGE_SHIFT)
+#ifdef CPU_CONFIG_CACHED_CODE_DENSE
+#define CACHED_CODE_OP_SHIFT		0U
+#else
+#define CACHED_CODE_OP_SHIFT		1U
+#endif /* CPU_CONFIG_CACHED_CODE_DENSE */
+#define CACHED_CODE_OP_ALIGN		(1U << CACHED_CODE_OP_SHIFT)
+#define CACHED_CODE_PAGE_OP_NUM		(CACHED_CODE_PAGE_SIZE >> CACHED_CODE_OP_SHIFT)
+#define CACHED_CODE_PAGE_OP_INDEX(off)	(((off) & (CACHED_CODE_PAGE_SIZE - 1U)) >> CACHED_CODE_OP_SHIFT)
+
+typedef struct cached_operation_code_type {
 	uint32				code_start_addr;
 	uint32				code_size;
+	/*
+	 * deprecated: NULL unless CPU_CONFIG_CACHED_CODE_DENSE.
+	 */
 	CpuOperationCodeType	*codes;
+	uint32				page_num;
+	uint32				alloc_page_num;
+	CpuOperationCodeType	**pages;
 } CachedOperationCodeType;
 
 #define DEFAULT_CPU_FREQ		100 /* MHz */
@@ -43,45 +110,295 @@ typedef struct {
 	uint32						core_id_num;
 	CpuCoreType					cores[CPU_CONFIG_CORE_NUM];
 	uint32						cached_code_num;
+	/*
+	 * sorted by code_start_addr.
+	 */
 	CachedOperationCodeType		**cached_code;
 } CpuType;
 
 extern CpuType	virtual_cpu;
 #define CPU_CONFIG_GET_CORE_ID_NUM()	((int)virtual_cpu.core_id_num)
 
+/*
+ * core which runs on the calling host thread(cpuemu.c).
+ * cores run on their own host threads on multi-thread execution,
+ * and virtual_cpu.current_core is not valid there.
+ */
+extern __thread CpuCoreType *virtual_cpu_thread_core;
+
+static inline CpuCoreType *virtual_cpu_get_current_core(void)
+{
+	CpuCoreType *core = virtual_cpu_thread_core;
+
+	if (core != NULL) {
+		return core;
+	}
+	return virtual_cpu.current_core;
+}
+
+/*
+ * stop other cores while shared state is updated(cpuemu.c).
+ * nothing is done on single thread execution.
+ */
+extern void cpuemu_mt_exclusive_enter(void);
+extern void cpuemu_mt_exclusive_leave(void);
+
+static inline bool virtual_cpu_cached_code_has_pc(const CachedOperationCodeType *cached_code, uint32 pc)
+{
+	return ((pc >= cached_code->code_start_addr) && ((pc - cached_code->code_start_addr) < cached_code->code_size));
+}
+
+static inline CachedOperationCodeType *virtual_cpu_search_cached_code(uint32 pc)
+{
+	uint32 low = 0U;
+	uint32 high = virtual_cpu.cached_code_num;
+	uint32 mid;
+
+	/*
+	 * search the last region whose code_start_addr <= pc.
+	 */
+	while (low < high) {
+		mid = low + ((high - low) / 2U);
+		if (virtual_cpu.cached_code[mid]->code_start_addr <= pc) {
+			low = mid + 1U;
+		}
+		else {
+			high = mid;
+		}
+	}
+	/*
+	 * regions may overlap, so check lower regions too.
+	 */
+	while (low > 0U) {
+		low--;
+		if (virtual_cpu_cached_code_has_pc(virtual_cpu.cached_code[low], pc)) {
+			return virtual_cpu.cached_code[low];
+		}
+	}
+	return NULL;
+}
+
 static inline CachedOperationCodeType *virtual_cpu_get_cached_code(uint32 pc)
 {
-	uint32 i;
-	static CachedOperationCodeType *last = NULL;
+	CpuCoreType *core = virtual_cpu_get_current_core();
+	CachedOperationCodeType *cached_code;
+
+	if (core == NULL) {
+		return virtual_cpu_search_cached_code(pc);
+	}
+	cached_code = core->last_cached_code;
+	if ((cached_code != NULL) && virtual_cpu_cached_code_has_pc(cached_code, pc)) {
+		return cached_code;
+	}
+	cached_code = virtual_cpu_search_cached_code(pc);
+	if (cached_code != NULL) {
+		core->last_cached_code = cached_code;
+	}
+	return cached_code;
+}
 
-	if (last != NULL) {
-		if ((pc >= last->code_start_addr) && (pc < (last->code_start_addr + last->code_size))) {
-			return last;
+/*
+ * write tracking of decoded code(mpu.c).
+ */
+extern void mpu_address_set_code_page(uint32 addr, uint32 size);
+
+static inline CpuOperationCodeType *virtual_cpu_cached_code_alloc_page(CachedOperationCodeType *cached_code, uint32 page)
+{
+	uint32 off = (page << CACHED_CODE_PAGE_SHIFT);
+	uint32 size = cached_code->code_size - off;
+	CpuOperationCodeType *codes;
+
+	cpuemu_mt_exclusive_enter();
+	codes = cached_code->pages[page];
+	if (codes == NULL) {
+		/*
+		 * other core may allocate the page before exclusive section.
+		 */
+#ifdef CPU_CONFIG_CACHED_CODE_DENSE
+		codes = &cached_code->codes[off];
+#else
+		codes = calloc(CACHED_CODE_PAGE_OP_NUM, sizeof(CpuOperationCodeType));
+		ASSERT(codes != NULL);
+#endif /* CPU_CONFIG_CACHED_CODE_DENSE */
+		cached_code->pages[page] = codes;
+		cached_code->alloc_page_num++;
+
+		if (size > CACHED_CODE_PAGE_SIZE) {
+			size = CACHED_CODE_PAGE_SIZE;
 		}
+		mpu_address_set_code_page(cached_code->code_start_addr + off, size);
 	}
+	cpuemu_mt_exclusive_leave();
+	return codes;
+}
 
+/*
+ * pc must be in the cached_code region.
+ */
+static inline CpuOperationCodeType *virtual_cpu_get_cached_opcode(CachedOperationCodeType *cached_code, uint32 pc)
+{
+	uint32 off = (pc - cached_code->code_start_addr);
+	uint32 page = (off >> CACHED_CODE_PAGE_SHIFT);
+	CpuOperationCodeType *codes = cached_code->pages[page];
+
+	if (codes == NULL) {
+		codes = virtual_cpu_cached_code_alloc_page(cached_code, page);
+	}
+	return &codes[CACHED_CODE_PAGE_OP_INDEX(off)];
+}
+
+/*
+ * returns decoded entry of pc, or NULL if pc is not in cached code.
+ */
+static inline CpuOperationCodeType *virtual_cpu_get_opcode(uint32 pc)
+{
+	CachedOperationCodeType *cached_code = virtual_cpu_get_cached_code(pc);
+
+	if (cached_code == NULL) {
+		return NULL;
+	}
+	return virtual_cpu_get_cached_opcode(cached_code, pc);
+}
+
+#ifdef CPU_CONFIG_BLOCK_EXEC_SUPPORT
+/*
+ * returns decoded entry of next_pc which is executed after op(at pc).
+ *
+ * inside a block, next entry is found by op_size without region search.
+ * on a block end, successor is searched in links and linked on miss.
+ * entries whose op_size is not set by decoder are searched by next_pc.
+ */
+static inline CpuOperationCodeType *virtual_cpu_block_next(CpuOperationCodeType *op, uint32 pc, uint32 next_pc)
+{
+	CpuOperationCodeType *next;
+
+	if (op->is_block_end == FALSE) {
+		/*
+		 * op is in the last hit region of current core(decoded by virtual_cpu_get_opcode()).
+		 * pages are allocated per CACHED_CODE_PAGE_SIZE from code_start_addr.
+		 */
+		CachedOperationCodeType *cached_code = virtual_cpu_get_current_core()->last_cached_code;
+		if ((op->op_size != 0U) && (next_pc == (pc + op->op_size)) && (cached_code != NULL) &&
+				virtual_cpu_cached_code_has_pc(cached_code, next_pc) &&
+				(((pc - cached_code->code_start_addr) >> CACHED_CODE_PAGE_SHIFT) ==
+				 ((next_pc - cached_code->code_start_addr) >> CACHED_CODE_PAGE_SHIFT))) {
+			return &op[op->op_size >> CACHED_CODE_OP_SHIFT];
+		}
+		return virtual_cpu_get_opcode(next_pc);
+	}
+	if (op->link[0].op != NULL) {
+		if (op->link[0].pc == next_pc) {
+			return op->link[0].op;
+		}
+		if ((op->link[1].op != NULL) && (op->link[1].pc == next_pc)) {
+			next = op->link[1].op;
+			op->link[1] = op->link[0];
+			op->link[0].pc = next_pc;
+			op->link[0].op = next;
+			return next;
+		}
+	}
+	next = virtual_cpu_get_opcode(next_pc);
+	if (next != NULL) {
+		op->link[1] = op->link[0];
+		op->link[0].pc = next_pc;
+		op->link[0].op = next;
+	}
+	return next;
+}
+#endif /* CPU_CONFIG_BLOCK_EXEC_SUPPORT */
+
+/*
+ * mark decoded entries which overlap [addr, addr + size) as dirty.
+ */
+static inline void virtual_cpu_cached_code_invalidate(uint32 addr, uint32 size)
+{
+	uint32 i;
+	uint64 start = addr;
+	uint64 end = (uint64)addr + (uint64)size;
+	uint64 off;
+	uint64 off_end;
+	CachedOperationCodeType *cached_code;
+	CpuOperationCodeType *codes;
+
+	if (start >= (VIRTUAL_CPU_OPCODE_MAX_SIZE - 2U)) {
+		start -= (VIRTUAL_CPU_OPCODE_MAX_SIZE - 2U);
+	}
+	else {
+		start = 0U;
+	}
 	for (i = 0; i < virtual_cpu.cached_code_num; i++) {
-		if (pc < virtual_cpu.cached_code[i]->code_start_addr) {
+		cached_code = virtual_cpu.cached_code[i];
+		if ((end <= cached_code->code_start_addr) ||
+				(start >= ((uint64)cached_code->code_start_addr + cached_code->code_size))) {
 			continue;
 		}
-		else if (pc >= (virtual_cpu.cached_code[i]->code_start_addr + virtual_cpu.cached_code[i]->code_size)) {
-			continue;
+		off = (start > cached_code->code_start_addr) ? (start - cached_code->code_start_addr) : 0U;
+		off_end = end - cached_code->code_start_addr;
+		if (off_end > cached_code->code_size) {
+			off_end = cached_code->code_size;
+		}
+		off &= ~((uint64)(CACHED_CODE_OP_ALIGN - 1U));
+		while (off < off_end) {
+			codes = cached_code->pages[off >> CACHED_CODE_PAGE_SHIFT];
+			if (codes == NULL) {
+				/*
+				 * not decoded page: skip to next page
+				 */
+				off = ((off >> CACHED_CODE_PAGE_SHIFT) + 1U) << CACHED_CODE_PAGE_SHIFT;
+				continue;
+			}
+			codes[CACHED_CODE_PAGE_OP_INDEX(off)].op_exec = NULL;
+			codes[CACHED_CODE_PAGE_OP_INDEX(off)].is_dirty = TRUE;
+			off += CACHED_CODE_OP_ALIGN;
 		}
-		last = virtual_cpu.cached_code[i];
-		return virtual_cpu.cached_code[i];
 	}
-	/*
-	 * not reached.
-	 */
-	return NULL;
+	return;
+}
+
+typedef struct {
+	uint32	page_num;
+	uint32	alloc_page_num;
+	uint64	alloc_size; /* byte */
+} CachedOperationCodeStatType;
+
+static inline void virtual_cpu_get_cached_code_stat(CachedOperationCodeStatType *stat)
+{
+	uint32 i;
+
+	stat->page_num = 0U;
+	stat->alloc_page_num = 0U;
+	stat->alloc_size = 0U;
+	for (i = 0; i < virtual_cpu.cached_code_num; i++) {
+		stat->page_num += virtual_cpu.cached_code[i]->page_num;
+		stat->alloc_page_num += virtual_cpu.cached_code[i]->alloc_page_num;
+#ifdef CPU_CONFIG_CACHED_CODE_DENSE
+		stat->alloc_size += ((uint64)virtual_cpu.cached_code[i]->code_size) * sizeof(CpuOperationCodeType);
+#endif /* CPU_CONFIG_CACHED_CODE_DENSE */
+	}
+#ifndef CPU_CONFIG_CACHED_CODE_DENSE
+	stat->alloc_size = ((uint64)stat->alloc_page_num) * CACHED_CODE_PAGE_OP_NUM * sizeof(CpuOperationCodeType);
+#endif /* CPU_CONFIG_CACHED_CODE_DENSE */
+	return;
 }
 
 static inline void virtual_cpu_add_cached_code(CachedOperationCodeType *cached_code)
 {
+	uint32 i;
+
 	virtual_cpu.cached_code_num++;
 	virtual_cpu.cached_code = realloc(virtual_cpu.cached_code, virtual_cpu.cached_code_num * (sizeof (CachedOperationCodeType*)));
 	ASSERT(virtual_cpu.cached_code != NULL);
-	virtual_cpu.cached_code[virtual_cpu.cached_code_num - 1] = cached_code;
+	/*
+	 * insert sort by code_start_addr.
+	 */
+	for (i = virtual_cpu.cached_code_num - 1; i > 0; i--) {
+		if (virtual_cpu.cached_code[i - 1]->code_start_addr <= cached_code->code_start_addr) {
+			break;
+		}
+		virtual_cpu.cached_code[i] = virtual_cpu.cached_code[i - 1];
+	}
+	virtual_cpu.cached_code[i] = cached_code;
 	return;
 }
 /*
@@ -91,16 +408,35 @@ static inline void virtual_cpu_add_cached_code(CachedOperationCodeType *cached_c
 static inline void virtual_cpu_cache_code_add_with_check(uint32 memsz, uint32 start_addr)
 {
 	CachedOperationCodeType *cached_code = virtual_cpu_get_cached_code(start_addr);
+#ifdef CPU_CONFIG_CACHED_CODE_DENSE
+	uint32 page;
+#endif /* CPU_CONFIG_CACHED_CODE_DENSE */
+
 	if (cached_code != NULL) {
 		return;
 	}
 
 	cached_code = athrill_mem_alloc(sizeof(CachedOperationCodeType));
 	ASSERT(cached_code != NULL);
-	cached_code->codes = calloc(memsz, sizeof(CpuOperationCodeType));
-	ASSERT(cached_code->codes != NULL);
 	cached_code->code_start_addr = start_addr;
 	cached_code->code_size = (memsz);
+#ifdef CPU_CONFIG_CACHED_CODE_DENSE
+	cached_code->codes = calloc(memsz, sizeof(CpuOperationCodeType));
+	ASSERT(cached_code->codes != NULL);
+#else
+	cached_code->codes = NULL;
+#endif /* CPU_CONFIG_CACHED_CODE_DENSE */
+	cached_code->page_num = ((memsz + (CACHED_CODE_PAGE_SIZE - 1U)) >> CACHED_CODE_PAGE_SHIFT);
+	cached_code->alloc_page_num = 0U;
+	cached_code->pages = calloc(cached_code->page_num, sizeof(CpuOperationCodeType*));
+	ASSERT(cached_code->pages != NULL);
+#ifdef CPU_CONFIG_CACHED_CODE_DENSE
+	for (page = 0U; page < cached_code->page_num; page++) {
+		cached_code->pages[page] = &cached_code->codes[page << CACHED_CODE_PAGE_SHIFT];
+	}
+	cached_code->alloc_page_num = cached_code->page_num;
+	mpu_address_set_code_page(start_addr, memsz);
+#endif /* CPU_CONFIG_CACHED_CODE_DENSE */
 
 	virtual_cpu_add_cached_code(cached_code);
 	return;
@@ -17,6 +17,8 @@
 #include "dwarf/data_type/elf_dwarf_data_type.h"
 #include <string.h>
 #include "file.h"
+#include "snapshot.h"
+#include "athrill_device.h"
 #ifdef OS_LINUX
 #include <sys/time.h>
 #endif /* OS_LINUX */
@@ -438,6 +440,60 @@ void dbg_std_executor_list(void *executor)
 	return;
 }
 
+void dbg_std_executor_snapshot(void *executor)
+{
+	Std_ReturnType err;
+	DbgCmdExecutorType *arg = (DbgCmdExecutorType *)executor;
+	DbgCmdExecutorSnapshotType *parsed_args = (DbgCmdExecutorSnapshotType *)(arg->parsed_args);
+
+	if (parsed_args->type == DBG_CMD_SNAPSHOT_SAVE) {
+		err = snapshot_save((const char*)parsed_args->path.str);
+	}
+	else {
+		err = snapshot_load((const char*)parsed_args->path.str);
+	}
+	if (err != STD_E_OK) {
+		CUI_PRINTF((CPU_PRINT_BUF(), CPU_PRINT_BUF_LEN(), "NG\n"));
+		return;
+	}
+	CUI_PRINTF((CPU_PRINT_BUF(), CPU_PRINT_BUF_LEN(), "OK\n"));
+	return;
+}
+
+void dbg_std_executor_syscall(void *executor)
+{
+	DbgCmdExecutorType *arg = (DbgCmdExecutorType *)executor;
+	DbgCmdExecutorSyscallType *parsed_args = (DbgCmdExecutorSyscallType *)(arg->parsed_args);
+	AthrillSyscallStatType stat;
+	uint32 api_id;
+
+	if (parsed_args->type == DBG_CMD_SYSCALL_CLEAR) {
+		athrill_syscall_stat_clear();
+		CUI_PRINTF((CPU_PRINT_BUF(), CPU_PRINT_BUF_LEN(), "OK\n"));
+		return;
+	}
+	else if (parsed_args->type == DBG_CMD_SYSCALL_DUMP) {
+		if (athrill_syscall_stat_dump((const char*)parsed_args->path.str) != STD_E_OK) {
+			CUI_PRINTF((CPU_PRINT_BUF(), CPU_PRINT_BUF_LEN(), "NG\n"));
+			return;
+		}
+		CUI_PRINTF((CPU_PRINT_BUF(), CPU_PRINT_BUF_LEN(), "OK\n"));
+		return;
+	}
+	CUI_PRINTF((CPU_PRINT_BUF(), CPU_PRINT_BUF_LEN(), "%-16s %-10s %-12s %-12s %-12s %-15s\n",
+			"api", "count", "bytes", "avg_ns", "max_ns", "guest_clocks"));
+	for (api_id = 0; athrill_syscall_stat_get(api_id, &stat) == STD_E_OK; api_id++) {
+		if (stat.count == 0) {
+			continue;
+		}
+		CUI_PRINTF((CPU_PRINT_BUF(), CPU_PRINT_BUF_LEN(),
+				"%-16s %-10"FMT_UINT64" %-12"FMT_UINT64" %-12"FMT_UINT64" %-12"FMT_UINT64" %-15"FMT_UINT64"\n",
+				athrill_syscall_stat_name(api_id), stat.count, stat.bytes,
+				stat.total_ns / stat.count, stat.max_ns, stat.guest_clocks));
+	}
+	return;
+}
+
 void dbg_std_executor_exit(void *executor)
 {
 	cpuctrl_set_debug_mode(TRUE);
@@ -469,6 +525,8 @@ printf("loops "PRINT_FMT_UINT64" intc "PRINT_FMT_UINT64" real_time  %ld.%06d\n",
 #else
 	printf("loops "PRINT_FMT_UINT64" intc "PRINT_FMT_UINT64"\n", elaps.total_clocks, elaps.intr_clocks);
 #endif /* OS_LINUX */
+	printf("decode cache pages %u/%u size "PRINT_FMT_UINT64" KB\n",
+			elaps.cached_code_alloc_page_num, elaps.cached_code_page_num, elaps.cached_code_alloc_size / 1024);
 	CUI_PRINTF((CPU_PRINT_BUF(), CPU_PRINT_BUF_LEN(), PRINT_FMT_UINT64 " " PRINT_FMT_UINT64 "  OK", elaps.total_clocks, elaps.cpu_clocks[0]));
 	return;
 }
@@ -710,6 +710,111 @@ DbgCmdExecutorType *dbg_parse_list(DbgCmdExecutorType *arg, const TokenContainer
 	}
 	return NULL;
 }
+
+/************************************************************************************
+ * snapshot コマンド
+ *
+ *
+ ***********************************************************************************/
+static const TokenStringType snapshot_string = {
+		.len = 8,
+		.str = { 's', 'n', 'a', 'p', 's', 'h', 'o', 't', '\0' },
+};
+static const TokenStringType snapshot_save_string = {
+		.len = 4,
+		.str = { 's', 'a', 'v', 'e', '\0' },
+};
+static const TokenStringType snapshot_load_string = {
+		.len = 4,
+		.str = { 'l', 'o', 'a', 'd', '\0' },
+};
+DbgCmdExecutorType *dbg_parse_snapshot(DbgCmdExecutorType *arg, const TokenContainerType *token_container)
+{
+	DbgCmdExecutorSnapshotType *parsed_args = (DbgCmdExecutorSnapshotType *)arg->parsed_args;
+
+	if (token_container->num != 3) {
+		return NULL;
+	}
+
+	if ((token_container->array[0].type != TOKEN_TYPE_STRING) || (token_container->array[1].type != TOKEN_TYPE_STRING)) {
+		return NULL;
+	}
+	if (token_strcmp(&token_container->array[0].body.str, &snapshot_string) == FALSE) {
+		return NULL;
+	}
+
+	if (token_strcmp(&token_container->array[1].body.str, &snapshot_save_string) == TRUE) {
+		parsed_args->type = DBG_CMD_SNAPSHOT_SAVE;
+	}
+	else if (token_strcmp(&token_container->array[1].body.str, &snapshot_load_string) == TRUE) {
+		parsed_args->type = DBG_CMD_SNAPSHOT_LOAD;
+	}
+	else {
+		return NULL;
+	}
+	arg->std_id = DBG_CMD_STD_ID_SNAPSHOT;
+	arg->run = dbg_std_executor_snapshot;
+	parsed_args->path.len = 0;
+	(void)token_split_merge(token_container, 2, &parsed_args->path);
+	token_trim_newline(&parsed_args->path);
+	parsed_args->path.str[parsed_args->path.len] = '\0';
+	return arg;
+}
+
+/************************************************************************************
+ * syscall コマンド
+ *
+ *
+ ***********************************************************************************/
+static const TokenStringType syscall_string = {
+		.len = 7,
+		.str = { 's', 'y', 's', 'c', 'a', 'l', 'l', '\0' },
+};
+static const TokenStringType syscall_clear_string = {
+		.len = 5,
+		.str = { 'c', 'l', 'e', 'a', 'r', '\0' },
+};
+static const TokenStringType syscall_dump_string = {
+		.len = 4,
+		.str = { 'd', 'u', 'm', 'p', '\0' },
+};
+DbgCmdExecutorType *dbg_parse_syscall(DbgCmdExecutorType *arg, const TokenContainerType *token_container)
+{
+	DbgCmdExecutorSyscallType *parsed_args = (DbgCmdExecutorSyscallType *)arg->parsed_args;
+
+	if ((token_container->num < 1) || (token_container->num > 3)) {
+		return NULL;
+	}
+	if (token_container->array[0].type != TOKEN_TYPE_STRING) {
+		return NULL;
+	}
+	if (token_strcmp(&token_container->array[0].body.str, &syscall_string) == FALSE) {
+		return NULL;
+	}
+
+	if (token_container->num == 1) {
+		parsed_args->type = DBG_CMD_SYSCALL_SHOW;
+	}
+	else if (token_container->array[1].type != TOKEN_TYPE_STRING) {
+		return NULL;
+	}
+	else if ((token_container->num == 2) && (token_strcmp(&token_container->array[1].body.str, &syscall_clear_string) == TRUE)) {
+		parsed_args->type = DBG_CMD_SYSCALL_CLEAR;
+	}
+	else if ((token_container->num == 3) && (token_strcmp(&token_container->array[1].body.str, &syscall_dump_string) == TRUE)) {
+		parsed_args->type = DBG_CMD_SYSCALL_DUMP;
+		parsed_args->path.len = 0;
+		(void)token_split_merge(token_container, 2, &parsed_args->path);
+		token_trim_newline(&parsed_args->path);
+		parsed_args->path.str[parsed_args->path.len] = '\0';
+	}
+	else {
+		return NULL;
+	}
+	arg->std_id = DBG_CMD_STD_ID_SYSCALL;
+	arg->run = dbg_std_executor_syscall;
+	return arg;
+}
 /************************************************************************************
  * exit コマンド
  *
@@ -1240,6 +1345,40 @@ static const DbgCmdHelpType help_list = {
 							},
 					},
 			},
+			{
+					.name = &snapshot_string,
+					.name_shortcut = NULL,
+					.opt_num = 2,
+					.opts = {
+							{
+									.semantics = "snapshot save <file>",
+									.description = "save the machine state on <file>",
+							},
+							{
+									.semantics = "snapshot load <file>",
+									.description = "restore the machine state from <file>",
+							},
+					},
+			},
+			{
+					.name = &syscall_string,
+					.name_shortcut = NULL,
+					.opt_num = 3,
+					.opts = {
+							{
+									.semantics = "syscall",
+									.description = "show call count, bytes, host latency and guest clocks of each syscall api",
+							},
+							{
+									.semantics = "syscall clear",
+									.description = "clear syscall statistics",
+							},
+							{
+									.semantics = "syscall dump <file>",
+									.description = "write syscall statistics with latency histogram on <file>(json if *.json, otherwise csv)",
+							},
+					},
+			},
 			{
 					.name = &help_string,
 					.name_shortcut = NULL,
@@ -135,6 +135,27 @@ extern DbgCmdExecutorType *dbg_parse_intr(DbgCmdExecutorType *arg, const TokenCo
 
 extern DbgCmdExecutorType *dbg_parse_list(DbgCmdExecutorType *arg, const TokenContainerType *token_container);
 
+typedef enum {
+	DBG_CMD_SNAPSHOT_SAVE,
+	DBG_CMD_SNAPSHOT_LOAD,
+} DbgCmdSnapshotType;
+typedef struct {
+	DbgCmdSnapshotType	type;
+	TokenStringType		path;
+} DbgCmdExecutorSnapshotType;
+extern DbgCmdExecutorType *dbg_parse_snapshot(DbgCmdExecutorType *arg, const TokenContainerType *token_container);
+
+typedef enum {
+	DBG_CMD_SYSCALL_SHOW,
+	DBG_CMD_SYSCALL_CLEAR,
+	DBG_CMD_SYSCALL_DUMP,
+} DbgCmdSyscallType;
+typedef struct {
+	DbgCmdSyscallType	type;
+	TokenStringType		path;
+} DbgCmdExecutorSyscallType;
+extern DbgCmdExecutorType *dbg_parse_syscall(DbgCmdExecutorType *arg, const TokenContainerType *token_container);
+
 
 #define DBG_CMD_ARG_TYPES_MAX	3U
 typedef struct {
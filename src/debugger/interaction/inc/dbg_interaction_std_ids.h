@@ -24,6 +24,8 @@ typedef enum {
 	DBG_CMD_STD_ID_BACK_TRACE,
 	DBG_CMD_STD_ID_PROFILE,
 	DBG_CMD_STD_ID_LIST,
+	DBG_CMD_STD_ID_SNAPSHOT,
+	DBG_CMD_STD_ID_SYSCALL,
 	DBG_CMD_STD_ID_HELP,
 	DBG_CMD_STD_ID_TARGET
 } DbgCmdStdIdType;
@@ -28,6 +28,7 @@ Std_ReturnType binary_load(uint8 *binary_data, uint32 load_addr, uint32 binary_d
 	}
 
 	memcpy(data, binary_data, binary_data_len);
+	mpu_address_notify_host_write(load_addr, binary_data_len);
 
 	return STD_E_OK;
 }
@@ -186,11 +187,6 @@ static Std_ReturnType Elf_LoadProgram(const Elf32_Ehdr *elf_image, MemoryAddress
 		}
 		set_cache_code_from_map(&memap->ram[i]);
 	}
-	for (i = 0; i < memap->ram_num; i++) {
-		if (memap->ram[i].type == MemoryAddressImplType_MALLOC) {
-			set_malloc_region(memap, i);
-		}
-	}
 	for (i = 0; i < memap->dev_num; i++) {
 		ptr = mpu_address_set_dev(memap->dev[i].start, memap->dev[i].size, memap->dev[i].extdev_handle);
 		if (ptr == NULL) {
@@ -198,6 +194,24 @@ static Std_ReturnType Elf_LoadProgram(const Elf32_Ehdr *elf_image, MemoryAddress
 			return STD_E_INVALID;
 		}
 	}
+#ifdef OS_LINUX
+	if (device_set_athrill_doorbell() != STD_E_OK) {
+		printf("Invalid athrill doorbell: can not set doorbell\n");
+		return STD_E_INVALID;
+	}
+#endif /* OS_LINUX */
+	/*
+	 * malloc units refer regions: must be set after all regions are added.
+	 */
+	for (i = 0; i < memap->ram_num; i++) {
+		if (memap->ram[i].type == MemoryAddressImplType_MALLOC) {
+			set_malloc_region(memap, i);
+		}
+	}
+	/*
+	 * build guest page table from allocated memory regions.
+	 */
+	mpu_address_map_build();
 	/*
 	 * set cache from elf file.
 	 */
@@ -42,7 +42,7 @@ static inline bool has_permission(MpuAddressRegionType *region, CoreIdType core_
 }
 #endif
 
-static inline MpuAddressRegionType *search_region(CoreIdType core_id, uint32 addr, uint32 search_size)
+static MpuAddressRegionType *search_region_linear(CoreIdType core_id, uint32 addr, uint32 search_size)
 {
 	uint32 i;
 
@@ -103,6 +103,410 @@ static inline MpuAddressRegionType *search_region(CoreIdType core_id, uint32 add
 	return NULL;
 }
 
+MpuAddressPageTableType	mpu_address_page_table;
+
+/*
+ * check intersection of the guest page with the region.
+ * the region is mapped on [start, end) after address masked.
+ */
+static inline bool page_intersects_region(const MpuAddressRegionType *region, uint32 page_addr)
+{
+	uint64 start = region->start;
+	uint64 end = (uint64)region->start + (uint64)region->size;
+	uint64 pstart;
+
+	if ((region->mask & MPU_ADDRESS_PAGE_OFFSET_MASK) != MPU_ADDRESS_PAGE_OFFSET_MASK) {
+		/*
+		 * page is scattered by the mask, so treat it as intersected.
+		 */
+		return TRUE;
+	}
+	pstart = (page_addr & region->mask);
+	return ((pstart < end) && ((pstart + MPU_ADDRESS_PAGE_SIZE) > start));
+}
+static inline bool page_covered_by_region(const MpuAddressRegionType *region, uint32 page_addr)
+{
+	uint64 start = region->start;
+	uint64 end = (uint64)region->start + (uint64)region->size;
+	uint64 pstart;
+
+	if ((region->mask & MPU_ADDRESS_PAGE_OFFSET_MASK) != MPU_ADDRESS_PAGE_OFFSET_MASK) {
+		return FALSE;
+	}
+	pstart = (page_addr & region->mask);
+	return ((start <= pstart) && ((pstart + MPU_ADDRESS_PAGE_SIZE) <= end));
+}
+
+/*
+ * the page can be mapped only if the region covers whole page
+ * and any other region does not intersect it.
+ */
+static MpuAddressRegionType *page_search_exclusive_region(uint32 page_addr)
+{
+	uint32 i;
+	MpuAddressRegionType *found = NULL;
+
+	for (i = 0U; i < mpu_address_map.dynamic_map_num; i++) {
+		if (page_intersects_region(&mpu_address_map.dynamic_map[i], page_addr) == FALSE) {
+			continue;
+		}
+		if (found != NULL) {
+			return NULL;
+		}
+		found = &mpu_address_map.dynamic_map[i];
+	}
+	for (i = 0U; i < MPU_CONFIG_REGION_NUM; i++) {
+		if (mpu_address_map.map[i].size == 0U) {
+			continue;
+		}
+		if (page_intersects_region(&mpu_address_map.map[i], page_addr) == FALSE) {
+			continue;
+		}
+		if (found != NULL) {
+			return NULL;
+		}
+		found = &mpu_address_map.map[i];
+	}
+	if ((found == NULL) || (page_covered_by_region(found, page_addr) == FALSE)) {
+		return NULL;
+	}
+	if ((found->is_malloc != FALSE) && (found->data == NULL)) {
+		/*
+		 * MALLOC not malloced region
+		 */
+		return NULL;
+	}
+	return found;
+}
+
+static MpuAddressPageEntryType *page_fill(uint32 addr)
+{
+	MpuAddressPageEntryType *l2;
+	MpuAddressPageEntryType *entry;
+	MpuAddressRegionType *region;
+	uint32 page_addr = (addr & ~MPU_ADDRESS_PAGE_OFFSET_MASK);
+
+	l2 = mpu_address_page_table.l1[MPU_ADDRESS_PAGE_L1_INDEX(addr)];
+	if (l2 == NULL) {
+		l2 = calloc(MPU_ADDRESS_PAGE_L2_NUM, sizeof(MpuAddressPageEntryType));
+		ASSERT(l2 != NULL);
+		mpu_address_page_table.l1[MPU_ADDRESS_PAGE_L1_INDEX(addr)] = l2;
+	}
+	entry = &l2[MPU_ADDRESS_PAGE_L2_INDEX(addr)];
+
+	region = page_search_exclusive_region(page_addr);
+	if (region == NULL) {
+		entry->state = MpuAddressPageState_SLOWPATH;
+		entry->region = NULL;
+		entry->host_base = NULL;
+		return entry;
+	}
+	entry->state = MpuAddressPageState_MAPPED;
+	entry->region = region;
+	if ((region->ops == &default_memory_operation) && (region->data != NULL)) {
+		entry->host_base = &region->data[(page_addr & region->mask) - region->start];
+	}
+	else {
+		entry->host_base = NULL;
+	}
+	return entry;
+}
+
+MpuAddressPageEntryType *mpu_address_page_fill(uint32 addr)
+{
+	MpuAddressPageEntryType *entry;
+
+	/*
+	 * other cores must not see the entry while it is updated.
+	 */
+	cpuemu_mt_exclusive_enter();
+	entry = page_fill(addr);
+	cpuemu_mt_exclusive_leave();
+	return entry;
+}
+
+MpuAddressTlbType	mpu_address_tlb[CPU_CONFIG_CORE_NUM];
+
+/*
+ * bitmap of guest pages which have decoded code.
+ */
+#define MPU_ADDRESS_CODE_PAGE_NUM	(1U << (32U - MPU_ADDRESS_PAGE_SHIFT))
+static uint32 mpu_address_code_page_bitmap[MPU_ADDRESS_CODE_PAGE_NUM / 32U];
+
+static inline bool is_code_page(uint32 addr)
+{
+	uint32 page = (addr >> MPU_ADDRESS_PAGE_SHIFT);
+	return ((mpu_address_code_page_bitmap[page / 32U] & (1U << (page % 32U))) != 0U);
+}
+static inline bool has_code_page(uint32 addr, uint32 size)
+{
+	uint32 page_addr = (addr & ~MPU_ADDRESS_PAGE_OFFSET_MASK);
+	uint32 page_end;
+
+	if (size == 0U) {
+		return FALSE;
+	}
+	page_end = ((addr + (size - 1U)) & ~MPU_ADDRESS_PAGE_OFFSET_MASK);
+	while (TRUE) {
+		if (is_code_page(page_addr)) {
+			return TRUE;
+		}
+		if (page_addr == page_end) {
+			break;
+		}
+		page_addr += MPU_ADDRESS_PAGE_SIZE;
+	}
+	return FALSE;
+}
+
+/*
+ * write hooks: called after cpu stores on [addr, addr + size).
+ * the pages are not cached by write TLB, so all stores are checked by mpu_put_dataX().
+ */
+#define MPU_ADDRESS_WRITE_HOOK_NUM	8U
+typedef struct {
+	uint32						addr;
+	uint32						size;
+	MpuAddressWriteHookType		hook;
+} MpuAddressWriteHookEntryType;
+static uint32 mpu_address_write_hook_num = 0U;
+static MpuAddressWriteHookEntryType mpu_address_write_hook[MPU_ADDRESS_WRITE_HOOK_NUM];
+
+static inline bool is_hook_page(uint32 addr)
+{
+	uint32 i;
+	uint32 page_addr = (addr & ~MPU_ADDRESS_PAGE_OFFSET_MASK);
+
+	for (i = 0U; i < mpu_address_write_hook_num; i++) {
+		if ((mpu_address_write_hook[i].addr & ~MPU_ADDRESS_PAGE_OFFSET_MASK) == page_addr) {
+			return TRUE;
+		}
+		if (((mpu_address_write_hook[i].addr + (mpu_address_write_hook[i].size - 1U)) & ~MPU_ADDRESS_PAGE_OFFSET_MASK) == page_addr) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+void mpu_address_tlb_invalidate(CoreIdType core_id)
+{
+	if (core_id >= CPU_CONFIG_CORE_NUM) {
+		return;
+	}
+	memset(&mpu_address_tlb[core_id], 0, sizeof(MpuAddressTlbType));
+	return;
+}
+
+/*
+ * entry must be resolved by search_region() before calling this function.
+ */
+static inline void tlb_fill(CoreIdType core_id, uint32 addr, bool is_write)
+{
+#ifdef MPU_ADDRESS_TLB_ENABLE
+	MpuAddressPageEntryType *entry = mpu_address_page_get(addr);
+	MpuAddressTlbEntryType *tlb;
+
+	if ((core_id >= CPU_CONFIG_CORE_NUM) || (entry->host_base == NULL)) {
+		return;
+	}
+	if (is_write == FALSE) {
+		tlb = &mpu_address_tlb[core_id].read[MPU_ADDRESS_TLB_INDEX(addr)];
+	}
+	else if ((entry->region->type == READONLY_MEMORY) || is_code_page(addr) || is_hook_page(addr)) {
+		/*
+		 * writes on the code page and hooked page must be checked by mpu_put_dataX().
+		 */
+		return;
+	}
+	else {
+		tlb = &mpu_address_tlb[core_id].write[MPU_ADDRESS_TLB_INDEX(addr)];
+	}
+	tlb->tag = MPU_ADDRESS_TLB_TAG(addr);
+	tlb->host_base = entry->host_base;
+#endif /* MPU_ADDRESS_TLB_ENABLE */
+	return;
+}
+
+void mpu_address_set_code_page(uint32 addr, uint32 size)
+{
+	uint32 page_addr = (addr & ~MPU_ADDRESS_PAGE_OFFSET_MASK);
+	uint32 page_end;
+	uint32 page;
+	CoreIdType core_id;
+
+	if (size == 0U) {
+		return;
+	}
+	page_end = ((addr + (size - 1U)) & ~MPU_ADDRESS_PAGE_OFFSET_MASK);
+	/*
+	 * other cores must be stopped while their write TLB entries are cleared,
+	 * otherwise they can keep storing on the code page through the stale entry.
+	 */
+	cpuemu_mt_exclusive_enter();
+	while (TRUE) {
+		page = (page_addr >> MPU_ADDRESS_PAGE_SHIFT);
+		mpu_address_code_page_bitmap[page / 32U] |= (1U << (page % 32U));
+		for (core_id = 0U; core_id < CPU_CONFIG_CORE_NUM; core_id++) {
+			if (mpu_address_tlb[core_id].write[MPU_ADDRESS_TLB_INDEX(page_addr)].tag == MPU_ADDRESS_TLB_TAG(page_addr)) {
+				mpu_address_tlb[core_id].write[MPU_ADDRESS_TLB_INDEX(page_addr)].tag = 0U;
+			}
+		}
+		if (page_addr == page_end) {
+			break;
+		}
+		page_addr += MPU_ADDRESS_PAGE_SIZE;
+	}
+	cpuemu_mt_exclusive_leave();
+	return;
+}
+
+/*
+ * decoded entries can be read by other cores on multi-thread execution.
+ */
+static void code_invalidate(uint32 addr, uint32 size)
+{
+	cpuemu_mt_exclusive_enter();
+	virtual_cpu_cached_code_invalidate(addr, size);
+	cpuemu_mt_exclusive_leave();
+	return;
+}
+
+void mpu_address_notify_host_write(uint32 addr, uint32 size)
+{
+	if (has_code_page(addr, size)) {
+		code_invalidate(addr, size);
+	}
+	return;
+}
+
+Std_ReturnType mpu_address_set_write_hook(uint32 addr, uint32 size, MpuAddressWriteHookType hook)
+{
+	CoreIdType core_id;
+
+	if ((size == 0U) || (size > MPU_ADDRESS_PAGE_SIZE)) {
+		return STD_E_INVALID;
+	}
+	if (mpu_address_write_hook_num >= MPU_ADDRESS_WRITE_HOOK_NUM) {
+		return STD_E_LIMIT;
+	}
+	mpu_address_write_hook[mpu_address_write_hook_num].addr = addr;
+	mpu_address_write_hook[mpu_address_write_hook_num].size = size;
+	mpu_address_write_hook[mpu_address_write_hook_num].hook = hook;
+	mpu_address_write_hook_num++;
+	for (core_id = 0U; core_id < CPU_CONFIG_CORE_NUM; core_id++) {
+		mpu_address_tlb_invalidate(core_id);
+	}
+	return STD_E_OK;
+}
+
+void mpu_address_clear_write_hook(uint32 addr, MpuAddressWriteHookType hook)
+{
+	uint32 i;
+
+	for (i = 0U; i < mpu_address_write_hook_num; i++) {
+		if ((mpu_address_write_hook[i].addr == addr) && (mpu_address_write_hook[i].hook == hook)) {
+			break;
+		}
+	}
+	if (i >= mpu_address_write_hook_num) {
+		return;
+	}
+	mpu_address_write_hook_num--;
+	for (; i < mpu_address_write_hook_num; i++) {
+		mpu_address_write_hook[i] = mpu_address_write_hook[i + 1U];
+	}
+	return;
+}
+
+static void write_hook(CoreIdType core_id, uint32 addr, uint32 size)
+{
+	uint32 i;
+	MpuAddressWriteHookEntryType *entry;
+
+	for (i = 0U; i < mpu_address_write_hook_num; i++) {
+		entry = &mpu_address_write_hook[i];
+		if ((addr < (entry->addr + entry->size)) && (entry->addr < (addr + size))) {
+			/*
+			 * hooks run as device operations on multi-thread execution.
+			 */
+			cpuemu_mt_exclusive_enter();
+			entry->hook(core_id, entry->addr);
+			cpuemu_mt_exclusive_leave();
+		}
+	}
+	return;
+}
+
+/*
+ * device registers are accessed exclusively on multi-thread execution,
+ * because device operations and interrupt delivery are not thread safe.
+ */
+#define DEVICE_ACCESS_FUNC(name, type)	\
+static Std_ReturnType device_##name(MpuAddressRegionType *region, CoreIdType core_id, uint32 addr, type data)	\
+{	\
+	Std_ReturnType err;	\
+	cpuemu_mt_exclusive_enter();	\
+	err = region->ops->name(region, core_id, addr, data);	\
+	cpuemu_mt_exclusive_leave();	\
+	return err;	\
+}
+DEVICE_ACCESS_FUNC(get_data8, uint8*)
+DEVICE_ACCESS_FUNC(get_data16, uint16*)
+DEVICE_ACCESS_FUNC(get_data32, uint32*)
+DEVICE_ACCESS_FUNC(put_data8, uint8)
+DEVICE_ACCESS_FUNC(put_data16, uint16)
+DEVICE_ACCESS_FUNC(put_data32, uint32)
+
+void mpu_address_map_invalidate(void)
+{
+	uint32 i;
+
+	for (i = 0U; i < MPU_ADDRESS_PAGE_L1_NUM; i++) {
+		if (mpu_address_page_table.l1[i] != NULL) {
+			memset(mpu_address_page_table.l1[i], 0, MPU_ADDRESS_PAGE_L2_NUM * sizeof(MpuAddressPageEntryType));
+		}
+	}
+	for (i = 0U; i < CPU_CONFIG_CORE_NUM; i++) {
+		mpu_address_tlb_invalidate(i);
+	}
+	return;
+}
+
+void mpu_address_map_build(void)
+{
+	uint32 i;
+	uint32 page_addr;
+	uint32 page_end;
+
+	mpu_address_map_invalidate();
+	for (i = 0U; i < mpu_address_map.dynamic_map_num; i++) {
+		if ((mpu_address_map.dynamic_map[i].data == NULL) || (mpu_address_map.dynamic_map[i].size == 0U)) {
+			continue;
+		}
+		page_addr = (mpu_address_map.dynamic_map[i].start & ~MPU_ADDRESS_PAGE_OFFSET_MASK);
+		page_end = ((mpu_address_map.dynamic_map[i].start + (mpu_address_map.dynamic_map[i].size - 1U)) & ~MPU_ADDRESS_PAGE_OFFSET_MASK);
+		while (TRUE) {
+			(void)mpu_address_page_fill(page_addr);
+			if (page_addr == page_end) {
+				break;
+			}
+			page_addr += MPU_ADDRESS_PAGE_SIZE;
+		}
+	}
+	return;
+}
+
+static inline MpuAddressRegionType *search_region(CoreIdType core_id, uint32 addr, uint32 search_size)
+{
+	MpuAddressPageEntryType *entry = mpu_address_page_get(addr);
+
+	if ((entry->state == MpuAddressPageState_MAPPED) &&
+			(((addr & MPU_ADDRESS_PAGE_OFFSET_MASK) + search_size) <= MPU_ADDRESS_PAGE_SIZE)) {
+		return entry->region;
+	}
+	return search_region_linear(core_id, addr, search_size);
+}
+
 static MpuAddressRegionType *mpu_address_search_region(uint32 addr, uint32 size)
 {
 	uint32 i;
@@ -146,6 +550,34 @@ uint8 *mpu_address_get_ram(uint32 addr, uint32 size)
 	return NULL;
 }
 
+/*
+ * start address of MMAP regions: they are backed by host files, and not saved in snapshot.
+ */
+static uint32 mpu_address_mmap_num = 0U;
+static uint32 *mpu_address_mmap_start = NULL;
+
+static bool mpu_address_is_mmap(const MpuAddressRegionType *region)
+{
+	uint32 i;
+
+	for (i = 0U; i < mpu_address_mmap_num; i++) {
+		if (mpu_address_mmap_start[i] == region->start) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+bool mpu_address_is_mmap_memory(uint32 addr, uint32 size)
+{
+	MpuAddressRegionType *region = mpu_address_search_region(addr, size);
+
+	if (region == NULL) {
+		return FALSE;
+	}
+	return mpu_address_is_mmap(region);
+}
+
 uint8 *mpu_address_set_rom_ram(MpuAddressGetType getType, uint32 addr, uint32 size, void *mmap_addr)
 {
 	MpuAddressRegionType *region = NULL;
@@ -180,6 +612,10 @@ uint8 *mpu_address_set_rom_ram(MpuAddressGetType getType, uint32 addr, uint32 si
 				/* MMAP */
 				mpu_address_map.dynamic_map[mpu_address_map.dynamic_map_num -1].type = GLOBAL_MEMORY;
 				mpu_address_map.dynamic_map[mpu_address_map.dynamic_map_num -1].data = mmap_addr;
+				mpu_address_mmap_start = realloc(mpu_address_mmap_start, sizeof(uint32) * (mpu_address_mmap_num + 1U));
+				ASSERT(mpu_address_mmap_start != NULL);
+				mpu_address_mmap_start[mpu_address_mmap_num] = addr;
+				mpu_address_mmap_num++;
 			}
 			else if (getType == MpuAddressGetType_MALLOC) {
 				/* MALLOC */
@@ -195,6 +631,10 @@ uint8 *mpu_address_set_rom_ram(MpuAddressGetType getType, uint32 addr, uint32 si
 		else {
 			ASSERT(mpu_address_map.dynamic_map[mpu_address_map.dynamic_map_num -1].data != NULL);
 		}
+		/*
+		 * dynamic_map may be relocated by realloc.
+		 */
+		mpu_address_map_invalidate();
 		return mpu_address_map.dynamic_map[mpu_address_map.dynamic_map_num -1].data;
 	}
 	else {
@@ -235,6 +675,27 @@ uint8 *mpu_address_set_dev(uint32 addr, uint32 size, void *handler)
 		memset(exdev->datap, 0, size);
 	}
 
+	if (mpu_address_set_device(addr, size, (uint8*)exdev->datap, exdev->ops) == NULL) {
+		return NULL;
+	}
+	/*
+	 * region is resolved by index on device init: dynamic_map is reallocated while loading.
+	 */
+	device_add_athrill_exdev(exdev, mpu_address_map.dynamic_map_num -1);
+	return mpu_address_map.dynamic_map[mpu_address_map.dynamic_map_num -1].data;
+}
+#endif /* OS_LINUX */
+
+uint8 *mpu_address_set_device(uint32 addr, uint32 size, uint8 *data, MpuAddressRegionOperationType *ops)
+{
+	MpuAddressRegionType *region = NULL;
+
+	region = mpu_address_search_region(addr, size);
+	if (region != NULL) {
+		printf("ERROR: addr=0x%x size=%u already found existing region(soff=0x%x size=%u)\n",
+				addr, size, region->start, region->size);
+		return NULL;
+	}
 	mpu_address_map.dynamic_map_num++;
 	mpu_address_map.dynamic_map = realloc(mpu_address_map.dynamic_map, (sizeof(MpuAddressRegionType)) * mpu_address_map.dynamic_map_num);
 	ASSERT(mpu_address_map.dynamic_map != NULL);
@@ -245,13 +706,12 @@ uint8 *mpu_address_set_dev(uint32 addr, uint32 size, void *handler)
 
 	mpu_address_map.dynamic_map[mpu_address_map.dynamic_map_num -1].permission	= MPU_ADDRESS_REGION_PERM_ALL;
 	mpu_address_map.dynamic_map[mpu_address_map.dynamic_map_num -1].mask		= MPU_ADDRESS_REGION_MASK_ALL;
-	mpu_address_map.dynamic_map[mpu_address_map.dynamic_map_num -1].data		= (uint8*)exdev->datap;
-	mpu_address_map.dynamic_map[mpu_address_map.dynamic_map_num -1].ops			= exdev->ops;
+	mpu_address_map.dynamic_map[mpu_address_map.dynamic_map_num -1].data		= data;
+	mpu_address_map.dynamic_map[mpu_address_map.dynamic_map_num -1].ops			= ops;
 
-	device_add_athrill_exdev(exdev, &mpu_address_map.dynamic_map[mpu_address_map.dynamic_map_num -1]);
+	mpu_address_map_invalidate();
 	return mpu_address_map.dynamic_map[mpu_address_map.dynamic_map_num -1].data;
 }
-#endif /* OS_LINUX */
 
 void mpu_address_set_malloc_region(uint32 addr, uint32 size)
 {
@@ -263,9 +723,129 @@ void mpu_address_set_malloc_region(uint32 addr, uint32 size)
 	return;
 }
 
+/*
+ * snapshot: data of all regions.
+ * region layout is built from memory config, so only data is saved.
+ * data of DEVICE regions are saved by devices, and MMAP regions are host files: they are skipped.
+ */
+static MpuAddressRegionType *mpu_address_snapshot_region(uint32 index)
+{
+	if (index < MPU_CONFIG_REGION_NUM) {
+		return &mpu_address_map.map[index];
+	}
+	return &mpu_address_map.dynamic_map[index - MPU_CONFIG_REGION_NUM];
+}
+static bool mpu_address_snapshot_is_skipped(const MpuAddressRegionType *region)
+{
+	return ((region->type == DEVICE) || mpu_address_is_mmap(region));
+}
+
+static Std_ReturnType mpu_address_snapshot_save(SnapshotStreamType *stream, void *arg)
+{
+	uint32 i;
+	Std_ReturnType err;
+	MpuAddressRegionType *region;
+	uint32 num = MPU_CONFIG_REGION_NUM + mpu_address_map.dynamic_map_num;
+	uint8 has_data;
+
+	err = snapshot_write(stream, &num, sizeof(num));
+	for (i = 0U; (err == STD_E_OK) && (i < num); i++) {
+		region = mpu_address_snapshot_region(i);
+		has_data = ((region->data != NULL) && (region->size > 0U) && !mpu_address_snapshot_is_skipped(region));
+		err = snapshot_write(stream, &region->start, sizeof(region->start));
+		if (err == STD_E_OK) {
+			err = snapshot_write(stream, &region->size, sizeof(region->size));
+		}
+		if (err == STD_E_OK) {
+			err = snapshot_write(stream, &has_data, sizeof(has_data));
+		}
+		if ((err == STD_E_OK) && (has_data != FALSE)) {
+			err = snapshot_write(stream, region->data, region->size);
+		}
+	}
+	return err;
+}
+
+static Std_ReturnType mpu_address_snapshot_restore(SnapshotStreamType *stream, void *arg)
+{
+	uint32 i;
+	Std_ReturnType err;
+	MpuAddressRegionType *region;
+	uint32 num;
+	uint32 start;
+	uint32 size;
+	uint8 has_data;
+
+	err = snapshot_read(stream, &num, sizeof(num));
+	if ((err != STD_E_OK) || (num != (MPU_CONFIG_REGION_NUM + mpu_address_map.dynamic_map_num))) {
+		printf("ERROR: snapshot mpu region num is not matched\n");
+		return STD_E_INVALID;
+	}
+	for (i = 0U; (err == STD_E_OK) && (i < num); i++) {
+		region = mpu_address_snapshot_region(i);
+		err = snapshot_read(stream, &start, sizeof(start));
+		if (err == STD_E_OK) {
+			err = snapshot_read(stream, &size, sizeof(size));
+		}
+		if (err == STD_E_OK) {
+			err = snapshot_read(stream, &has_data, sizeof(has_data));
+		}
+		if (err != STD_E_OK) {
+			break;
+		}
+		if ((start != region->start) || (size != region->size)) {
+			printf("ERROR: snapshot mpu region(0x%x size=%u) is not matched(0x%x size=%u)\n",
+					start, size, region->start, region->size);
+			return STD_E_INVALID;
+		}
+		if ((has_data != FALSE) && mpu_address_snapshot_is_skipped(region)) {
+			printf("ERROR: snapshot mpu region(0x%x size=%u) is device or mmap region\n", start, size);
+			return STD_E_INVALID;
+		}
+		if (has_data == FALSE) {
+			if ((region->is_malloc == TRUE) && (region->data != NULL)) {
+				memset(region->data, 0, region->size);
+			}
+			continue;
+		}
+		if (region->data == NULL) {
+			if (region->is_malloc == FALSE) {
+				return STD_E_INVALID;
+			}
+			region->data = malloc(region->size);
+			ASSERT(region->data != NULL);
+		}
+		err = snapshot_read(stream, region->data, region->size);
+	}
+	if (err != STD_E_OK) {
+		return err;
+	}
+	/*
+	 * data pointers may be changed, and all decoded code is stale.
+	 */
+	mpu_address_map_invalidate();
+	for (i = 0U; i < virtual_cpu.cached_code_num; i++) {
+		virtual_cpu_cached_code_invalidate(virtual_cpu.cached_code[i]->code_start_addr, virtual_cpu.cached_code[i]->code_size);
+	}
+	return STD_E_OK;
+}
+
+const SnapshotOperationType mpu_address_snapshot_operation = {
+	.save = mpu_address_snapshot_save,
+	.restore = mpu_address_snapshot_restore,
+};
+
 MpuAddressRegionEnumType mpu_address_region_type_get(uint32 addr, std_bool *is_malloc)
 {
 	uint32 i;
+	MpuAddressPageEntryType *entry = mpu_address_page_get(addr);
+
+	if (entry->state == MpuAddressPageState_MAPPED) {
+		if (is_malloc != NULL) {
+			*is_malloc = entry->region->is_malloc;
+		}
+		return entry->region->type;
+	}
 
 	for (i = 0U; i < mpu_address_map.dynamic_map_num; i++) {
 		uint32 start = mpu_address_map.dynamic_map[i].start;
@@ -311,6 +891,10 @@ Std_ReturnType mpu_get_data8(CoreIdType core_id, uint32 addr, uint8 *data)
 		return STD_E_SEGV;
 	}
 	uint32 paddr = (addr & region->mask);
+	tlb_fill(core_id, addr, FALSE);
+	if (region->type == DEVICE) {
+		return device_get_data8(region, core_id, paddr, data);
+	}
 	return region->ops->get_data8(region, core_id, paddr, data);
 }
 Std_ReturnType mpu_get_data16(CoreIdType core_id, uint32 addr, uint16 *data)
@@ -327,6 +911,10 @@ Std_ReturnType mpu_get_data16(CoreIdType core_id, uint32 addr, uint16 *data)
 		return STD_E_SEGV;
 	}
 	uint32 paddr = (addr & region->mask);
+	tlb_fill(core_id, addr, FALSE);
+	if (region->type == DEVICE) {
+		return device_get_data16(region, core_id, paddr, data);
+	}
 	return region->ops->get_data16(region, core_id, paddr, data);
 }
 
@@ -344,6 +932,10 @@ Std_ReturnType mpu_get_data32(CoreIdType core_id, uint32 addr, uint32 *data)
 		return STD_E_SEGV;
 	}
 	uint32 paddr = (addr & region->mask);
+	tlb_fill(core_id, addr, FALSE);
+	if (region->type == DEVICE) {
+		return device_get_data32(region, core_id, paddr, data);
+	}
 	return region->ops->get_data32(region, core_id, paddr, data);
 }
 
@@ -368,15 +960,29 @@ Std_ReturnType mpu_put_data8(CoreIdType core_id, uint32 addr, uint8 data)
 		return STD_E_SEGV;
 	}
 	uint32 paddr = (addr & region->mask);
-	err = region->ops->put_data8(region, core_id, paddr, data);
+	tlb_fill(core_id, addr, TRUE);
+	if (region->type == DEVICE) {
+		err = device_put_data8(region, core_id, paddr, data);
+	}
+	else {
+		err = region->ops->put_data8(region, core_id, paddr, data);
+	}
 	if (err != STD_E_OK) {
 		printf("mpu_put_data8:error3:addr=0x%x data=%u\n", addr, data);
+		return err;
+	}
+	if (is_code_page(addr)) {
+		code_invalidate(addr, 1U);
+	}
+	if (mpu_address_write_hook_num > 0U) {
+		write_hook(core_id, addr, 1U);
 	}
 	return err;
 }
 
 Std_ReturnType mpu_put_data16(CoreIdType core_id, uint32 addr, uint16 data)
 {
+	Std_ReturnType err;
 	MpuAddressRegionType *region = search_region(core_id, addr, 2U);
 	if (region == NULL) {
 		printf("%s():addr=0x%x\n", __FUNCTION__, addr);
@@ -393,11 +999,25 @@ Std_ReturnType mpu_put_data16(CoreIdType core_id, uint32 addr, uint16 data)
 		return STD_E_SEGV;
 	}
 	uint32 paddr = (addr & region->mask);
-	return region->ops->put_data16(region, core_id, paddr, data);
+	tlb_fill(core_id, addr, TRUE);
+	if (region->type == DEVICE) {
+		err = device_put_data16(region, core_id, paddr, data);
+	}
+	else {
+		err = region->ops->put_data16(region, core_id, paddr, data);
+	}
+	if ((err == STD_E_OK) && has_code_page(addr, 2U)) {
+		code_invalidate(addr, 2U);
+	}
+	if ((err == STD_E_OK) && (mpu_address_write_hook_num > 0U)) {
+		write_hook(core_id, addr, 2U);
+	}
+	return err;
 }
 
 Std_ReturnType mpu_put_data32(CoreIdType core_id, uint32 addr, uint32 data)
 {
+	Std_ReturnType err;
 	MpuAddressRegionType *region = search_region(core_id, addr, 4U);
 	if (region == NULL) {
 		printf("%s():addr=0x%x\n", __FUNCTION__, addr);
@@ -414,7 +1034,20 @@ Std_ReturnType mpu_put_data32(CoreIdType core_id, uint32 addr, uint32 data)
 		return STD_E_SEGV;
 	}
 	uint32 paddr = (addr & region->mask);
-	return region->ops->put_data32(region, core_id, paddr, data);
+	tlb_fill(core_id, addr, TRUE);
+	if (region->type == DEVICE) {
+		err = device_put_data32(region, core_id, paddr, data);
+	}
+	else {
+		err = region->ops->put_data32(region, core_id, paddr, data);
+	}
+	if ((err == STD_E_OK) && has_code_page(addr, 4U)) {
+		code_invalidate(addr, 4U);
+	}
+	if ((err == STD_E_OK) && (mpu_address_write_hook_num > 0U)) {
+		write_hook(core_id, addr, 4U);
+	}
+	return err;
 }
 
 
@@ -432,6 +1065,164 @@ Std_ReturnType mpu_get_pointer(CoreIdType core_id, uint32 addr, uint8 **data)
 	return region->ops->get_pointer(region, core_id, paddr, data);
 }
 
+/*
+ * size: contiguous bytes of host memory from addr(up to the end of the region).
+ */
+Std_ReturnType mpu_get_pointer_range(CoreIdType core_id, uint32 addr, uint8 **data, uint32 *size)
+{
+	Std_ReturnType err;
+	MpuAddressRegionType *region = search_region(core_id, addr, 1U);
+	if (region == NULL) {
+		printf("%s():addr=0x%x\n", __FUNCTION__, addr);
+		return STD_E_SEGV;
+	}
+	if (region->ops->get_pointer == NULL) {
+		return STD_E_INVALID;
+	}
+	uint32 paddr = (addr & region->mask);
+	err = region->ops->get_pointer(region, core_id, paddr, data);
+	if (err != STD_E_OK) {
+		return err;
+	}
+	*size = (region->start + region->size) - paddr;
+	return STD_E_OK;
+}
+
+/*
+ * block transfer.
+ * region and permission are checked once per region: memory regions are copied by memcpy,
+ * device regions are accessed by 32bit(aligned) or 8bit operations.
+ */
+static MpuAddressRegionType *block_region(CoreIdType core_id, uint32 addr, uint32 size, CpuMemoryAccessType access, uint32 *len)
+{
+	uint32 paddr;
+	MpuAddressRegionType *region = search_region(core_id, addr, 1U);
+
+	if (region == NULL) {
+		printf("%s():addr=0x%x\n", __FUNCTION__, addr);
+		return NULL;
+	}
+	paddr = (addr & region->mask);
+	*len = (region->start + region->size) - paddr;
+	if (*len > size) {
+		*len = size;
+	}
+	if (!CPU_HAS_PERMISSION(core_id, region->type, access, addr, *len)) {
+		return NULL;
+	}
+	return region;
+}
+static Std_ReturnType device_get_block(MpuAddressRegionType *region, CoreIdType core_id, uint32 paddr, uint8 *data, uint32 len)
+{
+	Std_ReturnType err = STD_E_OK;
+	uint32 data32;
+	uint32 off = 0U;
+
+	while ((err == STD_E_OK) && (off < len)) {
+		if ((((paddr + off) & 0x3U) == 0U) && ((len - off) >= 4U)) {
+			err = device_get_data32(region, core_id, paddr + off, &data32);
+			memcpy(&data[off], &data32, 4U);
+			off += 4U;
+		}
+		else {
+			err = device_get_data8(region, core_id, paddr + off, &data[off]);
+			off++;
+		}
+	}
+	return err;
+}
+static Std_ReturnType device_put_block(MpuAddressRegionType *region, CoreIdType core_id, uint32 paddr, const uint8 *data, uint32 len)
+{
+	Std_ReturnType err = STD_E_OK;
+	uint32 data32;
+	uint32 off = 0U;
+
+	while ((err == STD_E_OK) && (off < len)) {
+		if ((((paddr + off) & 0x3U) == 0U) && ((len - off) >= 4U)) {
+			memcpy(&data32, &data[off], 4U);
+			err = device_put_data32(region, core_id, paddr + off, data32);
+			off += 4U;
+		}
+		else {
+			err = device_put_data8(region, core_id, paddr + off, data[off]);
+			off++;
+		}
+	}
+	return err;
+}
+Std_ReturnType mpu_get_block(CoreIdType core_id, uint32 addr, uint8 *data, uint32 size)
+{
+	Std_ReturnType err;
+	MpuAddressRegionType *region;
+	uint8 *hostp;
+	uint32 len;
+
+	while (size > 0U) {
+		region = block_region(core_id, addr, size, CpuMemoryAccess_READ, &len);
+		if (region == NULL) {
+			return STD_E_SEGV;
+		}
+		if (region->type == DEVICE) {
+			err = device_get_block(region, core_id, (addr & region->mask), data, len);
+		}
+		else if (region->ops->get_pointer != NULL) {
+			err = region->ops->get_pointer(region, core_id, (addr & region->mask), &hostp);
+			if (err == STD_E_OK) {
+				memcpy(data, hostp, len);
+			}
+		}
+		else {
+			err = STD_E_SEGV;
+		}
+		if (err != STD_E_OK) {
+			return err;
+		}
+		addr += len;
+		data += len;
+		size -= len;
+	}
+	return STD_E_OK;
+}
+Std_ReturnType mpu_put_block(CoreIdType core_id, uint32 addr, const uint8 *data, uint32 size)
+{
+	Std_ReturnType err;
+	MpuAddressRegionType *region;
+	uint8 *hostp;
+	uint32 len;
+
+	while (size > 0U) {
+		region = block_region(core_id, addr, size, CpuMemoryAccess_WRITE, &len);
+		if ((region == NULL) || (region->type == READONLY_MEMORY)) {
+			return STD_E_SEGV;
+		}
+		if (region->type == DEVICE) {
+			err = device_put_block(region, core_id, (addr & region->mask), data, len);
+		}
+		else if (region->ops->get_pointer != NULL) {
+			err = region->ops->get_pointer(region, core_id, (addr & region->mask), &hostp);
+			if (err == STD_E_OK) {
+				memcpy(hostp, data, len);
+				if (has_code_page(addr, len)) {
+					code_invalidate(addr, len);
+				}
+				if (mpu_address_write_hook_num > 0U) {
+					write_hook(core_id, addr, len);
+				}
+			}
+		}
+		else {
+			err = STD_E_SEGV;
+		}
+		if (err != STD_E_OK) {
+			return err;
+		}
+		addr += len;
+		data += len;
+		size -= len;
+	}
+	return STD_E_OK;
+}
+
 
 
 
@@ -3,6 +3,7 @@
 
 #include "std_types.h"
 #include "std_errno.h"
+#include "cpu_config.h"
 #include "mpu_types.h"
 #include "mpu_config.h"
 
@@ -14,6 +15,125 @@ typedef struct {
 
 extern MpuAddressMapType	mpu_address_map;
 
+/*
+ * guest address -> region translation table.
+ *
+ * 2 level page table (L1: 4MB, L2: 4KB).
+ * L2 tables are allocated when the guest address is accessed at first.
+ */
+#define MPU_ADDRESS_PAGE_SHIFT			12U
+#define MPU_ADDRESS_PAGE_SIZE			(1U << MPU_ADDRESS_PAGE_SHIFT)
+#define MPU_ADDRESS_PAGE_OFFSET_MASK	(MPU_ADDRESS_PAGE_SIZE - 1U)
+#define MPU_ADDRESS_PAGE_L1_SHIFT		22U
+#define MPU_ADDRESS_PAGE_L1_NUM			(1U << (32U - MPU_ADDRESS_PAGE_L1_SHIFT))
+#define MPU_ADDRESS_PAGE_L2_NUM			(1U << (MPU_ADDRESS_PAGE_L1_SHIFT - MPU_ADDRESS_PAGE_SHIFT))
+#define MPU_ADDRESS_PAGE_L1_INDEX(addr)	((addr) >> MPU_ADDRESS_PAGE_L1_SHIFT)
+#define MPU_ADDRESS_PAGE_L2_INDEX(addr)	(((addr) >> MPU_ADDRESS_PAGE_SHIFT) & (MPU_ADDRESS_PAGE_L2_NUM - 1U))
+
+typedef enum {
+	MpuAddressPageState_UNKNOWN = 0,	/* not resolved yet */
+	MpuAddressPageState_MAPPED,			/* whole page belongs to one region */
+	MpuAddressPageState_SLOWPATH,		/* region must be searched on each access */
+} MpuAddressPageStateType;
+
+typedef struct {
+	MpuAddressPageStateType	state;
+	MpuAddressRegionType	*region;
+	/*
+	 * host pointer of the page top.
+	 * NULL if the region is not accessed by default_memory_operation.
+	 */
+	uint8					*host_base;
+} MpuAddressPageEntryType;
+
+typedef struct {
+	MpuAddressPageEntryType	*l1[MPU_ADDRESS_PAGE_L1_NUM];
+} MpuAddressPageTableType;
+
+extern MpuAddressPageTableType	mpu_address_page_table;
+
+extern MpuAddressPageEntryType *mpu_address_page_fill(uint32 addr);
+
+static inline MpuAddressPageEntryType *mpu_address_page_get(uint32 addr)
+{
+	MpuAddressPageEntryType *l2 = mpu_address_page_table.l1[MPU_ADDRESS_PAGE_L1_INDEX(addr)];
+	if (l2 != NULL) {
+		MpuAddressPageEntryType *entry = &l2[MPU_ADDRESS_PAGE_L2_INDEX(addr)];
+		if (entry->state != MpuAddressPageState_UNKNOWN) {
+			return entry;
+		}
+	}
+	return mpu_address_page_fill(addr);
+}
+
+/*
+ * per core software TLB.
+ *
+ * direct mapped cache of guest page -> host pointer for the pages
+ * accessed by default_memory_operation.
+ * DEVICE regions and pages shared by some regions are not cached,
+ * so these are always accessed by region operations.
+ *
+ * TLB is not used when memory protection is enabled,
+ * because the permission can be changed on each access.
+ */
+#ifndef CPU_CONFIG_MEMORY_PROTECTION_ENABLE
+#define MPU_ADDRESS_TLB_ENABLE
+#endif /* CPU_CONFIG_MEMORY_PROTECTION_ENABLE */
+
+#define MPU_ADDRESS_TLB_ENTRY_NUM		256U
+#define MPU_ADDRESS_TLB_INDEX(addr)		(((addr) >> MPU_ADDRESS_PAGE_SHIFT) & (MPU_ADDRESS_TLB_ENTRY_NUM - 1U))
+/*
+ * tag = page address | valid bit.
+ * page address is page aligned, so zero cleared entry never hits.
+ */
+#define MPU_ADDRESS_TLB_VALID			0x1U
+#define MPU_ADDRESS_TLB_TAG(addr)		(((addr) & ~MPU_ADDRESS_PAGE_OFFSET_MASK) | MPU_ADDRESS_TLB_VALID)
+
+typedef struct {
+	uint32					tag;
+	uint8					*host_base;
+} MpuAddressTlbEntryType;
+
+typedef struct {
+	MpuAddressTlbEntryType	read[MPU_ADDRESS_TLB_ENTRY_NUM];
+	MpuAddressTlbEntryType	write[MPU_ADDRESS_TLB_ENTRY_NUM];
+} MpuAddressTlbType;
+
+extern MpuAddressTlbType	mpu_address_tlb[CPU_CONFIG_CORE_NUM];
+
+extern void mpu_address_tlb_invalidate(CoreIdType core_id);
+
+static inline uint8 *mpu_address_tlb_lookup(const MpuAddressTlbEntryType *tlb, uint32 addr, uint32 size)
+{
+#ifdef MPU_ADDRESS_TLB_ENABLE
+	const MpuAddressTlbEntryType *entry = &tlb[MPU_ADDRESS_TLB_INDEX(addr)];
+	uint32 off = (addr & MPU_ADDRESS_PAGE_OFFSET_MASK);
+
+	if ((entry->tag == MPU_ADDRESS_TLB_TAG(addr)) && ((off + size) <= MPU_ADDRESS_PAGE_SIZE)) {
+		return &entry->host_base[off];
+	}
+#endif /* MPU_ADDRESS_TLB_ENABLE */
+	return NULL;
+}
+/*
+ * core_id out of CPU_CONFIG_CORE_NUM(e.g. accesses by devices) has no TLB, same as tlb_fill().
+ */
+static inline uint8 *mpu_address_tlb_get_read(CoreIdType core_id, uint32 addr, uint32 size)
+{
+	if (core_id >= CPU_CONFIG_CORE_NUM) {
+		return NULL;
+	}
+	return mpu_address_tlb_lookup(mpu_address_tlb[core_id].read, addr, size);
+}
+static inline uint8 *mpu_address_tlb_get_write(CoreIdType core_id, uint32 addr, uint32 size)
+{
+	if (core_id >= CPU_CONFIG_CORE_NUM) {
+		return NULL;
+	}
+	return mpu_address_tlb_lookup(mpu_address_tlb[core_id].write, addr, size);
+}
+
 extern void mpu_add_dynamic_map(MpuAddressRegionType *p);
 extern MpuAddressRegionType *mpu_search_dynamic_map(uint32 start, uint32 size);
 
@@ -157,6 +157,7 @@ done:
     if (unit->region->data == NULL) {
         unit->region->data = malloc(MPU_MALLOC_REGION_UNIT_SIZE * 1024);
         ASSERT(unit->region->data != NULL);
+        mpu_address_map_invalidate();
     }
     unit->bitfreenum--;
     return ( unit->region->start + (index * malloc_data_info_table[i].memsize));
@@ -289,3 +290,63 @@ void  mpu_malloc_add_region(MpuAddressRegionType *region)
     group_add_region(group, region);
     return;
 }
+
+/*
+ * snapshot: groups are built from memory config, so only bitmaps are saved.
+ * region data is saved by mpu.c.
+ */
+static Std_ReturnType mpu_malloc_snapshot_save(SnapshotStreamType *stream, void *arg)
+{
+    int i;
+    int j;
+    Std_ReturnType err;
+    MallocRegionGroupType *group;
+
+    err = snapshot_write(stream, &malloc_region.group_num, sizeof(malloc_region.group_num));
+    for (i = 0; (err == STD_E_OK) && (i < malloc_region.group_num); i++) {
+        group = malloc_region.groups[i];
+        err = snapshot_write(stream, &group->unit_num, sizeof(group->unit_num));
+        for (j = 0; (err == STD_E_OK) && (j < group->unit_num); j++) {
+            err = snapshot_write(stream, &group->unit[j].bitfreenum, sizeof(group->unit[j].bitfreenum));
+            if (err == STD_E_OK) {
+                err = snapshot_write(stream, group->unit[j].bitmap, malloc_data_info_table[j].bitmapsize);
+            }
+        }
+    }
+    return err;
+}
+
+static Std_ReturnType mpu_malloc_snapshot_restore(SnapshotStreamType *stream, void *arg)
+{
+    int i;
+    int j;
+    Std_ReturnType err;
+    MallocRegionGroupType *group;
+    uint32 num;
+
+    err = snapshot_read(stream, &num, sizeof(num));
+    if ((err != STD_E_OK) || (num != malloc_region.group_num)) {
+        printf("ERROR: snapshot malloc group num is not matched\n");
+        return STD_E_INVALID;
+    }
+    for (i = 0; (err == STD_E_OK) && (i < malloc_region.group_num); i++) {
+        group = malloc_region.groups[i];
+        err = snapshot_read(stream, &num, sizeof(num));
+        if ((err != STD_E_OK) || (num != group->unit_num)) {
+            printf("ERROR: snapshot malloc unit num is not matched\n");
+            return STD_E_INVALID;
+        }
+        for (j = 0; (err == STD_E_OK) && (j < group->unit_num); j++) {
+            err = snapshot_read(stream, &group->unit[j].bitfreenum, sizeof(group->unit[j].bitfreenum));
+            if (err == STD_E_OK) {
+                err = snapshot_read(stream, group->unit[j].bitmap, malloc_data_info_table[j].bitmapsize);
+            }
+        }
+    }
+    return err;
+}
+
+const SnapshotOperationType mpu_malloc_snapshot_operation = {
+    .save = mpu_malloc_snapshot_save,
+    .restore = mpu_malloc_snapshot_restore,
+};
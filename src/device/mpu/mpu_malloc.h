@@ -5,11 +5,17 @@
 #include "std_errno.h"
 #include "mpu_types.h"
 #include "mpu_types.h"
+#include "snapshot.h"
 
 extern void  mpu_malloc_add_region(MpuAddressRegionType *region);
 extern uint32 mpu_malloc_get_memory(uint32 size);
 extern void  mpu_malloc_rel_memory(uint32 addr);
 extern uint32 mpu_malloc_ref_size(uint32 addr);
 
+/*
+ * snapshot section of allocation bitmaps(cpuemu.c registers it).
+ */
+extern const SnapshotOperationType mpu_malloc_snapshot_operation;
+
 
 #endif /* _MPU_MALLOC_H_ */
\ No newline at end of file
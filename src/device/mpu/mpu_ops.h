@@ -2,6 +2,7 @@
 #define _MPU_OPS_H_
 
 #include "std_types.h"
+#include "snapshot.h"
 
 extern Std_ReturnType mpu_get_data8(CoreIdType core_id, uint32 addr, uint8 *data);
 extern Std_ReturnType mpu_get_data16(CoreIdType core_id, uint32 addr, uint16 *data);
@@ -12,6 +13,12 @@ extern Std_ReturnType mpu_put_data16(CoreIdType core_id, uint32 addr, uint16 dat
 extern Std_ReturnType mpu_put_data32(CoreIdType core_id, uint32 addr, uint32 data);
 
 extern Std_ReturnType mpu_get_pointer(CoreIdType core_id, uint32 addr, uint8 **data);
+extern Std_ReturnType mpu_get_pointer_range(CoreIdType core_id, uint32 addr, uint8 **data, uint32 *size);
+/*
+ * block transfer(fails at the first inaccessible region).
+ */
+extern Std_ReturnType mpu_get_block(CoreIdType core_id, uint32 addr, uint8 *data, uint32 size);
+extern Std_ReturnType mpu_put_block(CoreIdType core_id, uint32 addr, const uint8 *data, uint32 size);
 
 
 /*
@@ -28,8 +35,43 @@ typedef enum {
 
 extern uint8 *mpu_address_set_rom_ram(MpuAddressGetType getType, uint32 addr, uint32 size, void *mmap_addr);
 extern uint8 *mpu_address_set_dev(uint32 addr, uint32 size, void *handler);
+/*
+ * DEVICE region which is accessed by ops(athrill internal devices).
+ */
+struct mpu_address_region_operation_type;
+extern uint8 *mpu_address_set_device(uint32 addr, uint32 size, uint8 *data, struct mpu_address_region_operation_type *ops);
 extern uint8 *mpu_address_get_rom(uint32 addr, uint32 size);
 extern uint8 *mpu_address_get_ram(uint32 addr, uint32 size);
 extern void mpu_address_set_malloc_region(uint32 addr, uint32 size);
+/*
+ * TRUE if [addr, addr + size) is on MMAP region: other processes can write it.
+ */
+extern bool mpu_address_is_mmap_memory(uint32 addr, uint32 size);
+
+/*
+ * guest page table maintenance.
+ * mpu_address_map_invalidate() must be called whenever region layout or region data pointer is changed.
+ */
+extern void mpu_address_map_build(void);
+extern void mpu_address_map_invalidate(void);
+
+/*
+ * write tracking of the pages which have decoded code.
+ * mpu_address_notify_host_write() must be called after host writes guest memory via pointer.
+ */
+extern void mpu_address_set_code_page(uint32 addr, uint32 size);
+extern void mpu_address_notify_host_write(uint32 addr, uint32 size);
+
+/*
+ * hook is called after cpu writes on [addr, addr + size)(size <= page size).
+ */
+typedef void (*MpuAddressWriteHookType) (CoreIdType core_id, uint32 addr);
+extern Std_ReturnType mpu_address_set_write_hook(uint32 addr, uint32 size, MpuAddressWriteHookType hook);
+extern void mpu_address_clear_write_hook(uint32 addr, MpuAddressWriteHookType hook);
+
+/*
+ * snapshot section of region data(cpuemu.c registers it).
+ */
+extern const SnapshotOperationType mpu_address_snapshot_operation;
 
 #endif /* _MPU_OPS_H_ */
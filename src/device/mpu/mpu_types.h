@@ -33,6 +33,10 @@ typedef struct {
 	uint32										mask;
 	uint8										*data;
 	struct mpu_address_region_operation_type	*ops;
+	/*
+	 * index of the external device which wraps ops of this region
+	 */
+	uint32										exdev_index;
 } MpuAddressRegionType;
 
 typedef struct mpu_address_region_operation_type {
@@ -5,16 +5,30 @@
 #include "symbol_ops.h"
 #include <string.h>
 #include <sys/file.h>
+#include <stdint.h>
 #include "assert.h"
 #include "std_device_ops.h"
 #include "athrill_exdev.h"
 #include "cpuemu_ops.h"
+#include "mpu.h"
+#include "device_event.h"
+#include "device_intr_queue.h"
+#include "bus.h"
 
 
 AthrillExDevOperationType athrill_exdev_operation;
 
 static uint32 athrill_device_func_call_addr = 0x0;
 static uint32 athrill_device_raise_interrupt_addr = 0x0;
+/*
+ * TRUE when athrill_device_raise_interrupt is on MMAP region: written by other processes.
+ */
+static bool athrill_device_raise_interrupt_poll = FALSE;
+static uint32 athrill_device_doorbell_addr = 0x0;
+static uint8 athrill_device_doorbell_data[ATHRILL_DEVICE_DOORBELL_SIZE];
+static MpuAddressRegionOperationType athrill_device_doorbell_operation;
+static void athrill_device_func_call_hook(CoreIdType core_id, uint32 addr);
+static void athrill_device_raise_interrupt_hook(CoreIdType core_id, uint32 addr);
 
 typedef struct {
 	bool isLocked;
@@ -39,13 +53,30 @@ void device_init_athrill_device(void)
     if (err >= 0) {
 		printf("athrill_device_func_call=0x%x\n", addr);
 	    athrill_device_func_call_addr = addr;
+	    /*
+	     * compatibility: cpu stores on the variable are trapped.
+	     */
+	    if (mpu_address_set_write_hook(addr, sizeof(uint32), athrill_device_func_call_hook) != STD_E_OK) {
+	    	printf("WARNING: athrill_device_func_call can not be hooked\n");
+	    }
     }
     err = symbol_get_gl("athrill_device_raise_interrupt", 
         strlen("athrill_device_raise_interrupt"), &addr, &size);
     if (err >= 0) {
 		printf("athrill_device_raise_interrupt=0x%x\n", addr);
 	    athrill_device_raise_interrupt_addr = addr;
+	    /*
+	     * writes by other processes via mmap can not be hooked: polled on device tick.
+	     */
+	    if (mpu_address_is_mmap_memory(addr, sizeof(uint32)) == TRUE) {
+	    	athrill_device_raise_interrupt_poll = TRUE;
+	    }
+	    else if (mpu_address_set_write_hook(addr, sizeof(uint32), athrill_device_raise_interrupt_hook) != STD_E_OK) {
+	    	printf("WARNING: athrill_device_raise_interrupt can not be hooked\n");
+	    	athrill_device_raise_interrupt_poll = TRUE;
+	    }
     }
+    athrill_syscall_device_init();
 
     return;
 }
@@ -55,7 +86,16 @@ static Std_ReturnType athrill_device_get_memory(uint32 addr, uint8 **data)
 }
 typedef struct {
 	AthrillExDeviceType *devp;
-	MpuAddressRegionType *region;
+	uint32 region_index;
+	/*
+	 * version 4 devices with next_event: ticked by device event.
+	 */
+	bool is_event_driven;
+	DeviceEventType event;
+	/*
+	 * region operations of the device wrapped by athrill_exdev_event_register().
+	 */
+	MpuAddressRegionOperationType event_ops;
 } AthrillExtDevEntryType;
 typedef struct {
 	uint32 num;
@@ -63,6 +103,235 @@ typedef struct {
 } AthrillExtDevType;
 static AthrillExtDevType athrill_exdev;
 
+/*
+ * snapshot section of external device: "exdev<index>".
+ * device index is the order in memory config.
+ */
+static Std_ReturnType athrill_exdev_snapshot_save(SnapshotStreamType *stream, void *arg)
+{
+	AthrillExtDevEntryType *entryp = (AthrillExtDevEntryType *)arg;
+	return entryp->devp->save(stream);
+}
+static Std_ReturnType athrill_exdev_snapshot_restore(SnapshotStreamType *stream, void *arg)
+{
+	Std_ReturnType err;
+	AthrillExtDevEntryType *entryp = (AthrillExtDevEntryType *)arg;
+
+	err = entryp->devp->restore(stream);
+	if ((err == STD_E_OK) && (entryp->is_event_driven != FALSE)) {
+		/*
+		 * next event is queried again on the next device tick.
+		 */
+		(void)device_event_set(&entryp->event, 0U);
+	}
+	return err;
+}
+static const SnapshotOperationType athrill_exdev_snapshot_operation = {
+	.save = athrill_exdev_snapshot_save,
+	.restore = athrill_exdev_snapshot_restore,
+};
+static void athrill_exdev_snapshot_register(int index)
+{
+	char name[SNAPSHOT_NAME_LEN];
+	AthrillExDeviceType *devp = athrill_exdev.exdevs[index]->devp;
+
+	if ((devp->header.version < 3) || (devp->save == NULL) || (devp->restore == NULL)) {
+		return;
+	}
+	snprintf(name, sizeof(name), "exdev%d", index);
+	(void)snapshot_register(name, &athrill_exdev_snapshot_operation, athrill_exdev.exdevs[index]);
+	return;
+}
+
+/*
+ * event driven external device.
+ * region operations are wrapped to tick the device on the next device tick after guest access.
+ */
+static void athrill_exdev_event_schedule(AthrillExtDevEntryType *entryp, DeviceClockType *dev_clock)
+{
+	uint64 clock = entryp->devp->next_event(dev_clock);
+
+	if (clock == ATHRILL_EXDEV_NO_EVENT) {
+		return;
+	}
+	if (clock <= dev_clock->clock) {
+		clock = dev_clock->clock + 1U;
+	}
+	(void)device_event_set(&entryp->event, clock);
+	return;
+}
+static void athrill_exdev_event_handler(DeviceEventType *event, DeviceClockType *dev_clock)
+{
+	AthrillExtDevEntryType *entryp = (AthrillExtDevEntryType *)event->arg;
+
+	entryp->devp->supply_clock(dev_clock);
+	athrill_exdev_event_schedule(entryp, dev_clock);
+	return;
+}
+static inline AthrillExtDevEntryType *athrill_exdev_get_entry(MpuAddressRegionType *region)
+{
+	return athrill_exdev.exdevs[region->exdev_index];
+}
+static void athrill_exdev_event_notify_access(AthrillExtDevEntryType *entryp)
+{
+	uint64 clock = cpuemu_get_total_clocks();
+
+	if (device_event_is_set(&entryp->event) && (entryp->event.clock <= clock)) {
+		return;
+	}
+	(void)device_event_set(&entryp->event, clock);
+	return;
+}
+#define ATHRILL_EXDEV_ACCESS_FUNC(name, type)	\
+static Std_ReturnType athrill_exdev_##name(MpuAddressRegionType *region, CoreIdType core_id, uint32 addr, type data)	\
+{	\
+	Std_ReturnType err;	\
+	AthrillExtDevEntryType *entryp = athrill_exdev_get_entry(region);	\
+	err = entryp->devp->ops->name(region, core_id, addr, data);	\
+	athrill_exdev_event_notify_access(entryp);	\
+	return err;	\
+}
+ATHRILL_EXDEV_ACCESS_FUNC(get_data8, uint8*)
+ATHRILL_EXDEV_ACCESS_FUNC(get_data16, uint16*)
+ATHRILL_EXDEV_ACCESS_FUNC(get_data32, uint32*)
+ATHRILL_EXDEV_ACCESS_FUNC(put_data8, uint8)
+ATHRILL_EXDEV_ACCESS_FUNC(put_data16, uint16)
+ATHRILL_EXDEV_ACCESS_FUNC(put_data32, uint32)
+static Std_ReturnType athrill_exdev_get_pointer(MpuAddressRegionType *region, CoreIdType core_id, uint32 addr, uint8 **data)
+{
+	AthrillExtDevEntryType *entryp = athrill_exdev_get_entry(region);
+	return entryp->devp->ops->get_pointer(region, core_id, addr, data);
+}
+/*
+ * ops which the device does not provide are left NULL: mpu handles them as access errors.
+ */
+static MpuAddressRegionOperationType athrill_exdev_no_operation;
+#define ATHRILL_EXDEV_EVENT_OPS_SET(ops, devops, name)	\
+	(ops)->name = ((devops)->name != NULL) ? athrill_exdev_##name : NULL
+static void athrill_exdev_event_register(int index)
+{
+	AthrillExtDevEntryType *entryp = athrill_exdev.exdevs[index];
+	MpuAddressRegionType *region = &mpu_address_map.dynamic_map[entryp->region_index];
+	MpuAddressRegionOperationType *devops = entryp->devp->ops;
+
+	entryp->is_event_driven = FALSE;
+	if ((entryp->devp->header.version < 4) || (entryp->devp->next_event == NULL)) {
+		return;
+	}
+	entryp->is_event_driven = TRUE;
+	if (devops == NULL) {
+		devops = &athrill_exdev_no_operation;
+	}
+	ATHRILL_EXDEV_EVENT_OPS_SET(&entryp->event_ops, devops, get_data8);
+	ATHRILL_EXDEV_EVENT_OPS_SET(&entryp->event_ops, devops, get_data16);
+	ATHRILL_EXDEV_EVENT_OPS_SET(&entryp->event_ops, devops, get_data32);
+	ATHRILL_EXDEV_EVENT_OPS_SET(&entryp->event_ops, devops, put_data8);
+	ATHRILL_EXDEV_EVENT_OPS_SET(&entryp->event_ops, devops, put_data16);
+	ATHRILL_EXDEV_EVENT_OPS_SET(&entryp->event_ops, devops, put_data32);
+	ATHRILL_EXDEV_EVENT_OPS_SET(&entryp->event_ops, devops, get_pointer);
+	region->exdev_index = (uint32)index;
+	region->ops = &entryp->event_ops;
+	/*
+	 * first tick queries next event.
+	 */
+	device_event_init(&entryp->event, athrill_exdev_event_handler, entryp);
+	(void)device_event_set(&entryp->event, 0U);
+	return;
+}
+
+/*
+ * dma completion of external devices.
+ */
+#define ATHRILL_EXDEV_DMA_COMPLETE_NUM	32U
+static DeviceEventType athrill_exdev_dma_complete[ATHRILL_EXDEV_DMA_COMPLETE_NUM];
+
+static Std_ReturnType athrill_exdev_dma_read_block(uint32 addr, uint8 *data, uint32 size)
+{
+	return bus_read_block(0U, addr, data, size);
+}
+static Std_ReturnType athrill_exdev_dma_write_block(uint32 addr, const uint8 *data, uint32 size)
+{
+	return bus_write_block(0U, addr, data, size);
+}
+static void athrill_exdev_dma_complete_handler(DeviceEventType *event, DeviceClockType *dev_clock)
+{
+	(void)intc_raise_intr((uint32)((uintptr_t)event->arg));
+	return;
+}
+static Std_ReturnType athrill_exdev_dma_notify_complete(uint32 intno, uint64 delay_clocks)
+{
+	uint32 i;
+
+	for (i = 0; i < ATHRILL_EXDEV_DMA_COMPLETE_NUM; i++) {
+		if (device_event_is_set(&athrill_exdev_dma_complete[i]) == FALSE) {
+			break;
+		}
+	}
+	if (i >= ATHRILL_EXDEV_DMA_COMPLETE_NUM) {
+		return STD_E_LIMIT;
+	}
+	if (delay_clocks == 0U) {
+		delay_clocks = 1U;
+	}
+	athrill_exdev_dma_complete[i].arg = (void *)((uintptr_t)intno);
+	return device_event_set(&athrill_exdev_dma_complete[i], cpuemu_get_total_clocks() + delay_clocks);
+}
+/*
+ * snapshot section of pending dma completions: intno and remaining clocks of each event.
+ */
+typedef struct {
+	uint32 is_set;
+	uint32 intno;
+	uint64 delay_clocks;
+} AthrillExdevDmaCompleteSnapshotType;
+static Std_ReturnType athrill_exdev_dma_snapshot_save(SnapshotStreamType *stream, void *arg)
+{
+	Std_ReturnType err = STD_E_OK;
+	AthrillExdevDmaCompleteSnapshotType data;
+	uint64 clock = cpuemu_get_total_clocks();
+	uint32 i;
+
+	for (i = 0; (err == STD_E_OK) && (i < ATHRILL_EXDEV_DMA_COMPLETE_NUM); i++) {
+		memset(&data, 0, sizeof(data));
+		if (device_event_is_set(&athrill_exdev_dma_complete[i]) != FALSE) {
+			data.is_set = TRUE;
+			data.intno = (uint32)((uintptr_t)athrill_exdev_dma_complete[i].arg);
+			if (athrill_exdev_dma_complete[i].clock > clock) {
+				data.delay_clocks = athrill_exdev_dma_complete[i].clock - clock;
+			}
+		}
+		err = snapshot_write(stream, &data, sizeof(data));
+	}
+	return err;
+}
+static Std_ReturnType athrill_exdev_dma_snapshot_restore(SnapshotStreamType *stream, void *arg)
+{
+	Std_ReturnType err = STD_E_OK;
+	AthrillExdevDmaCompleteSnapshotType data;
+	uint32 i;
+
+	for (i = 0; (err == STD_E_OK) && (i < ATHRILL_EXDEV_DMA_COMPLETE_NUM); i++) {
+		err = snapshot_read(stream, &data, sizeof(data));
+		if (err != STD_E_OK) {
+			break;
+		}
+		device_event_cancel(&athrill_exdev_dma_complete[i]);
+		if (data.is_set == FALSE) {
+			continue;
+		}
+		if (data.delay_clocks == 0U) {
+			data.delay_clocks = 1U;
+		}
+		athrill_exdev_dma_complete[i].arg = (void *)((uintptr_t)data.intno);
+		err = device_event_set(&athrill_exdev_dma_complete[i], cpuemu_get_total_clocks() + data.delay_clocks);
+	}
+	return err;
+}
+static const SnapshotOperationType athrill_exdev_dma_snapshot_operation = {
+	.save = athrill_exdev_dma_snapshot_save,
+	.restore = athrill_exdev_dma_snapshot_restore,
+};
+
 void device_init_athrill_exdev(void)
 {
     /*
@@ -78,6 +347,17 @@ void device_init_athrill_exdev(void)
     athrill_exdev_operation.dev.get_memory = &athrill_device_get_memory;
     athrill_exdev_operation.dev.get_serial_fifo = &athrill_device_get_serial_fifo_buffer;
 
+    athrill_exdev_operation.mem.notify_write = &mpu_address_notify_host_write;
+
+    athrill_exdev_operation.snapshot.write = &snapshot_write;
+    athrill_exdev_operation.snapshot.read = &snapshot_read;
+
+    athrill_exdev_operation.async_intr.request_intr = &device_intr_queue_request;
+
+    athrill_exdev_operation.dma.read_block = &athrill_exdev_dma_read_block;
+    athrill_exdev_operation.dma.write_block = &athrill_exdev_dma_write_block;
+    athrill_exdev_operation.dma.notify_complete = &athrill_exdev_dma_notify_complete;
+
     athrill_exdev_operation.libs.fifo.create = &comm_fifo_buffer_create;
     athrill_exdev_operation.libs.fifo.add = &comm_fifo_buffer_add;
     athrill_exdev_operation.libs.fifo.get = &comm_fifo_buffer_get;
@@ -114,18 +394,24 @@ void device_init_athrill_exdev(void)
     athrill_exdev_operation.libs.thread.timedwait_proc = &mpthread_timedwait_proc;
 
     int i;
+    for (i = 0; i < ATHRILL_EXDEV_DMA_COMPLETE_NUM; i++) {
+    	device_event_init(&athrill_exdev_dma_complete[i], athrill_exdev_dma_complete_handler, NULL);
+    }
+    (void)snapshot_register("exdev_dma", &athrill_exdev_dma_snapshot_operation, NULL);
     for (i = 0; i < athrill_exdev.num; i++) {
-    	athrill_exdev.exdevs[i]->devp->devinit(athrill_exdev.exdevs[i]->region, &athrill_exdev_operation);
+    	athrill_exdev.exdevs[i]->devp->devinit(&mpu_address_map.dynamic_map[athrill_exdev.exdevs[i]->region_index], &athrill_exdev_operation);
+    	athrill_exdev_snapshot_register(i);
+    	athrill_exdev_event_register(i);
     }
 
     return;
 }
-void device_add_athrill_exdev(void *devp, void *region)
+void device_add_athrill_exdev(void *devp, uint32 region_index)
 {
 	AthrillExtDevEntryType *entryp = malloc(sizeof(AthrillExtDevEntryType));
 	ASSERT(entryp != NULL);
 	entryp->devp = (AthrillExDeviceType*)devp;
-	entryp->region = (MpuAddressRegionType*)region;
+	entryp->region_index = region_index;
 	athrill_exdev.num++;
 	athrill_exdev.exdevs = realloc(athrill_exdev.exdevs,
 			 sizeof(AthrillExtDevEntryType*) * athrill_exdev.num);
@@ -157,23 +443,8 @@ static inline AthrillDeviceMmapInfoTableEntryType *getMmapInfo(void *addr)
 	return NULL;
 }
 
-static void do_athrill_device_func_call(void)
+static void athrill_device_func_call(uint32 data)
 {
-    Std_ReturnType err;
-    uint32 data;
-
-    if (athrill_device_func_call_addr == 0x0) {
-        return;
-    }
-
-    err = mpu_get_data32(0U, athrill_device_func_call_addr, &data);
-    if (err != 0) {
-        return;
-    }
-    if (data == 0U) {
-        return;
-    }
-
     AthrillDeviceMmapInfoTableEntryType *mmapInfo = getMmapInfo(CAST_UINT32_TO_ADDR(data));
     if (mmapInfo == NULL) {
         athrill_syscall_device(data);
@@ -190,27 +461,43 @@ static void do_athrill_device_func_call(void)
     	}
 		ASSERT(err == 0);
     }
-
-    (void)mpu_put_data32(0U, athrill_device_func_call_addr, 0U);
 	return;
 }
-static void do_athrill_device_external_raise_interrupt(void)
+static void athrill_device_func_call_hook(CoreIdType core_id, uint32 addr)
 {
     Std_ReturnType err;
     uint32 data;
 
-    if (athrill_device_raise_interrupt_addr == 0x0) {
+    err = mpu_get_data32(core_id, addr, &data);
+    if (err != 0) {
         return;
     }
+    /*
+     * clearing store below also comes here.
+     */
+    if (data == 0U) {
+        return;
+    }
+    athrill_device_func_call(data);
+    (void)mpu_put_data32(core_id, addr, 0U);
+	return;
+}
+static void athrill_device_raise_interrupt_hook(CoreIdType core_id, uint32 addr)
+{
+    Std_ReturnType err;
+    uint32 data;
 
-    err = mpu_get_data32(0U, athrill_device_raise_interrupt_addr, &data);
+    err = mpu_get_data32(core_id, addr, &data);
     if (err != 0) {
         return;
     }
+    /*
+     * clearing store below also comes here.
+     */
     if (data == 0U) {
         return;
     }
-    (void)mpu_put_data32(0U, athrill_device_raise_interrupt_addr, 0U);
+    (void)mpu_put_data32(core_id, addr, 0U);
 	(void)intc_raise_intr(data);
 	return;
 }
@@ -228,22 +515,115 @@ ProfStatType cpuemu_dev_adev2_prof;
 #define CPUEMU_DEV_ADEV2_PROF_START()
 #define CPUEMU_DEV_ADEV2_PROF_END()	
 #endif /* CONFIG_STAT_PERF */
-void device_supply_clock_athrill_device(void)
+/*
+ * doorbell: a store on the register is dispatched synchronously.
+ *   ATHRILL_DEVICE_DOORBELL_FUNC_CALL_OFF       : athrill_device_func_call(value)
+ *   ATHRILL_DEVICE_DOORBELL_RAISE_INTERRUPT_OFF : intc_raise_intr(value)
+ * registers are read as 0 after dispatch.
+ */
+static Std_ReturnType athrill_device_doorbell_put_data32(MpuAddressRegionType *region, CoreIdType core_id, uint32 addr, uint32 data)
+{
+	uint32 off = (addr - region->start);
+
+	if (data == 0U) {
+		return STD_E_OK;
+	}
+	if (off == ATHRILL_DEVICE_DOORBELL_FUNC_CALL_OFF) {
+	    CPUEMU_DEV_ADEV1_PROF_START();
+		athrill_device_func_call(data);
+	    CPUEMU_DEV_ADEV1_PROF_END();
+	}
+	else if (off == ATHRILL_DEVICE_DOORBELL_RAISE_INTERRUPT_OFF) {
+		(void)intc_raise_intr(data);
+	}
+	else {
+		printf("WARNING: athrill doorbell invalid offset(0x%x)\n", off);
+		return STD_E_SEGV;
+	}
+	return STD_E_OK;
+}
+Std_ReturnType device_set_athrill_doorbell(void)
 {
-    CPUEMU_DEV_ADEV1_PROF_START();
-	do_athrill_device_func_call();
-    CPUEMU_DEV_ADEV1_PROF_END();
+	uint8 *ptr;
+
+	if (cpuemu_get_devcfg_value_hex("DEVICE_CONFIG_ATHRILL_DOORBELL_ADDR", &athrill_device_doorbell_addr) != STD_E_OK) {
+		return STD_E_OK;
+	}
+	athrill_device_doorbell_operation = default_memory_operation;
+	athrill_device_doorbell_operation.put_data32 = athrill_device_doorbell_put_data32;
+	memset(athrill_device_doorbell_data, 0, ATHRILL_DEVICE_DOORBELL_SIZE);
+	ptr = mpu_address_set_device(athrill_device_doorbell_addr, ATHRILL_DEVICE_DOORBELL_SIZE,
+			athrill_device_doorbell_data, &athrill_device_doorbell_operation);
+	if (ptr == NULL) {
+		return STD_E_INVALID;
+	}
+	printf("DEVICE_CONFIG_ATHRILL_DOORBELL_ADDR=0x%x\n", athrill_device_doorbell_addr);
+	return STD_E_OK;
+}
+static void do_athrill_device_external_raise_interrupt(void)
+{
+    Std_ReturnType err;
+    uint32 data;
 
+    if (athrill_device_raise_interrupt_poll == FALSE) {
+        return;
+    }
+
+    err = mpu_get_data32(0U, athrill_device_raise_interrupt_addr, &data);
+    if (err != 0) {
+        return;
+    }
+    if (data == 0U) {
+        return;
+    }
+    (void)mpu_put_data32(0U, athrill_device_raise_interrupt_addr, 0U);
+	(void)intc_raise_intr(data);
+	return;
+}
+void device_supply_clock_athrill_device(void)
+{
+	/*
+	 * athrill_device_func_call and athrill_device_raise_interrupt are dispatched by
+	 * the write hook or doorbell. raise interrupt is polled only on MMAP region.
+	 */
     CPUEMU_DEV_ADEV2_PROF_START();
 	do_athrill_device_external_raise_interrupt();
     CPUEMU_DEV_ADEV2_PROF_END();
+
+    athrill_syscall_epoll_supply_clock();
     return;
 }
 
+/*
+ * version 2 devices do not know dev_clock->supply_clocks and count one clock per call,
+ * so they are called on each clock elapsed since the previous device tick.
+ */
+static void athrill_exdev_supply_clock_legacy(AthrillExtDevEntryType *entryp, DeviceClockType *dev_clock)
+{
+	DeviceClockType clock = *dev_clock;
+	uint64 i;
+
+	clock.supply_clocks = 1U;
+	for (i = dev_clock->supply_clocks; i > 0U; i--) {
+		clock.clock = dev_clock->clock - (i - 1U);
+		entryp->devp->supply_clock(&clock);
+	}
+	dev_clock->can_skip_clock = clock.can_skip_clock;
+	dev_clock->min_intr_interval = clock.min_intr_interval;
+	return;
+}
+
 void device_supply_clock_exdev(DeviceClockType *dev_clock)
 {
     int i;
     for (i = 0; i < athrill_exdev.num; i++) {
+    	if (athrill_exdev.exdevs[i]->is_event_driven != FALSE) {
+    		continue;
+    	}
+    	if (athrill_exdev.exdevs[i]->devp->header.version < 3) {
+    		athrill_exdev_supply_clock_legacy(athrill_exdev.exdevs[i], dev_clock);
+    		continue;
+    	}
     	athrill_exdev.exdevs[i]->devp->supply_clock(dev_clock);
     }
     return;
@@ -91,6 +91,22 @@ Std_ReturnType mpthread_register(MpthrIdType *id, MpthrOperationType *op)
     return STD_E_OK;
 }
 
+void mpthread_fork_child(void)
+{
+    MpthrIdType id;
+
+    /*
+     * locks may be held by the parent threads at fork.
+     */
+    pthread_mutex_init(&mpthread_mutex, NULL);
+    for (id = 0; id < mpthread_num; id++) {
+        pthread_mutex_init(&mpthread_info[id].mutex, NULL);
+        pthread_cond_init(&mpthread_info[id].cond, NULL);
+        pthread_create(&mpthread_info[id].thread , NULL , mpthread_run , (void*)&mpthread_info[id]);
+    }
+    return;
+}
+
 /*
  * Thread api
  */
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE /* sendmmsg/recvmmsg */
 #include "athrill_device.h"
 #include "mpu_ops.h"
 #define ATHRILL_SYSCALL_DEVICE
@@ -16,10 +17,13 @@
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <sys/wait.h>
+#include <signal.h>
 #include "mpu_malloc.h"
 #include "assert.h"
 #include "target/target_os_api.h"
 #include "cpuemu_ops.h"
+#include "device_event.h"
 
 struct athrill_syscall_functable {
     void (*func) (AthrillSyscallArgType *arg);
@@ -56,6 +60,14 @@ static void athrill_syscall_ev3_closedir(AthrillSyscallArgType *arg);
 
 static void athrill_syscall_ev3_serial_open(AthrillSyscallArgType *arg);
 static void athrill_syscall_exit(AthrillSyscallArgType *arg);
+static void athrill_syscall_ring_setup(AthrillSyscallArgType *arg);
+static void athrill_syscall_ring_enter(AthrillSyscallArgType *arg);
+static void athrill_syscall_epoll_setup_api(AthrillSyscallArgType *arg);
+static void athrill_syscall_sendto(AthrillSyscallArgType *arg);
+static void athrill_syscall_recvfrom(AthrillSyscallArgType *arg);
+static void athrill_syscall_sendmmsg(AthrillSyscallArgType *arg);
+static void athrill_syscall_recvmmsg(AthrillSyscallArgType *arg);
+static void athrill_system_helper_fork_child(void);
 
 
 
@@ -92,8 +104,58 @@ static struct athrill_syscall_functable syscall_table[SYS_API_ID_NUM] = {
     { athrill_syscall_ev3_serial_open },
 
     { athrill_syscall_exit },
+    { athrill_syscall_ring_setup },
+    { athrill_syscall_ring_enter },
+    { athrill_syscall_epoll_setup_api },
+    { athrill_syscall_sendto },
+    { athrill_syscall_recvfrom },
+    { athrill_syscall_sendmmsg },
+    { athrill_syscall_recvmmsg },
 };
 
+static uint64 athrill_syscall_bytes(AthrillSyscallArgType *argp)
+{
+    Std_ReturnType err;
+    struct sys_mmsghdr *sys_msgs;
+    uint64 bytes = 0U;
+    sys_int32 i;
+
+    if (argp->ret_value <= 0) {
+        return 0U;
+    }
+    switch (argp->api_id) {
+    case SYS_API_ID_SEND:
+    case SYS_API_ID_RECV:
+    case SYS_API_ID_READ_R:
+    case SYS_API_ID_WRITE_R:
+    case SYS_API_ID_SENDTO:
+    case SYS_API_ID_RECVFROM:
+        bytes = (uint64)argp->ret_value;
+        break;
+    case SYS_API_ID_SENDMMSG:
+    case SYS_API_ID_RECVMMSG:
+        err = mpu_get_pointer(0U, argp->body.api_mmsg.msgvec, (uint8 **)&sys_msgs);
+        if (err != 0) {
+            break;
+        }
+        for (i = 0; i < argp->ret_value; i++) {
+            bytes += sys_msgs[i].msg_len;
+        }
+        break;
+    default:
+        break;
+    }
+    return bytes;
+}
+static void athrill_syscall_call(AthrillSyscallArgType *argp)
+{
+    uint64 start_ns = athrill_syscall_stat_start();
+
+    syscall_table[argp->api_id].func(argp);
+    athrill_syscall_stat_end(argp->api_id, start_ns, athrill_syscall_bytes(argp));
+    return;
+}
+
 void athrill_syscall_device(uint32 addr)
 {
     Std_ReturnType err;
@@ -107,7 +169,257 @@ void athrill_syscall_device(uint32 addr)
     if (argp->api_id >= SYS_API_ID_NUM) {
         return;
     }
-    syscall_table[argp->api_id].func(argp);
+    athrill_syscall_call(argp);
+    return;
+}
+
+/*
+ * syscall rings.
+ * ring geometry(masks and entry arrays) is validated on setup, and host pointers are kept:
+ * guest can change only heads and tails after setup, and they are range checked on each drain.
+ * SQPOLL: guest stores on the ring header are hooked, and SQ is drained on the next device clock.
+ */
+typedef struct {
+    sys_addr   ring;
+    sys_uint32 flags;
+    sys_uint32 intno;
+    sys_uint32 sq_mask;
+    sys_addr   sq_entries;
+    sys_uint32 cq_mask;
+    sys_addr   cq_entries;
+} AthrillSyscallRingConfigType;
+static AthrillSyscallRingConfigType athrill_syscall_ring;
+
+/*
+ * host pointers of athrill_syscall_ring(not saved in snapshot).
+ */
+typedef struct {
+    AthrillSyscallRingType          *ring;
+    AthrillSyscallRingSqEntryType   *sqes;
+    AthrillSyscallRingCqEntryType   *cqes;
+    DeviceEventType                 event;
+} AthrillSyscallRingHostType;
+static AthrillSyscallRingHostType athrill_syscall_ring_host;
+
+static void athrill_syscall_ring_call(AthrillSyscallRingSqEntryType *sqe, AthrillSyscallRingCqEntryType *cqe)
+{
+    Std_ReturnType err;
+    AthrillSyscallArgType *argp;
+
+    cqe->user_data = sqe->user_data;
+    cqe->ret_errno = 0;
+    err = mpu_get_pointer(0U, sqe->argp, (uint8 **)&argp);
+    if (err != 0) {
+        cqe->ret_value = SYS_API_ERR_FAULT;
+        return;
+    }
+    /*
+     * rings can not be operated from the ring itself.
+     */
+    if ((argp->api_id >= SYS_API_ID_NUM) ||
+            (argp->api_id == SYS_API_ID_RING_SETUP) || (argp->api_id == SYS_API_ID_RING_ENTER)) {
+        argp->ret_value = SYS_API_ERR_INVAL;
+    }
+    else {
+        athrill_syscall_call(argp);
+    }
+    cqe->ret_value = argp->ret_value;
+    cqe->ret_errno = argp->ret_errno;
+    return;
+}
+static sys_int32 athrill_syscall_ring_drain(void)
+{
+    AthrillSyscallRingType *ring = athrill_syscall_ring_host.ring;
+    sys_uint32 head;
+    sys_uint32 tail;
+    sys_uint32 cq_tail;
+    sys_int32 count = 0;
+
+    if (ring == NULL) {
+        return SYS_API_ERR_INVAL;
+    }
+    head = ring->sq_head;
+    tail = ring->sq_tail;
+    cq_tail = ring->cq_tail;
+    if (((tail - head) > (athrill_syscall_ring.sq_mask + 1U)) ||
+            ((cq_tail - ring->cq_head) > (athrill_syscall_ring.cq_mask + 1U))) {
+        return SYS_API_ERR_INVAL;
+    }
+    for (; head != tail; head++) {
+        /*
+         * CQ is full: rest of SQ is handled after guest reaps CQ.
+         */
+        if ((cq_tail - ring->cq_head) > athrill_syscall_ring.cq_mask) {
+            break;
+        }
+        athrill_syscall_ring_call(&athrill_syscall_ring_host.sqes[head & athrill_syscall_ring.sq_mask],
+                &athrill_syscall_ring_host.cqes[cq_tail & athrill_syscall_ring.cq_mask]);
+        cq_tail++;
+        count++;
+    }
+    ring->sq_head = head;
+    ring->cq_tail = cq_tail;
+    if ((count > 0) && (athrill_syscall_ring.intno != 0U)) {
+        (void)intc_raise_intr(athrill_syscall_ring.intno);
+    }
+    return count;
+}
+static void athrill_syscall_ring_event_handler(DeviceEventType *event, DeviceClockType *dev_clock)
+{
+    (void)athrill_syscall_ring_drain();
+    return;
+}
+static void athrill_syscall_ring_hook(CoreIdType core_id, uint32 addr)
+{
+    if (device_event_is_set(&athrill_syscall_ring_host.event) == FALSE) {
+        (void)device_event_set(&athrill_syscall_ring_host.event, cpuemu_get_total_clocks() + 1U);
+    }
+    return;
+}
+
+/*
+ * [addr, addr + size) must be on one memory region.
+ */
+static Std_ReturnType athrill_syscall_ring_pointer(sys_addr addr, uint64 size, uint8 **ptr)
+{
+    uint32 len;
+
+    if (mpu_get_pointer_range(0U, addr, ptr, &len) != STD_E_OK) {
+        return STD_E_SEGV;
+    }
+    if (size > len) {
+        return STD_E_SEGV;
+    }
+    return STD_E_OK;
+}
+static sys_int32 athrill_syscall_ring_resolve(const AthrillSyscallRingConfigType *config, AthrillSyscallRingHostType *host)
+{
+    if ((config->sq_mask & (config->sq_mask + 1U)) != 0U) {
+        return SYS_API_ERR_INVAL;
+    }
+    if ((config->cq_mask & (config->cq_mask + 1U)) != 0U) {
+        return SYS_API_ERR_INVAL;
+    }
+    if (athrill_syscall_ring_pointer(config->ring, sizeof(AthrillSyscallRingType), (uint8 **)&host->ring) != STD_E_OK) {
+        return SYS_API_ERR_FAULT;
+    }
+    if (athrill_syscall_ring_pointer(config->sq_entries,
+            (((uint64)config->sq_mask) + 1U) * sizeof(AthrillSyscallRingSqEntryType), (uint8 **)&host->sqes) != STD_E_OK) {
+        return SYS_API_ERR_FAULT;
+    }
+    if (athrill_syscall_ring_pointer(config->cq_entries,
+            (((uint64)config->cq_mask) + 1U) * sizeof(AthrillSyscallRingCqEntryType), (uint8 **)&host->cqes) != STD_E_OK) {
+        return SYS_API_ERR_FAULT;
+    }
+    return SYS_API_ERR_OK;
+}
+static void athrill_syscall_ring_clear(void)
+{
+    if ((athrill_syscall_ring.flags & SYS_RING_FLAG_SQPOLL) != 0U) {
+        mpu_address_clear_write_hook(athrill_syscall_ring.ring, athrill_syscall_ring_hook);
+    }
+    device_event_cancel(&athrill_syscall_ring_host.event);
+    memset(&athrill_syscall_ring, 0, sizeof(athrill_syscall_ring));
+    athrill_syscall_ring_host.ring = NULL;
+    athrill_syscall_ring_host.sqes = NULL;
+    athrill_syscall_ring_host.cqes = NULL;
+    return;
+}
+static sys_int32 athrill_syscall_ring_start(const AthrillSyscallRingConfigType *config)
+{
+    AthrillSyscallRingHostType host;
+    sys_int32 ret;
+
+    ret = athrill_syscall_ring_resolve(config, &host);
+    if (ret != SYS_API_ERR_OK) {
+        return ret;
+    }
+    if ((config->flags & SYS_RING_FLAG_SQPOLL) != 0U) {
+        if (mpu_address_set_write_hook(config->ring, sizeof(AthrillSyscallRingType), athrill_syscall_ring_hook) != STD_E_OK) {
+            return SYS_API_ERR_NOMEM;
+        }
+        /*
+         * entries submitted before setup.
+         */
+        (void)device_event_set(&athrill_syscall_ring_host.event, cpuemu_get_total_clocks() + 1U);
+    }
+    athrill_syscall_ring = *config;
+    athrill_syscall_ring_host.ring = host.ring;
+    athrill_syscall_ring_host.sqes = host.sqes;
+    athrill_syscall_ring_host.cqes = host.cqes;
+    return SYS_API_ERR_OK;
+}
+static void athrill_syscall_ring_setup(AthrillSyscallArgType *arg)
+{
+    AthrillSyscallRingConfigType config;
+    AthrillSyscallRingType *ring;
+
+    athrill_syscall_ring_clear();
+    if (arg->body.api_ring_setup.ring == 0U) {
+        arg->ret_value = SYS_API_ERR_OK;
+        return;
+    }
+    if (athrill_syscall_ring_pointer(arg->body.api_ring_setup.ring, sizeof(AthrillSyscallRingType), (uint8 **)&ring) != STD_E_OK) {
+        arg->ret_value = SYS_API_ERR_FAULT;
+        return;
+    }
+    config.ring = arg->body.api_ring_setup.ring;
+    config.flags = arg->body.api_ring_setup.flags;
+    config.intno = arg->body.api_ring_setup.intno;
+    config.sq_mask = ring->sq_mask;
+    config.sq_entries = ring->sq_entries;
+    config.cq_mask = ring->cq_mask;
+    config.cq_entries = ring->cq_entries;
+    arg->ret_value = athrill_syscall_ring_start(&config);
+    return;
+}
+static void athrill_syscall_ring_enter(AthrillSyscallArgType *arg)
+{
+    arg->ret_value = athrill_syscall_ring_drain();
+    return;
+}
+static void athrill_syscall_epoll_setup_api(AthrillSyscallArgType *arg)
+{
+    arg->ret_value = athrill_syscall_epoll_setup(arg->body.api_epoll_setup.readfds,
+            arg->body.api_epoll_setup.writefds, arg->body.api_epoll_setup.intno);
+    return;
+}
+static Std_ReturnType athrill_syscall_ring_snapshot_save(SnapshotStreamType *stream, void *arg)
+{
+    return snapshot_write(stream, &athrill_syscall_ring, sizeof(athrill_syscall_ring));
+}
+static Std_ReturnType athrill_syscall_ring_snapshot_restore(SnapshotStreamType *stream, void *arg)
+{
+    Std_ReturnType err;
+    AthrillSyscallRingConfigType config;
+
+    err = snapshot_read(stream, &config, sizeof(config));
+    if (err != STD_E_OK) {
+        return err;
+    }
+    athrill_syscall_ring_clear();
+    if (config.ring == 0U) {
+        return STD_E_OK;
+    }
+    /*
+     * memory regions are restored before devices.
+     */
+    if (athrill_syscall_ring_start(&config) != SYS_API_ERR_OK) {
+        printf("ERROR: syscall ring(0x%x) can not be restored\n", config.ring);
+        return STD_E_INVALID;
+    }
+    return STD_E_OK;
+}
+static const SnapshotOperationType athrill_syscall_ring_snapshot_operation = {
+    .save = athrill_syscall_ring_snapshot_save,
+    .restore = athrill_syscall_ring_snapshot_restore,
+};
+void athrill_syscall_device_init(void)
+{
+    device_event_init(&athrill_syscall_ring_host.event, athrill_syscall_ring_event_handler, NULL);
+    (void)snapshot_register("syscall_ring", &athrill_syscall_ring_snapshot_operation, NULL);
+    (void)snapshot_register_fork_child(athrill_system_helper_fork_child);
+    athrill_syscall_stat_init();
     return;
 }
 
@@ -118,11 +430,16 @@ static void athrill_syscall_none(AthrillSyscallArgType *arg)
 }
 static void athrill_syscall_socket(AthrillSyscallArgType *arg)
 {
-    int sockfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    int type = SOCK_STREAM;
+    if (arg->body.api_socket.type == ATHRILL_SYSCALL_SOCKET_TYPE_DGRAM) {
+        type = SOCK_DGRAM;
+    }
+    int sockfd = socket(AF_INET, type | SOCK_NONBLOCK, 0);
     if (sockfd < 0) {
     	printf("ERROR:%s(): errno=%d\n", __FUNCTION__, errno);
         return;
     }
+    athrill_syscall_epoll_add(sockfd);
     arg->ret_value = sockfd;
     return;
 }
@@ -235,8 +552,12 @@ static void athrill_syscall_accept(AthrillSyscallArgType *arg)
     int ret = accept(arg->body.api_accept.sockfd, (struct sockaddr *)&client_addr, &addrlen);
     if (ret < 0) {
         arg->ret_value = -errno;
+        if (arg->ret_value == -EAGAIN) {
+            athrill_syscall_epoll_clear(arg->body.api_accept.sockfd, FALSE);
+        }
     }
     else {
+        athrill_syscall_epoll_add(ret);
         sockaddrp->sin_family = PF_INET;
         sockaddrp->sin_port = ntohs(client_addr.sin_port);
         sockaddrp->sin_addr = ntohl(client_addr.sin_addr.s_addr);
@@ -367,21 +688,46 @@ static void athrill_syscall_select(AthrillSyscallArgType *arg)
 
     return;
 }
+/*
+ * guest buffer of len bytes must not cross the end of its region.
+ */
+static Std_ReturnType athrill_syscall_get_buffer(sys_addr addr, sys_uint32 len, uint8 **bufp)
+{
+    Std_ReturnType err;
+    uint32 size;
+
+    err = mpu_get_pointer_range(0U, addr, bufp, &size);
+    if (err != 0) {
+        return err;
+    }
+    if (len > size) {
+        printf("ERROR: syscall buffer addr=0x%x len=%u crosses region(remain=%u)\n", addr, len, size);
+        return STD_E_SEGV;
+    }
+    return STD_E_OK;
+}
+
 static void athrill_syscall_send(AthrillSyscallArgType *arg)
 {
     Std_ReturnType err;
     char *bufp;
     ssize_t ret;
 
-    err = mpu_get_pointer(0U, arg->body.api_send.buf, (uint8 **)&bufp);
+    err = athrill_syscall_get_buffer(arg->body.api_send.buf, arg->body.api_send.len, (uint8 **)&bufp);
     if (err != 0) {
+        arg->ret_value = SYS_API_ERR_FAULT;
         return;
     }
     ret = send(arg->body.api_send.sockfd, bufp, arg->body.api_send.len, MSG_DONTWAIT);
     if (ret < 0) {
         arg->ret_value = -errno;
+        if (arg->ret_value == -EAGAIN) {
+            athrill_syscall_epoll_clear(arg->body.api_send.sockfd, TRUE);
+        }
+    }
+    else {
+        arg->ret_value = ret;
     }
-    arg->ret_value = ret;
     return;
 }
 
@@ -391,34 +737,436 @@ static void athrill_syscall_recv(AthrillSyscallArgType *arg)
     char *bufp;
     ssize_t ret;
 
-    err = mpu_get_pointer(0U, arg->body.api_recv.buf, (uint8 **)&bufp);
+    err = athrill_syscall_get_buffer(arg->body.api_recv.buf, arg->body.api_recv.len, (uint8 **)&bufp);
     if (err != 0) {
+        arg->ret_value = SYS_API_ERR_FAULT;
         return;
     }
     ret = recv(arg->body.api_recv.sockfd, bufp, arg->body.api_recv.len, MSG_DONTWAIT);
     if (ret < 0) {
         arg->ret_value = -errno;
+        if (arg->ret_value == -EAGAIN) {
+            athrill_syscall_epoll_clear(arg->body.api_recv.sockfd, FALSE);
+        }
+    }
+    else {
+        mpu_address_notify_host_write(arg->body.api_recv.buf, (uint32)ret);
+        arg->ret_value = ret;
     }
-    arg->ret_value = ret;
     return;
 }
 
 static void athrill_syscall_shutdown(AthrillSyscallArgType *arg)
 {
     arg->ret_value = SYS_API_ERR_OK;
+    athrill_syscall_epoll_remove(arg->body.api_shutdown.sockfd);
     (void)close(arg->body.api_shutdown.sockfd);
     return;
 }
 
+static void sockaddr_from_sys(struct sockaddr_in *dst, const struct sys_sockaddr_in *src)
+{
+    memset(dst, 0, sizeof(*dst));
+    dst->sin_family = PF_INET;
+    dst->sin_addr.s_addr = (src->sin_addr);
+    dst->sin_port = (src->sin_port);
+    return;
+}
+static void sockaddr_to_sys(struct sys_sockaddr_in *dst, const struct sockaddr_in *src)
+{
+    dst->sin_family = PF_INET;
+    dst->sin_addr = (src->sin_addr.s_addr);
+    dst->sin_port = (src->sin_port);
+    return;
+}
+
+static void athrill_syscall_sendto(AthrillSyscallArgType *arg)
+{
+    Std_ReturnType err;
+    char *bufp;
+    struct sys_sockaddr_in *sockaddrp;
+    struct sockaddr_in addr;
+    ssize_t ret;
+
+    err = athrill_syscall_get_buffer(arg->body.api_sendto.buf, arg->body.api_sendto.len, (uint8 **)&bufp);
+    if (err != 0) {
+        arg->ret_value = SYS_API_ERR_FAULT;
+        return;
+    }
+    err = athrill_syscall_get_buffer(arg->body.api_sendto.sockaddr, sizeof(struct sys_sockaddr_in), (uint8 **)&sockaddrp);
+    if (err != 0) {
+        arg->ret_value = SYS_API_ERR_FAULT;
+        return;
+    }
+    sockaddr_from_sys(&addr, sockaddrp);
+    ret = sendto(arg->body.api_sendto.sockfd, bufp, arg->body.api_sendto.len, MSG_DONTWAIT,
+            (struct sockaddr *)&addr, sizeof(addr));
+    if (ret < 0) {
+        arg->ret_value = -errno;
+        if (arg->ret_value == -EAGAIN) {
+            athrill_syscall_epoll_clear(arg->body.api_sendto.sockfd, TRUE);
+        }
+    }
+    else {
+        arg->ret_value = ret;
+    }
+    return;
+}
+
+static void athrill_syscall_recvfrom(AthrillSyscallArgType *arg)
+{
+    Std_ReturnType err;
+    char *bufp;
+    struct sys_sockaddr_in *sockaddrp = NULL;
+    struct sockaddr_in addr;
+    socklen_t addrlen = sizeof(addr);
+    ssize_t ret;
+
+    err = athrill_syscall_get_buffer(arg->body.api_recvfrom.buf, arg->body.api_recvfrom.len, (uint8 **)&bufp);
+    if (err != 0) {
+        arg->ret_value = SYS_API_ERR_FAULT;
+        return;
+    }
+    if (arg->body.api_recvfrom.sockaddr != 0) {
+        err = athrill_syscall_get_buffer(arg->body.api_recvfrom.sockaddr, sizeof(struct sys_sockaddr_in), (uint8 **)&sockaddrp);
+        if (err != 0) {
+            arg->ret_value = SYS_API_ERR_FAULT;
+            return;
+        }
+    }
+    memset(&addr, 0, sizeof(addr));
+    ret = recvfrom(arg->body.api_recvfrom.sockfd, bufp, arg->body.api_recvfrom.len, MSG_DONTWAIT,
+            (struct sockaddr *)&addr, &addrlen);
+    if (ret < 0) {
+        arg->ret_value = -errno;
+        if (arg->ret_value == -EAGAIN) {
+            athrill_syscall_epoll_clear(arg->body.api_recvfrom.sockfd, FALSE);
+        }
+    }
+    else {
+        mpu_address_notify_host_write(arg->body.api_recvfrom.buf, (uint32)ret);
+        if (sockaddrp != NULL) {
+            sockaddr_to_sys(sockaddrp, &addr);
+        }
+        arg->ret_value = ret;
+    }
+    return;
+}
+
+/*
+ * batched datagrams: one guest syscall moves up to SYS_MMSG_VLEN_MAX messages.
+ */
+typedef struct {
+    struct mmsghdr      msgs[SYS_MMSG_VLEN_MAX];
+    struct iovec        iovs[SYS_MMSG_VLEN_MAX];
+    struct sockaddr_in  addrs[SYS_MMSG_VLEN_MAX];
+} AthrillSyscallMmsgType;
+static AthrillSyscallMmsgType athrill_syscall_mmsg;
+
+static sys_int32 athrill_syscall_mmsg_prepare(AthrillSyscallArgType *arg, struct sys_mmsghdr **sys_msgsp, bool is_send)
+{
+    Std_ReturnType err;
+    struct sys_mmsghdr *sys_msgs;
+    struct sys_sockaddr_in *sockaddrp;
+    uint8 *bufp;
+    sys_uint32 vlen = arg->body.api_mmsg.vlen;
+    sys_uint32 i;
+
+    if ((vlen == 0U) || (vlen > SYS_MMSG_VLEN_MAX)) {
+        return SYS_API_ERR_INVAL;
+    }
+    err = athrill_syscall_get_buffer(arg->body.api_mmsg.msgvec, sizeof(struct sys_mmsghdr) * vlen, (uint8 **)&sys_msgs);
+    if (err != 0) {
+        return SYS_API_ERR_FAULT;
+    }
+    memset(athrill_syscall_mmsg.msgs, 0, sizeof(struct mmsghdr) * vlen);
+    for (i = 0; i < vlen; i++) {
+        err = athrill_syscall_get_buffer(sys_msgs[i].buf, sys_msgs[i].len, &bufp);
+        if (err != 0) {
+            return SYS_API_ERR_FAULT;
+        }
+        athrill_syscall_mmsg.iovs[i].iov_base = bufp;
+        athrill_syscall_mmsg.iovs[i].iov_len = sys_msgs[i].len;
+        athrill_syscall_mmsg.msgs[i].msg_hdr.msg_iov = &athrill_syscall_mmsg.iovs[i];
+        athrill_syscall_mmsg.msgs[i].msg_hdr.msg_iovlen = 1;
+        if (sys_msgs[i].sockaddr == 0) {
+            continue;
+        }
+        if (is_send != FALSE) {
+            err = athrill_syscall_get_buffer(sys_msgs[i].sockaddr, sizeof(struct sys_sockaddr_in), (uint8 **)&sockaddrp);
+            if (err != 0) {
+                return SYS_API_ERR_FAULT;
+            }
+            sockaddr_from_sys(&athrill_syscall_mmsg.addrs[i], sockaddrp);
+        }
+        athrill_syscall_mmsg.msgs[i].msg_hdr.msg_name = &athrill_syscall_mmsg.addrs[i];
+        athrill_syscall_mmsg.msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    }
+    *sys_msgsp = sys_msgs;
+    return SYS_API_ERR_OK;
+}
+
+static void athrill_syscall_sendmmsg(AthrillSyscallArgType *arg)
+{
+    struct sys_mmsghdr *sys_msgs;
+    int ret;
+    int i;
+
+    arg->ret_value = athrill_syscall_mmsg_prepare(arg, &sys_msgs, TRUE);
+    if (arg->ret_value != SYS_API_ERR_OK) {
+        return;
+    }
+    ret = sendmmsg(arg->body.api_mmsg.sockfd, athrill_syscall_mmsg.msgs, arg->body.api_mmsg.vlen, MSG_DONTWAIT);
+    if (ret < 0) {
+        arg->ret_value = -errno;
+        if (arg->ret_value == -EAGAIN) {
+            athrill_syscall_epoll_clear(arg->body.api_mmsg.sockfd, TRUE);
+        }
+        return;
+    }
+    for (i = 0; i < ret; i++) {
+        sys_msgs[i].msg_len = athrill_syscall_mmsg.msgs[i].msg_len;
+    }
+    arg->ret_value = ret;
+    return;
+}
+
+static void athrill_syscall_recvmmsg(AthrillSyscallArgType *arg)
+{
+    Std_ReturnType err;
+    struct sys_mmsghdr *sys_msgs;
+    struct sys_sockaddr_in *sockaddrp;
+    int ret;
+    int i;
+
+    arg->ret_value = athrill_syscall_mmsg_prepare(arg, &sys_msgs, FALSE);
+    if (arg->ret_value != SYS_API_ERR_OK) {
+        return;
+    }
+    ret = recvmmsg(arg->body.api_mmsg.sockfd, athrill_syscall_mmsg.msgs, arg->body.api_mmsg.vlen, MSG_DONTWAIT, NULL);
+    if (ret < 0) {
+        arg->ret_value = -errno;
+        if (arg->ret_value == -EAGAIN) {
+            athrill_syscall_epoll_clear(arg->body.api_mmsg.sockfd, FALSE);
+        }
+        return;
+    }
+    for (i = 0; i < ret; i++) {
+        sys_msgs[i].msg_len = athrill_syscall_mmsg.msgs[i].msg_len;
+        mpu_address_notify_host_write(sys_msgs[i].buf, athrill_syscall_mmsg.msgs[i].msg_len);
+        if (sys_msgs[i].sockaddr == 0) {
+            continue;
+        }
+        err = athrill_syscall_get_buffer(sys_msgs[i].sockaddr, sizeof(struct sys_sockaddr_in), (uint8 **)&sockaddrp);
+        if (err == 0) {
+            sockaddr_to_sys(sockaddrp, &athrill_syscall_mmsg.addrs[i]);
+        }
+    }
+    arg->ret_value = ret;
+    return;
+}
+
+/*
+ * system helper: a persistent shell which runs athrill_extfunc.sh(DEVICE_CONFIG_SYSTEM_HELPER=1).
+ *
+ * the script is sourced in a subshell of the helper, so only a fork is needed per call
+ * instead of fork/exec of two shells by system().
+ * output of the script is copied to stdout, and the exit status is returned on the last line
+ * after the status mark, which has a nonce of the helper and the sequence number of the call.
+ * helper is started before threads are created(fork of a multi-threaded process is unsafe),
+ * and per-call system() is used when the helper is disabled or dead.
+ * ret_value is the exit status only when the helper is enabled: it is SYS_API_ERR_OK
+ * without the helper, as guests expect.
+ */
+#define ATHRILL_SYSTEM_HELPER_SCRIPT        "athrill_extfunc.sh"
+#define ATHRILL_SYSTEM_HELPER_MARK_SIZE     64
+#define ATHRILL_SYSTEM_HELPER_LINE_SIZE     512
+typedef struct {
+    bool    is_enabled;
+    pid_t   pid;
+    int     fd;
+    uint32  nonce;
+    uint32  seq;
+} AthrillSystemHelperType;
+static AthrillSystemHelperType athrill_system_helper = {
+    .is_enabled = FALSE,
+    .pid = -1,
+    .fd = -1,
+};
+
+static void athrill_system_helper_start(void)
+{
+    uint32 enable = 0;
+    int sv[2];
+    pid_t pid;
+    struct timespec ts;
+
+    (void)cpuemu_get_devcfg_value("DEVICE_CONFIG_SYSTEM_HELPER", &enable);
+    if (enable == 0) {
+        return;
+    }
+    athrill_system_helper.is_enabled = TRUE;
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0) {
+        printf("ERROR: system helper socketpair errno=%d\n", errno);
+        return;
+    }
+    fflush(stdout);
+    pid = fork();
+    if (pid < 0) {
+        printf("ERROR: system helper fork errno=%d\n", errno);
+        close(sv[0]);
+        close(sv[1]);
+        return;
+    }
+    if (pid == 0) {
+        (void)dup2(sv[1], STDIN_FILENO);
+        (void)dup2(sv[1], STDOUT_FILENO);
+        execl("/bin/sh", "sh", "-s", (char*)NULL);
+        _exit(127);
+    }
+    close(sv[1]);
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    athrill_system_helper.pid = pid;
+    athrill_system_helper.fd = sv[0];
+    athrill_system_helper.nonce = ((uint32)ts.tv_nsec) ^ ((uint32)ts.tv_sec << 16) ^ ((uint32)pid);
+    athrill_system_helper.seq = 0;
+    printf("system helper started: pid=%d\n", (int)pid);
+    return;
+}
+void athrill_system_helper_init(void)
+{
+    athrill_system_helper_start();
+    return;
+}
+/*
+ * helper of the parent is shared with other variants after fork: forked variant starts its own.
+ * fork child hooks run before threads of the variant are created.
+ */
+static void athrill_system_helper_fork_child(void)
+{
+    if (athrill_system_helper.fd < 0) {
+        return;
+    }
+    close(athrill_system_helper.fd);
+    athrill_system_helper.fd = -1;
+    athrill_system_helper.pid = -1;
+    athrill_system_helper_start();
+    return;
+}
+static void athrill_system_helper_stop(void)
+{
+    printf("WARNING: system helper is stopped: fallback to system()\n");
+    close(athrill_system_helper.fd);
+    athrill_system_helper.fd = -1;
+    (void)kill(athrill_system_helper.pid, SIGKILL);
+    (void)waitpid(athrill_system_helper.pid, NULL, 0);
+    athrill_system_helper.pid = -1;
+    return;
+}
+/*
+ * line is the status line when it ends with "<mark><status>\n".
+ * bytes before the mark are output of the script without the last newline.
+ */
+static bool athrill_system_helper_parse(char *line, uint32 len, const char *mark, uint32 mark_len, sys_int32 *status)
+{
+    char *markp;
+    char *endp;
+    long value;
+
+    if ((len == 0U) || (line[len - 1U] != '\n')) {
+        return FALSE;
+    }
+    line[len] = '\0';
+    markp = memmem(line, len, mark, mark_len);
+    if (markp == NULL) {
+        return FALSE;
+    }
+    errno = 0;
+    value = strtol(&markp[mark_len], &endp, 10);
+    if ((errno != 0) || (endp == &markp[mark_len]) || (*endp != '\n')) {
+        return FALSE;
+    }
+    fwrite(line, 1, markp - line, stdout);
+    *status = (sys_int32)value;
+    return TRUE;
+}
+static Std_ReturnType athrill_system_helper_call(uint32 id, sys_int32 *status)
+{
+    char mark[ATHRILL_SYSTEM_HELPER_MARK_SIZE];
+    char line[ATHRILL_SYSTEM_HELPER_LINE_SIZE + 1];
+    char buf[256];
+    int mark_len;
+    int len;
+    uint32 line_len = 0;
+    uint32 keep;
+    ssize_t ret;
+    ssize_t i;
+
+    athrill_system_helper.seq++;
+    mark_len = snprintf(mark, sizeof(mark), "athrill-status-%08x-%u:",
+            athrill_system_helper.nonce, athrill_system_helper.seq);
+    len = snprintf(buf, sizeof(buf), "( set -- %u; . %s ) </dev/null; printf '%s%%d\\n' $?\n",
+            id, ATHRILL_SYSTEM_HELPER_SCRIPT, mark);
+    if ((len < 0) || (len >= (int)sizeof(buf))) {
+        return STD_E_INVALID;
+    }
+    if (send(athrill_system_helper.fd, buf, len, MSG_NOSIGNAL) != len) {
+        return STD_E_INVALID;
+    }
+    while (TRUE) {
+        ret = recv(athrill_system_helper.fd, buf, sizeof(buf), 0);
+        if (ret <= 0) {
+            return STD_E_INVALID;
+        }
+        for (i = 0; i < ret; i++) {
+            line[line_len++] = buf[i];
+            if (buf[i] == '\n') {
+                if (athrill_system_helper_parse(line, line_len, mark, mark_len, status) != FALSE) {
+                    fflush(stdout);
+                    return STD_E_OK;
+                }
+                fwrite(line, 1, line_len, stdout);
+                line_len = 0;
+            }
+            else if (line_len >= ATHRILL_SYSTEM_HELPER_LINE_SIZE) {
+                /*
+                 * long line: the tail is kept, the mark may be split on it.
+                 */
+                keep = ATHRILL_SYSTEM_HELPER_MARK_SIZE + 16U;
+                fwrite(line, 1, line_len - keep, stdout);
+                memmove(line, &line[line_len - keep], keep);
+                line_len = keep;
+            }
+        }
+    }
+    return STD_E_OK;
+}
+
 static void athrill_syscall_system(AthrillSyscallArgType *arg)
 {
 	char cmd[256];
+    sys_int32 status;
+    int ret;
+
+    if (athrill_system_helper.fd >= 0) {
+        if (athrill_system_helper_call(arg->body.api_system.id, &status) == STD_E_OK) {
+            arg->ret_value = status;
+            return;
+        }
+        athrill_system_helper_stop();
+    }
    	snprintf(cmd, sizeof(cmd), "athrill_extfunc.sh %u", arg->body.api_system.id);
-   	if (system(cmd) < 0) {
+   	ret = system(cmd);
+   	if (ret < 0) {
    		printf("can not execute athrill_extfunc.sh\n");
         return;
    	}
-    arg->ret_value = SYS_API_ERR_OK;
+    if ((athrill_system_helper.is_enabled != FALSE) && WIFEXITED(ret)) {
+        arg->ret_value = WEXITSTATUS(ret);
+    }
+    else {
+        arg->ret_value = SYS_API_ERR_OK;
+    }
     return;
 }
 
@@ -454,6 +1202,7 @@ static void athrill_syscall_calloc(AthrillSyscallArgType *arg)
     ASSERT(err == 0);
 
     memset((void*)addrp, 0, size);
+    mpu_address_notify_host_write(arg->body.api_calloc.rptr, size);
     return;
 }
 
@@ -477,6 +1226,7 @@ static void athrill_syscall_realloc(AthrillSyscallArgType *arg)
     uint32 size = mpu_malloc_ref_size(arg->body.api_realloc.ptr);
  
     memcpy((void*)dest_addrp, (void*)src_addrp, size);
+    mpu_address_notify_host_write(arg->body.api_realloc.rptr, size);
 
     mpu_malloc_rel_memory(arg->body.api_realloc.ptr);
     return;
@@ -597,6 +1347,153 @@ static inline int is_stream_fd(int fd)
     return get_correspond_fd(fd) != fd;
 }
 
+/*
+ * virtual file fast path.
+ *
+ * guest buffers are transferred directly to/from host memory of the region,
+ * and split into chunks only when a buffer crosses regions.
+ * when DEVICE_CONFIG_VIRTFS_CACHE is set, read only regular files up to
+ * DEVICE_CONFIG_VIRTFS_CACHE_MAX_SIZE bytes(default VIRTFS_CACHE_MAX_SIZE) are copied
+ * to the host heap on open, and read_r/lseek_r of them are served by memcpy without host syscalls.
+ * larger files are read by read() as usual, so the heap is bounded by the limit per open file.
+ * the file is copied instead of cacheped: a cacheping of a file truncated by another writer
+ * raises SIGBUS on access.
+ */
+#define VIRTFS_CACHE_MAX_SIZE   (1024U * 1024U)
+typedef struct {
+    uint8   *data;
+    size_t  size;
+    off_t   pos;
+} VirtFsCacheType;
+static VirtFsCacheType virtfs_cache[SPECIAL_FD_NUM];
+static int virtfs_cache_enable = -1;
+static uint32 virtfs_cache_max_size = VIRTFS_CACHE_MAX_SIZE;
+
+static inline VirtFsCacheType *virtfs_get_cache(int fd)
+{
+    if ((fd < 0) || (fd >= SPECIAL_FD_NUM) || (virtfs_cache[fd].data == NULL)) {
+        return NULL;
+    }
+    return &virtfs_cache[fd];
+}
+static void virtfs_cache_open(int fd, int flags)
+{
+    struct stat st;
+    uint8 *data;
+    size_t total = 0;
+    ssize_t ret;
+
+    if (virtfs_cache_enable < 0) {
+        uint32 enable = 0;
+        (void)cpuemu_get_devcfg_value("DEVICE_CONFIG_VIRTFS_CACHE", &enable);
+        (void)cpuemu_get_devcfg_value("DEVICE_CONFIG_VIRTFS_CACHE_MAX_SIZE", &virtfs_cache_max_size);
+        virtfs_cache_enable = (enable != 0);
+    }
+    if ((virtfs_cache_enable == 0) || (fd < 0) || (fd >= SPECIAL_FD_NUM)) {
+        return;
+    }
+    if ((flags & O_ACCMODE) != O_RDONLY) {
+        return;
+    }
+    if ((fstat(fd, &st) < 0) || !S_ISREG(st.st_mode) || (st.st_size == 0)) {
+        return;
+    }
+    if (st.st_size > (off_t)virtfs_cache_max_size) {
+        return;
+    }
+    data = malloc(st.st_size);
+    if (data == NULL) {
+        return;
+    }
+    while (total < (size_t)st.st_size) {
+        ret = pread(fd, &data[total], st.st_size - total, total);
+        if (ret <= 0) {
+            break;
+        }
+        total += ret;
+    }
+    /*
+     * file is changed while it is loaded: falls back to read().
+     */
+    if (total != (size_t)st.st_size) {
+        free(data);
+        return;
+    }
+    virtfs_cache[fd].data = data;
+    virtfs_cache[fd].size = total;
+    virtfs_cache[fd].pos = 0;
+    return;
+}
+static void virtfs_cache_close(int fd)
+{
+    VirtFsCacheType *cachep = virtfs_get_cache(fd);
+
+    if (cachep == NULL) {
+        return;
+    }
+    free(cachep->data);
+    cachep->data = NULL;
+    return;
+}
+/*
+ * returns transferred bytes, or -1 with errno when nothing is transferred.
+ */
+static ssize_t virtfs_transfer(int fd, uint32 addr, size_t size, bool is_read)
+{
+    Std_ReturnType err;
+    VirtFsCacheType *cachep = (is_read != FALSE) ? virtfs_get_cache(fd) : NULL;
+    uint8 *ptr;
+    uint32 len;
+    size_t total = 0;
+    size_t chunk;
+    ssize_t ret;
+
+    if (cachep != NULL) {
+        if (cachep->pos >= cachep->size) {
+            return 0;
+        }
+        if (size > (cachep->size - cachep->pos)) {
+            size = cachep->size - cachep->pos;
+        }
+    }
+    while (total < size) {
+        err = mpu_get_pointer_range(0U, addr + total, &ptr, &len);
+        if (err != STD_E_OK) {
+            if (total > 0) {
+                break;
+            }
+            errno = EFAULT;
+            return -1;
+        }
+        chunk = ((size - total) < len) ? (size - total) : len;
+        if (cachep != NULL) {
+            memcpy(ptr, &cachep->data[cachep->pos], chunk);
+            cachep->pos += chunk;
+            ret = chunk;
+        }
+        else if (is_read != FALSE) {
+            ret = read(fd, ptr, chunk);
+        }
+        else {
+            ret = write(fd, ptr, chunk);
+        }
+        if (ret < 0) {
+            if (total > 0) {
+                break;
+            }
+            return -1;
+        }
+        if ((is_read != FALSE) && (ret > 0)) {
+            mpu_address_notify_host_write(addr + total, (uint32)ret);
+        }
+        total += ret;
+        if (ret < chunk) {
+            break;
+        }
+    }
+    return total;
+}
+
 
 
 static void athrill_syscall_open_r(AthrillSyscallArgType *arg)
@@ -611,6 +1508,7 @@ static void athrill_syscall_open_r(AthrillSyscallArgType *arg)
     err = mpu_get_pointer(0U, arg->body.api_open_r.file_name,(uint8**)&file_name);
     ASSERT(err == 0);
     fd = open(getVirtualFileName(file_name,buf), flags, mode); 
+    virtfs_cache_open(fd, flags);
 
     //printf("open_r file=%s real_path=%s mode=%x fd=%d\n",file_name,buf,mode,fd);
 
@@ -640,6 +1538,9 @@ static void athrill_syscall_read_r(AthrillSyscallArgType *arg)
     	mpthread_lock(fifop->rx_thread);
         Std_ReturnType ret = comm_fifo_buffer_get(&fifop->rd, buf, size, (uint32*)&arg->ret_value);
     	mpthread_unlock(fifop->rx_thread);
+        if (arg->ret_value > 0) {
+            mpu_address_notify_host_write(arg->body.api_read_r.buf, (uint32)arg->ret_value);
+        }
         if (ret == STD_E_NOENT) {
             arg->ret_value = -1;
             arg->ret_errno = 0;
@@ -650,7 +1551,7 @@ static void athrill_syscall_read_r(AthrillSyscallArgType *arg)
     // if fd has corresponding fd(for write), it is stream
     int is_stream = is_stream_fd(fd);
 
-    int ret = read(fd, buf, size);
+    int ret = virtfs_transfer(fd, arg->body.api_read_r.buf, size, TRUE);
     if ( ret == 0 && is_stream ) {
         // this is stream. treat as EAGAIN
         ret = -1;
@@ -696,7 +1597,7 @@ static void athrill_syscall_write_r(AthrillSyscallArgType *arg)
 #endif /* ENABLE_EXTERNAL_BT_SERIAL */
 	int actual_fd = get_correspond_fd(fd);
 
-    arg->ret_value = write(actual_fd, buf, size);
+    arg->ret_value = virtfs_transfer(actual_fd, arg->body.api_write_r.buf, size, FALSE);
 
 //    printf("write_r fd=%d buf=0x%x(real:%p) size=%zu ret=%d errno=%d\n",actual_fd,arg->body.api_write_r.buf,buf,size,arg->ret_value,errno);
 
@@ -714,6 +1615,8 @@ static void athrill_syscall_close_r(AthrillSyscallArgType *arg)
 		set_correspond_fd(fd,0);
 	}
 
+    athrill_syscall_epoll_remove(fd);
+    virtfs_cache_close(fd);
     arg->ret_value = close(fd);
 
     //printf("close_r fd=%d ret=%d\n",fd,arg->ret_value);
@@ -725,9 +1628,32 @@ static void athrill_syscall_close_r(AthrillSyscallArgType *arg)
 static void athrill_syscall_lseek_r(AthrillSyscallArgType *arg)
 {
     int fd = arg->body.api_lseek_r.fd;
-    off_t offset = arg->body.api_lseek_r.offset;
+    off_t offset = (sys_int32)arg->body.api_lseek_r.offset;
     int whence = arg->body.api_lseek_r.whence;
+    VirtFsCacheType *cachep = virtfs_get_cache(fd);
 
+    if (cachep != NULL) {
+        off_t pos;
+        if (whence == SEEK_SET) {
+            pos = offset;
+        }
+        else if (whence == SEEK_CUR) {
+            pos = cachep->pos + offset;
+        }
+        else if (whence == SEEK_END) {
+            pos = cachep->size + offset;
+        }
+        else {
+            pos = -1;
+        }
+        if (pos < 0) {
+            arg->ret_value = -1;
+            return;
+        }
+        cachep->pos = pos;
+        arg->ret_value = pos;
+        return;
+    }
     arg->ret_value = lseek( fd, (size_t)offset, whence );
 
     //printf("lseek_r fd=%d offset=%d whence=%d ret=%d\n", fd, offset, whence, arg->ret_value);
@@ -872,6 +1798,7 @@ static void athrill_syscall_ev3_readdir(AthrillSyscallArgType *arg)
             ASSERT(err == 0);
 
             strcpy(name, dir_ent->d_name);
+            mpu_address_notify_host_write((uint32)arg->body.api_ev3_readdir.name, strlen(name) + 1);
 
             strcpy(path,de->path);
             strcat(path,"/");
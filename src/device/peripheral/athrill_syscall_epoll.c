@@ -0,0 +1,316 @@
+#ifdef OS_LINUX
+
+#include "athrill_device.h"
+#include "mpu_ops.h"
+#define ATHRILL_SYSCALL_DEVICE
+#include "athrill_syscall.h"
+#include "athrill_mpthread.h"
+#include "std_device_ops.h"
+#include "snapshot.h"
+#include "assert.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/epoll.h>
+
+/*
+ * epoll reactor of guest sockets.
+ *
+ * reactor thread waits edges of socket readiness(EPOLLET), and sets host bitmaps.
+ * host bitmaps are copied to guest bitmaps(sys_fd_set) on device clock,
+ * and the interrupt is raised when new bits are set.
+ * bits are cleared when recv/send/accept returns EAGAIN: guest must call them until EAGAIN.
+ * the edge may come between EAGAIN and the clear: the fd is polled again after the clear.
+ */
+#define ATHRILL_SYSCALL_EPOLL_EVENT_NUM		32
+
+typedef struct {
+	bool			is_setup;
+	int				epfd;
+	MpthrIdType		thread;
+	/*
+	 * guest bitmaps
+	 */
+	sys_addr		readfds;
+	sys_addr		writefds;
+	sys_uint32		intno;
+	/*
+	 * host bitmaps: locked by thread
+	 * is_updated is also read without lock on device clock.
+	 */
+	bool			is_updated;
+	sys_fd_set		host_readfds;
+	sys_fd_set		host_writefds;
+	/*
+	 * sockets created before setup are added on setup.
+	 */
+	sys_fd_set		sockfds;
+} AthrillSyscallEpollType;
+
+static AthrillSyscallEpollType athrill_syscall_epoll = {
+	.is_setup = FALSE,
+	.epfd = -1,
+};
+
+static inline void sys_fd_set_bit(sys_fd_set *fds, int fd)
+{
+	fds->fd_bits[fd / 8] |= (1U << (fd % 8));
+	return;
+}
+static inline void sys_fd_clr_bit(sys_fd_set *fds, int fd)
+{
+	fds->fd_bits[fd / 8] &= ~(1U << (fd % 8));
+	return;
+}
+static inline bool sys_fd_isset(const sys_fd_set *fds, int fd)
+{
+	return ((fds->fd_bits[fd / 8] & (1U << (fd % 8))) != 0U);
+}
+static inline bool is_valid_fd(int fd)
+{
+	return ((fd >= 0) && (fd < ATHRILL_FD_SETSIZE));
+}
+static void athrill_syscall_epoll_ctl_add(int fd)
+{
+	struct epoll_event event;
+
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+	event.data.fd = fd;
+	if (epoll_ctl(athrill_syscall_epoll.epfd, EPOLL_CTL_ADD, fd, &event) < 0) {
+		printf("ERROR: epoll_ctl add fd=%d errno=%d\n", fd, errno);
+	}
+	return;
+}
+
+static Std_ReturnType athrill_syscall_epoll_thread_do_init(MpthrIdType id)
+{
+	return STD_E_OK;
+}
+static Std_ReturnType athrill_syscall_epoll_thread_do_proc(MpthrIdType id)
+{
+	struct epoll_event events[ATHRILL_SYSCALL_EPOLL_EVENT_NUM];
+	int num;
+	int i;
+	int fd;
+
+	num = epoll_wait(athrill_syscall_epoll.epfd, events, ATHRILL_SYSCALL_EPOLL_EVENT_NUM, -1);
+	if (num < 0) {
+		if (errno != EINTR) {
+			printf("ERROR: epoll_wait errno=%d\n", errno);
+		}
+		return STD_E_OK;
+	}
+	mpthread_lock(id);
+	for (i = 0; i < num; i++) {
+		fd = events[i].data.fd;
+		if ((events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0) {
+			sys_fd_set_bit(&athrill_syscall_epoll.host_readfds, fd);
+		}
+		if ((events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) != 0) {
+			sys_fd_set_bit(&athrill_syscall_epoll.host_writefds, fd);
+		}
+	}
+	__atomic_store_n(&athrill_syscall_epoll.is_updated, TRUE, __ATOMIC_RELEASE);
+	mpthread_unlock(id);
+	return STD_E_OK;
+}
+static MpthrOperationType athrill_syscall_epoll_thread_ops = {
+	.do_init = athrill_syscall_epoll_thread_do_init,
+	.do_proc = athrill_syscall_epoll_thread_do_proc,
+};
+
+/*
+ * epoll instance is shared with the parent after fork: forked variant uses its own.
+ * sockets are added again, and their current readiness is reported as a new edge.
+ */
+static void athrill_syscall_epoll_fork_child(void)
+{
+	int fd;
+
+	(void)close(athrill_syscall_epoll.epfd);
+	athrill_syscall_epoll.epfd = epoll_create1(EPOLL_CLOEXEC);
+	ASSERT(athrill_syscall_epoll.epfd >= 0);
+	for (fd = 0; fd < ATHRILL_FD_SETSIZE; fd++) {
+		if (sys_fd_isset(&athrill_syscall_epoll.sockfds, fd)) {
+			athrill_syscall_epoll_ctl_add(fd);
+		}
+	}
+	__atomic_store_n(&athrill_syscall_epoll.is_updated, TRUE, __ATOMIC_RELEASE);
+	return;
+}
+
+sint32 athrill_syscall_epoll_setup(uint32 readfds, uint32 writefds, uint32 intno)
+{
+	Std_ReturnType err;
+	uint8 *ptr;
+	int fd;
+
+	if ((readfds != 0U) && (mpu_get_pointer(0U, readfds, &ptr) != STD_E_OK)) {
+		return SYS_API_ERR_FAULT;
+	}
+	if ((writefds != 0U) && (mpu_get_pointer(0U, writefds, &ptr) != STD_E_OK)) {
+		return SYS_API_ERR_FAULT;
+	}
+	if (athrill_syscall_epoll.is_setup == FALSE) {
+		athrill_syscall_epoll.epfd = epoll_create1(EPOLL_CLOEXEC);
+		if (athrill_syscall_epoll.epfd < 0) {
+			printf("ERROR: epoll_create1 errno=%d\n", errno);
+			return -errno;
+		}
+		err = mpthread_register(&athrill_syscall_epoll.thread, &athrill_syscall_epoll_thread_ops);
+		if (err != STD_E_OK) {
+			(void)close(athrill_syscall_epoll.epfd);
+			athrill_syscall_epoll.epfd = -1;
+			return SYS_API_ERR_NOMEM;
+		}
+		athrill_syscall_epoll.is_setup = TRUE;
+		(void)snapshot_register_fork_child(athrill_syscall_epoll_fork_child);
+		for (fd = 0; fd < ATHRILL_FD_SETSIZE; fd++) {
+			if (sys_fd_isset(&athrill_syscall_epoll.sockfds, fd)) {
+				athrill_syscall_epoll_ctl_add(fd);
+			}
+		}
+		(void)mpthread_start_proc(athrill_syscall_epoll.thread);
+	}
+	mpthread_lock(athrill_syscall_epoll.thread);
+	athrill_syscall_epoll.readfds = readfds;
+	athrill_syscall_epoll.writefds = writefds;
+	athrill_syscall_epoll.intno = intno;
+	/*
+	 * current readiness is copied on next device clock.
+	 */
+	__atomic_store_n(&athrill_syscall_epoll.is_updated, TRUE, __ATOMIC_RELEASE);
+	mpthread_unlock(athrill_syscall_epoll.thread);
+	return SYS_API_ERR_OK;
+}
+
+void athrill_syscall_epoll_add(int fd)
+{
+	if (is_valid_fd(fd) == FALSE) {
+		return;
+	}
+	sys_fd_set_bit(&athrill_syscall_epoll.sockfds, fd);
+	if (athrill_syscall_epoll.is_setup != FALSE) {
+		athrill_syscall_epoll_ctl_add(fd);
+	}
+	return;
+}
+
+static void athrill_syscall_epoll_clear_guest(sys_addr addr, int fd)
+{
+	sys_fd_set *fds;
+
+	if (addr == 0U) {
+		return;
+	}
+	if (mpu_get_pointer(0U, addr, (uint8 **)&fds) != STD_E_OK) {
+		return;
+	}
+	sys_fd_clr_bit(fds, fd);
+	return;
+}
+/*
+ * the edge which came after EAGAIN was set by the reactor thread before the clear:
+ * the fd is polled again under lock, and the bit is set back when it is still ready.
+ */
+static void athrill_syscall_epoll_repoll(int fd, bool is_write)
+{
+	struct pollfd pfd;
+
+	pfd.fd = fd;
+	pfd.events = (is_write == FALSE) ? POLLIN : POLLOUT;
+	pfd.revents = 0;
+	if (poll(&pfd, 1, 0) <= 0) {
+		return;
+	}
+	if (is_write == FALSE) {
+		sys_fd_set_bit(&athrill_syscall_epoll.host_readfds, fd);
+	}
+	else {
+		sys_fd_set_bit(&athrill_syscall_epoll.host_writefds, fd);
+	}
+	__atomic_store_n(&athrill_syscall_epoll.is_updated, TRUE, __ATOMIC_RELEASE);
+	return;
+}
+void athrill_syscall_epoll_clear(int fd, bool is_write)
+{
+	if ((athrill_syscall_epoll.is_setup == FALSE) || (is_valid_fd(fd) == FALSE)) {
+		return;
+	}
+	mpthread_lock(athrill_syscall_epoll.thread);
+	if (is_write == FALSE) {
+		sys_fd_clr_bit(&athrill_syscall_epoll.host_readfds, fd);
+		athrill_syscall_epoll_clear_guest(athrill_syscall_epoll.readfds, fd);
+	}
+	else {
+		sys_fd_clr_bit(&athrill_syscall_epoll.host_writefds, fd);
+		athrill_syscall_epoll_clear_guest(athrill_syscall_epoll.writefds, fd);
+	}
+	if (sys_fd_isset(&athrill_syscall_epoll.sockfds, fd)) {
+		athrill_syscall_epoll_repoll(fd, is_write);
+	}
+	mpthread_unlock(athrill_syscall_epoll.thread);
+	return;
+}
+
+/*
+ * fd must be removed before it is closed: closed fd number is reused by the next socket.
+ */
+void athrill_syscall_epoll_remove(int fd)
+{
+	if (is_valid_fd(fd) == FALSE) {
+		return;
+	}
+	sys_fd_clr_bit(&athrill_syscall_epoll.sockfds, fd);
+	if (athrill_syscall_epoll.is_setup == FALSE) {
+		return;
+	}
+	(void)epoll_ctl(athrill_syscall_epoll.epfd, EPOLL_CTL_DEL, fd, NULL);
+	athrill_syscall_epoll_clear(fd, FALSE);
+	athrill_syscall_epoll_clear(fd, TRUE);
+	return;
+}
+
+static bool athrill_syscall_epoll_copy(sys_addr addr, const sys_fd_set *host_fds)
+{
+	sys_fd_set *fds;
+	bool is_new = FALSE;
+	uint32 i;
+
+	if (addr == 0U) {
+		return FALSE;
+	}
+	if (mpu_get_pointer(0U, addr, (uint8 **)&fds) != STD_E_OK) {
+		return FALSE;
+	}
+	for (i = 0; i < sizeof(sys_fd_set); i++) {
+		if ((host_fds->fd_bits[i] & ~fds->fd_bits[i]) != 0U) {
+			is_new = TRUE;
+		}
+		fds->fd_bits[i] = host_fds->fd_bits[i];
+	}
+	return is_new;
+}
+void athrill_syscall_epoll_supply_clock(void)
+{
+	bool is_new;
+
+	if (__atomic_load_n(&athrill_syscall_epoll.is_updated, __ATOMIC_ACQUIRE) == FALSE) {
+		return;
+	}
+	mpthread_lock(athrill_syscall_epoll.thread);
+	is_new = athrill_syscall_epoll_copy(athrill_syscall_epoll.readfds, &athrill_syscall_epoll.host_readfds);
+	is_new |= athrill_syscall_epoll_copy(athrill_syscall_epoll.writefds, &athrill_syscall_epoll.host_writefds);
+	__atomic_store_n(&athrill_syscall_epoll.is_updated, FALSE, __ATOMIC_RELAXED);
+	mpthread_unlock(athrill_syscall_epoll.thread);
+
+	if ((is_new != FALSE) && (athrill_syscall_epoll.intno != 0U)) {
+		(void)intc_raise_intr(athrill_syscall_epoll.intno);
+	}
+	return;
+}
+
+#endif /* OS_LINUX */
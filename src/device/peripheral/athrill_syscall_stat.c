@@ -0,0 +1,230 @@
+#include "athrill_device.h"
+#include "std_errno.h"
+#define ATHRILL_SYSCALL_DEVICE
+#include "athrill_syscall.h"
+#include "cpuemu_ops.h"
+#include "target/target_os_api.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * per api statistics of syscall device.
+ *
+ * latency is host time spent in syscall_table[] function.
+ * ring enter includes the calls drained from the ring, and they are also counted by their own api.
+ * guest_clocks is device clocks elapsed since the previous syscall, that is,
+ * the cost of guest code which leads to this syscall.
+ */
+typedef struct {
+	uint64					last_clock;
+	char					*path;
+	AthrillSyscallStatType	api[SYS_API_ID_NUM];
+} AthrillSyscallStatTableType;
+
+static AthrillSyscallStatTableType athrill_syscall_stat;
+
+static const char *athrill_syscall_stat_name_table[SYS_API_ID_NUM] = {
+	"none",
+	"socket",
+	"sense",
+	"bind",
+	"listen",
+	"accept",
+	"connect",
+	"select",
+	"send",
+	"recv",
+	"shutdown",
+	"system",
+	"malloc",
+	"calloc",
+	"realloc",
+	"free",
+	"open_r",
+	"read_r",
+	"write_r",
+	"close_r",
+	"lseek_r",
+	"set_virtfs_top",
+	"ev3_opendir",
+	"ev3_readdir",
+	"ev3_closedir",
+	"ev3_serial_open",
+	"exit",
+	"ring_setup",
+	"ring_enter",
+	"epoll_setup",
+	"sendto",
+	"recvfrom",
+	"sendmmsg",
+	"recvmmsg",
+};
+
+static inline uint64 athrill_syscall_stat_now(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (((uint64)ts.tv_sec) * 1000000000ULL) + ((uint64)ts.tv_nsec);
+}
+
+/*
+ * hist[0]: < 1024ns, hist[i]: < (1024ns << i), last bucket has no upper bound.
+ */
+static inline uint32 athrill_syscall_stat_bucket(uint64 ns)
+{
+	uint32 i = 0U;
+
+	ns >>= ATHRILL_SYSCALL_STAT_HIST_SHIFT;
+	while ((ns != 0U) && (i < (ATHRILL_SYSCALL_STAT_HIST_NUM - 1U))) {
+		ns >>= 1U;
+		i++;
+	}
+	return i;
+}
+
+uint64 athrill_syscall_stat_start(void)
+{
+	return athrill_syscall_stat_now();
+}
+
+void athrill_syscall_stat_end(uint32 api_id, uint64 start_ns, uint64 bytes)
+{
+	AthrillSyscallStatType *stat;
+	uint64 ns = athrill_syscall_stat_now() - start_ns;
+	uint64 clock = cpuemu_get_total_clocks();
+
+	if (api_id >= SYS_API_ID_NUM) {
+		return;
+	}
+	stat = &athrill_syscall_stat.api[api_id];
+	stat->count++;
+	stat->bytes += bytes;
+	stat->total_ns += ns;
+	if (ns > stat->max_ns) {
+		stat->max_ns = ns;
+	}
+	stat->hist[athrill_syscall_stat_bucket(ns)]++;
+	stat->guest_clocks += clock - athrill_syscall_stat.last_clock;
+	athrill_syscall_stat.last_clock = clock;
+	return;
+}
+
+const char *athrill_syscall_stat_name(uint32 api_id)
+{
+	if (api_id >= SYS_API_ID_NUM) {
+		return NULL;
+	}
+	return athrill_syscall_stat_name_table[api_id];
+}
+
+Std_ReturnType athrill_syscall_stat_get(uint32 api_id, AthrillSyscallStatType *stat)
+{
+	if (api_id >= SYS_API_ID_NUM) {
+		return STD_E_INVALID;
+	}
+	*stat = athrill_syscall_stat.api[api_id];
+	return STD_E_OK;
+}
+
+void athrill_syscall_stat_clear(void)
+{
+	memset(athrill_syscall_stat.api, 0, sizeof(athrill_syscall_stat.api));
+	athrill_syscall_stat.last_clock = cpuemu_get_total_clocks();
+	return;
+}
+
+static void athrill_syscall_stat_dump_csv(FILE *fp)
+{
+	uint32 api_id;
+	uint32 i;
+	AthrillSyscallStatType *stat;
+
+	fprintf(fp, "api,count,bytes,total_ns,max_ns,guest_clocks");
+	for (i = 0; i < ATHRILL_SYSCALL_STAT_HIST_NUM - 1U; i++) {
+		fprintf(fp, ",lt_%"FMT_UINT64"ns", ((uint64)1U) << (ATHRILL_SYSCALL_STAT_HIST_SHIFT + i));
+	}
+	fprintf(fp, ",inf\n");
+	for (api_id = 0; api_id < SYS_API_ID_NUM; api_id++) {
+		stat = &athrill_syscall_stat.api[api_id];
+		fprintf(fp, "%s,%"FMT_UINT64",%"FMT_UINT64",%"FMT_UINT64",%"FMT_UINT64",%"FMT_UINT64,
+				athrill_syscall_stat_name_table[api_id],
+				stat->count, stat->bytes, stat->total_ns, stat->max_ns, stat->guest_clocks);
+		for (i = 0; i < ATHRILL_SYSCALL_STAT_HIST_NUM; i++) {
+			fprintf(fp, ",%"FMT_UINT64, stat->hist[i]);
+		}
+		fprintf(fp, "\n");
+	}
+	return;
+}
+
+static void athrill_syscall_stat_dump_json(FILE *fp)
+{
+	uint32 api_id;
+	uint32 i;
+	AthrillSyscallStatType *stat;
+
+	fprintf(fp, "{\n  \"hist_shift\": %u,\n  \"api\": [\n", ATHRILL_SYSCALL_STAT_HIST_SHIFT);
+	for (api_id = 0; api_id < SYS_API_ID_NUM; api_id++) {
+		stat = &athrill_syscall_stat.api[api_id];
+		fprintf(fp, "    { \"name\": \"%s\", \"count\": %"FMT_UINT64", \"bytes\": %"FMT_UINT64
+				", \"total_ns\": %"FMT_UINT64", \"max_ns\": %"FMT_UINT64", \"guest_clocks\": %"FMT_UINT64", \"hist\": [",
+				athrill_syscall_stat_name_table[api_id],
+				stat->count, stat->bytes, stat->total_ns, stat->max_ns, stat->guest_clocks);
+		for (i = 0; i < ATHRILL_SYSCALL_STAT_HIST_NUM; i++) {
+			fprintf(fp, "%s%"FMT_UINT64, (i == 0U) ? "" : ", ", stat->hist[i]);
+		}
+		fprintf(fp, "] }%s\n", (api_id == (SYS_API_ID_NUM - 1)) ? "" : ",");
+	}
+	fprintf(fp, "  ]\n}\n");
+	return;
+}
+
+/*
+ * file is written as json if path ends with ".json", otherwise csv.
+ */
+Std_ReturnType athrill_syscall_stat_dump(const char *path)
+{
+	FILE *fp;
+	size_t len = strlen(path);
+
+	fp = fopen(path, "w");
+	if (fp == NULL) {
+		printf("ERROR: can not open syscall stat file(%s)\n", path);
+		return STD_E_NOENT;
+	}
+	if ((len >= 5U) && (strcmp(&path[len - 5U], ".json") == 0)) {
+		athrill_syscall_stat_dump_json(fp);
+	}
+	else {
+		athrill_syscall_stat_dump_csv(fp);
+	}
+	if (fclose(fp) != 0) {
+		printf("ERROR: can not write syscall stat file(%s)\n", path);
+		return STD_E_INVALID;
+	}
+	return STD_E_OK;
+}
+
+static void athrill_syscall_stat_dump_at_exit(void)
+{
+	(void)athrill_syscall_stat_dump(athrill_syscall_stat.path);
+	return;
+}
+
+void athrill_syscall_stat_init(void)
+{
+	char *path;
+
+	if (cpuemu_get_devcfg_string("DEVICE_CONFIG_SYSCALL_STAT_PATH", &path) != STD_E_OK) {
+		return;
+	}
+	athrill_syscall_stat.path = strdup(path);
+	if (athrill_syscall_stat.path == NULL) {
+		return;
+	}
+	(void)atexit(athrill_syscall_stat_dump_at_exit);
+	return;
+}
@@ -0,0 +1,141 @@
+#include "device_event.h"
+#include <stdlib.h>
+
+typedef struct {
+	uint32			num;
+	uint32			max;
+	DeviceEventType	**heap;
+} DeviceEventQueueType;
+
+static DeviceEventQueueType device_event_queue;
+
+static inline void device_event_heap_set(uint32 index, DeviceEventType *event)
+{
+	device_event_queue.heap[index] = event;
+	event->index = index;
+	return;
+}
+
+static void device_event_heap_up(uint32 index)
+{
+	uint32 parent;
+	DeviceEventType *event = device_event_queue.heap[index];
+
+	while (index > 0U) {
+		parent = (index - 1U) / 2U;
+		if (device_event_queue.heap[parent]->clock <= event->clock) {
+			break;
+		}
+		device_event_heap_set(index, device_event_queue.heap[parent]);
+		index = parent;
+	}
+	device_event_heap_set(index, event);
+	return;
+}
+
+static void device_event_heap_down(uint32 index)
+{
+	uint32 child;
+	DeviceEventType *event = device_event_queue.heap[index];
+
+	while (TRUE) {
+		child = (index * 2U) + 1U;
+		if (child >= device_event_queue.num) {
+			break;
+		}
+		if (((child + 1U) < device_event_queue.num) &&
+				(device_event_queue.heap[child + 1U]->clock < device_event_queue.heap[child]->clock)) {
+			child++;
+		}
+		if (event->clock <= device_event_queue.heap[child]->clock) {
+			break;
+		}
+		device_event_heap_set(index, device_event_queue.heap[child]);
+		index = child;
+	}
+	device_event_heap_set(index, event);
+	return;
+}
+
+void device_event_init(DeviceEventType *event, DeviceEventHandlerType handler, void *arg)
+{
+	event->clock = 0U;
+	event->handler = handler;
+	event->arg = arg;
+	event->index = DEVICE_EVENT_INDEX_NONE;
+	return;
+}
+
+Std_ReturnType device_event_set(DeviceEventType *event, uint64 clock)
+{
+	DeviceEventType **heap;
+
+	if (device_event_is_set(event)) {
+		uint64 old_clock = event->clock;
+		event->clock = clock;
+		if (clock < old_clock) {
+			device_event_heap_up(event->index);
+		}
+		else {
+			device_event_heap_down(event->index);
+		}
+		return STD_E_OK;
+	}
+	if (device_event_queue.num >= device_event_queue.max) {
+		heap = realloc(device_event_queue.heap, (device_event_queue.max + 16U) * sizeof(DeviceEventType*));
+		if (heap == NULL) {
+			return STD_E_LIMIT;
+		}
+		device_event_queue.heap = heap;
+		device_event_queue.max += 16U;
+	}
+	event->clock = clock;
+	device_event_heap_set(device_event_queue.num, event);
+	device_event_queue.num++;
+	device_event_heap_up(event->index);
+	return STD_E_OK;
+}
+
+void device_event_cancel(DeviceEventType *event)
+{
+	uint32 index = event->index;
+	DeviceEventType *last;
+
+	if (index == DEVICE_EVENT_INDEX_NONE) {
+		return;
+	}
+	event->index = DEVICE_EVENT_INDEX_NONE;
+	device_event_queue.num--;
+	if (index == device_event_queue.num) {
+		return;
+	}
+	last = device_event_queue.heap[device_event_queue.num];
+	device_event_heap_set(index, last);
+	if ((index > 0U) && (last->clock < device_event_queue.heap[(index - 1U) / 2U]->clock)) {
+		device_event_heap_up(index);
+	}
+	else {
+		device_event_heap_down(index);
+	}
+	return;
+}
+
+uint64 device_event_next_clock(void)
+{
+	if (device_event_queue.num == 0U) {
+		return DEVICE_CLOCK_MAX_INTERVAL;
+	}
+	return device_event_queue.heap[0]->clock;
+}
+
+void device_event_dispatch(DeviceClockType *dev_clock)
+{
+	DeviceEventType *event;
+
+	while ((device_event_queue.num > 0U) && (device_event_queue.heap[0]->clock <= dev_clock->clock)) {
+		event = device_event_queue.heap[0];
+		device_event_cancel(event);
+		event->handler(event, dev_clock);
+	}
+	return;
+}
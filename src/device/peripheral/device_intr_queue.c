@@ -0,0 +1,131 @@
+#ifdef OS_LINUX
+
+#include "device_intr_queue.h"
+#include "cpu.h"
+#include "std_device_ops.h"
+#include <pthread.h>
+#include <time.h>
+
+#define DEVICE_INTR_QUEUE_MASK		(DEVICE_INTR_QUEUE_SIZE - 1U)
+
+/*
+ * seq of slot tells owner of the slot for position pos(base = pos & ~MASK):
+ *   seq == base      : free, producer of pos can write it.
+ *   seq == base + 1  : written, consumer of pos can read it.
+ * consumer sets base + SIZE to free the slot for next lap,
+ * so zero cleared slots are free for the first lap.
+ */
+typedef struct {
+	uint32	seq;
+	uint32	intno;
+} DeviceIntrQueueSlotType;
+
+typedef struct {
+	uint32					enqueue_pos;
+	uint32					dequeue_pos;
+	DeviceIntrQueueSlotType	slot[DEVICE_INTR_QUEUE_SIZE];
+	/*
+	 * main loop is sleeping on cond.
+	 */
+	bool					is_waiting;
+	pthread_mutex_t			mutex;
+	pthread_cond_t			cond;
+} DeviceIntrQueueType;
+
+static DeviceIntrQueueType device_intr_queue = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+Std_ReturnType device_intr_queue_request(uint32 intno)
+{
+	DeviceIntrQueueSlotType *slot;
+	uint32 pos;
+	uint32 base;
+	sint32 dif;
+
+	pos = __atomic_load_n(&device_intr_queue.enqueue_pos, __ATOMIC_RELAXED);
+	while (TRUE) {
+		slot = &device_intr_queue.slot[pos & DEVICE_INTR_QUEUE_MASK];
+		base = pos & ~DEVICE_INTR_QUEUE_MASK;
+		dif = (sint32)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - base);
+		if (dif == 0) {
+			if (__atomic_compare_exchange_n(&device_intr_queue.enqueue_pos, &pos, pos + 1U,
+					TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		}
+		else if (dif < 0) {
+			return STD_E_LIMIT;
+		}
+		else {
+			pos = __atomic_load_n(&device_intr_queue.enqueue_pos, __ATOMIC_RELAXED);
+		}
+	}
+	slot->intno = intno;
+	__atomic_store_n(&slot->seq, base + 1U, __ATOMIC_RELEASE);
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&device_intr_queue.is_waiting, __ATOMIC_RELAXED) != FALSE) {
+		(void)pthread_mutex_lock(&device_intr_queue.mutex);
+		(void)pthread_cond_signal(&device_intr_queue.cond);
+		(void)pthread_mutex_unlock(&device_intr_queue.mutex);
+	}
+	return STD_E_OK;
+}
+
+static inline DeviceIntrQueueSlotType *device_intr_queue_head(void)
+{
+	uint32 pos = device_intr_queue.dequeue_pos;
+	DeviceIntrQueueSlotType *slot = &device_intr_queue.slot[pos & DEVICE_INTR_QUEUE_MASK];
+
+	if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != ((pos & ~DEVICE_INTR_QUEUE_MASK) + 1U)) {
+		return NULL;
+	}
+	return slot;
+}
+
+bool device_intr_queue_is_empty(void)
+{
+	return (device_intr_queue_head() == NULL);
+}
+
+void device_intr_queue_drain(void)
+{
+	DeviceIntrQueueSlotType *slot;
+	uint32 intno;
+
+	while ((slot = device_intr_queue_head()) != NULL) {
+		intno = slot->intno;
+		__atomic_store_n(&slot->seq,
+				(device_intr_queue.dequeue_pos & ~DEVICE_INTR_QUEUE_MASK) + DEVICE_INTR_QUEUE_SIZE, __ATOMIC_RELEASE);
+		device_intr_queue.dequeue_pos++;
+		(void)intc_raise_intr(intno);
+	}
+	return;
+}
+
+void device_intr_queue_wait(uint64 usec)
+{
+	struct timespec ts;
+	int err = 0;
+
+	(void)clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += (time_t)(usec / 1000000U);
+	ts.tv_nsec += (long)((usec % 1000000U) * 1000U);
+	if (ts.tv_nsec >= 1000000000L) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+	(void)pthread_mutex_lock(&device_intr_queue.mutex);
+	__atomic_store_n(&device_intr_queue.is_waiting, TRUE, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	while ((err == 0) && (device_intr_queue_is_empty() == TRUE)) {
+		err = pthread_cond_timedwait(&device_intr_queue.cond, &device_intr_queue.mutex, &ts);
+	}
+	__atomic_store_n(&device_intr_queue.is_waiting, FALSE, __ATOMIC_RELAXED);
+	(void)pthread_mutex_unlock(&device_intr_queue.mutex);
+	return;
+}
+
+#endif /* OS_LINUX */
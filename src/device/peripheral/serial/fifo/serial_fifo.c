@@ -6,17 +6,111 @@
 #include "device.h"
 #include "athrill_mpthread.h"
 #include "target/target_os_api.h"
+#include "snapshot.h"
+#include "device_event.h"
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include "tcp/tcp_server.h"
+#include "tcp/tcp_client.h"
 
 static AthrillSerialFifoType athrill_serial_fifo[SERIAL_FIFO_MAX_CHANNEL_NUM];
 static uint32 serial_fifo_base_addr = 0x0;
 static void serial_fifo_thread_start(uint32 channel);
+static void serial_fifo_io_start(void);
+static void serial_fifo_io_notify(uint32 channel);
+static const SnapshotOperationType serial_fifo_snapshot_operation;
 
 static char serial_fifo_param_buffer[256];
 
+#define SERIAL_FIFO_DMA_BUFFER_LEN		4096U
+static std_bool serial_fifo_dma_enable[SERIAL_FIFO_MAX_CHANNEL_NUM];
+static uint8 serial_fifo_dma_buffer[SERIAL_FIFO_DMA_BUFFER_LEN];
+
+/*
+ * active channels
+ *
+ * supply clock handles only the channels whose bit is set, and returns at once if no bit is set.
+ * bit is set when:
+ *  - cpu writes registers(write hook can not tell the channel: all channels are set)
+ *  - host I/O thread adds rd data or gets wr data
+ *  - interrupt is raised
+ * channel which executed a command is handled on the next clock again to update its status.
+ * channels in serial_fifo_poll are handled on every clock: their buffers are accessed directly
+ * by external devices.
+ * interrupt delays are device events, so that idle channels need no clock.
+ */
+#define SERIAL_FIFO_CH_BIT(ch)		(1U << (ch))
+static uint32 serial_fifo_enabled = 0U;
+static uint32 serial_fifo_active = 0U;
+static uint32 serial_fifo_poll = 0U;
+/*
+ * register writes by supply clock itself do not set active bits.
+ */
+static __thread std_bool serial_fifo_is_device_write = FALSE;
+static DeviceEventType serial_fifo_rd_intr_event[SERIAL_FIFO_MAX_CHANNEL_NUM];
+static DeviceEventType serial_fifo_wr_intr_event[SERIAL_FIFO_MAX_CHANNEL_NUM];
+
+static inline void serial_fifo_set_active(uint32 mask)
+{
+	(void)__atomic_fetch_or(&serial_fifo_active, mask, __ATOMIC_RELEASE);
+	return;
+}
+static void serial_fifo_write_hook(CoreIdType core_id, uint32 addr)
+{
+	if (serial_fifo_is_device_write == FALSE) {
+		serial_fifo_set_active(serial_fifo_enabled);
+	}
+	return;
+}
+static void serial_fifo_rd_intr_handler(DeviceEventType *event, DeviceClockType *dev_clock)
+{
+	uint32 channel = (uint32)((uintptr_t)event->arg);
+
+	device_raise_int(athrill_serial_fifo[channel].rd_intno);
+	athrill_serial_fifo[channel].rd_raise_intr = FALSE;
+	serial_fifo_set_active(SERIAL_FIFO_CH_BIT(channel));
+	return;
+}
+static void serial_fifo_wr_intr_handler(DeviceEventType *event, DeviceClockType *dev_clock)
+{
+	uint32 channel = (uint32)((uintptr_t)event->arg);
+
+	device_raise_int(athrill_serial_fifo[channel].wr_intno);
+	athrill_serial_fifo[channel].wr_raise_intr = FALSE;
+	serial_fifo_set_active(SERIAL_FIFO_CH_BIT(channel));
+	return;
+}
+/*
+ * interrupt is raised after delay_clocks. queued interrupt is moved to the new clock.
+ */
+static void serial_fifo_set_intr(uint32 channel, std_bool is_rd, uint32 delay_clocks)
+{
+	if (delay_clocks == 0U) {
+		delay_clocks = 1U;
+	}
+	if (is_rd == TRUE) {
+		athrill_serial_fifo[channel].rd_raise_intr = TRUE;
+		(void)device_event_set(&serial_fifo_rd_intr_event[channel], cpuemu_get_total_clocks() + delay_clocks);
+	}
+	else {
+		athrill_serial_fifo[channel].wr_raise_intr = TRUE;
+		(void)device_event_set(&serial_fifo_wr_intr_event[channel], cpuemu_get_total_clocks() + delay_clocks);
+	}
+	return;
+}
+
 typedef struct {
 	uint32 fd;
 } AthrillSerialFifoCounterType;
@@ -45,10 +139,13 @@ void athrill_device_init_serial_fifo(void)
 		if (ret == STD_E_OK) {
 			uint32 enable_external_device = FALSE;
 			uint32 disable_cpuio = FALSE;
+			uint32 enable_dma = FALSE;
 			athrill_serial_fifo[i].rd_raise_delay_count = 0;
 			athrill_serial_fifo[i].rd_raise_intr = FALSE;
 			athrill_serial_fifo[i].wr_raise_delay_count = 0;
 			athrill_serial_fifo[i].wr_raise_intr = FALSE;
+			device_event_init(&serial_fifo_rd_intr_event[i], serial_fifo_rd_intr_handler, (void *)((uintptr_t)i));
+			device_event_init(&serial_fifo_wr_intr_event[i], serial_fifo_wr_intr_handler, (void *)((uintptr_t)i));
 			printf("%s=%u\n", serial_fifo_param_buffer, buffer_size);
 			ret = comm_fifo_buffer_create(buffer_size, &athrill_serial_fifo[i].rd);
 			ASSERT(ret == STD_E_OK);
@@ -82,6 +179,14 @@ void athrill_device_init_serial_fifo(void)
 			(void)cpuemu_get_devcfg_value(serial_fifo_param_buffer, &disable_cpuio);
 			printf("%s=%u\n", serial_fifo_param_buffer, disable_cpuio);
 			athrill_serial_fifo[i].disable_cpu_io = disable_cpuio;
+			if (disable_cpuio == FALSE) {
+				serial_fifo_enabled |= SERIAL_FIFO_CH_BIT(i);
+			}
+
+			snprintf(serial_fifo_param_buffer, sizeof(serial_fifo_param_buffer), "DEVICE_CONFIG_SERIAL_FILFO_%d_DMA_ENABLE", i);
+			(void)cpuemu_get_devcfg_value(serial_fifo_param_buffer, &enable_dma);
+			printf("%s=%u\n", serial_fifo_param_buffer, enable_dma);
+			serial_fifo_dma_enable[i] = enable_dma;
 
 			snprintf(serial_fifo_param_buffer, sizeof(serial_fifo_param_buffer), "DEVICE_CONFIG_SERIAL_FILFO_%d_EXDEV_ENABLE", i);
 			(void)cpuemu_get_devcfg_value(serial_fifo_param_buffer, &enable_external_device);
@@ -91,16 +196,33 @@ void athrill_device_init_serial_fifo(void)
 				printf("start default serial thread:%d\n", i);
 				serial_fifo_thread_start(i);
 			}
+			else {
+				serial_fifo_poll |= (serial_fifo_enabled & SERIAL_FIFO_CH_BIT(i));
+			}
 		}
 		else {
 			athrill_serial_fifo[i].rd.data = NULL;
 			athrill_serial_fifo[i].wr.data = NULL;
 		}
 	}
+	if ((serial_fifo_enabled != 0U)
+			&& (mpu_address_set_write_hook(serial_fifo_base_addr, SERIAL_FIFO_REG_SIZE, serial_fifo_write_hook) != STD_E_OK)) {
+		printf("WARNING: serial fifo registers can not be hooked: all channels are handled on every clock\n");
+		serial_fifo_poll = serial_fifo_enabled;
+	}
+	/*
+	 * status registers are set on the first clock.
+	 */
+	serial_fifo_active = serial_fifo_enabled;
+	serial_fifo_io_start();
+	(void)snapshot_register("serial_fifo", &serial_fifo_snapshot_operation, NULL);
 	return;
 }
 
-static void do_serial_fifo_cpu_read(uint32 channel)
+/*
+ * functions below return TRUE when data is moved: status is updated on the next clock.
+ */
+static std_bool do_serial_fifo_cpu_read(uint32 channel)
 {
 	Std_ReturnType err;
 	uint8 data;
@@ -117,11 +239,10 @@ static void do_serial_fifo_cpu_read(uint32 channel)
 	else {
 		//found data
 		mpu_put_data8(0U, SERIAL_FIFO_READ_STATUS_ADDR(serial_fifo_base_addr, channel), SERIAL_FIFO_READ_STATUS_DATA_IN);
-		if (athrill_serial_fifo[channel].rd.count >= athrill_serial_fifo[channel].rd_intoff) {
+		if (COMM_FIFO_COUNT(&athrill_serial_fifo[channel].rd) >= athrill_serial_fifo[channel].rd_intoff) {
 			//device_raise_int(athrill_serial_fifo[channel].rd_intno);
 			if (athrill_serial_fifo[channel].rd_raise_intr == FALSE) {
-				athrill_serial_fifo[channel].rd_raise_delay_count = serial_fifo_counter.fd;
-				athrill_serial_fifo[channel].rd_raise_intr = TRUE;
+				serial_fifo_set_intr(channel, TRUE, serial_fifo_counter.fd);
 			}
 		}
 	}
@@ -132,59 +253,54 @@ static void do_serial_fifo_cpu_read(uint32 channel)
 	if (cmd == SERIAL_FIFO_READ_CMD_MOVE) {
 		mpthread_lock(athrill_serial_fifo[channel].rx_thread);
 		err = comm_fifo_buffer_get(&athrill_serial_fifo[channel].rd, (char*)&data, 1, &res);
+		serial_fifo_io_notify(channel);
 		mpthread_unlock(athrill_serial_fifo[channel].rx_thread);
 		if (err == STD_E_OK) {
 			mpu_put_data8(0U, SERIAL_FIFO_READ_PTR_ADDR(serial_fifo_base_addr, channel), data);
 		}
 		mpu_put_data8(0U, SERIAL_FIFO_READ_CMD_ADDR(serial_fifo_base_addr, channel), SERIAL_FIFO_READ_CMD_NONE);
+		return TRUE;
 	}
 
-	return;
+	return FALSE;
 }
-static void do_serial_fifo_cpu_write_tx(uint32 channel)
+static std_bool do_serial_fifo_cpu_write_tx(uint32 channel)
 {
-	Std_ReturnType err;
-	uint32 i;
-	uint8 data;
-	uint32 res;
-	uint32 count;
+	char data[SERIAL_FIFO_WR_BUFFER_LEN];
+	uint32 len;
+	uint32 res = 0U;
+	uint32 wr_res = 0U;
 
 	mpthread_lock(athrill_serial_fifo[channel].tx_thread);
-	count = athrill_serial_fifo[channel].wr_dev_buffer.count;
 	//printf("do_serial_fifo_cpu_write_tx:B:wr_dev_buffer.count=%d\n", athrill_serial_fifo[channel].wr_dev_buffer.count);
-	for (i = 0; i < count; i++) {
-		//printf("do_serial_fifo_cpu_write_tx:wr.count=%d cond=%d\n", athrill_serial_fifo[channel].wr.count, COMM_FIFO_IS_FULL(&athrill_serial_fifo[channel].wr));
-		if (COMM_FIFO_IS_FULL(&athrill_serial_fifo[channel].wr)) {
-			break;
-		}
-		err = comm_fifo_buffer_get(&athrill_serial_fifo[channel].wr_dev_buffer, (char*)&data, 1, &res);
-		//printf("comm_fifo_buffer_get:err=%d\n", err);
-		if (err == STD_E_OK) {
-			//printf("do_serial_fifo_cpu_write_tx:%d:%c\n", i, data);
-			(void)comm_fifo_buffer_add(&athrill_serial_fifo[channel].wr, (const char*)&data, 1, &res);
-		}
-		else {
-			break;
-		}
+	len = athrill_serial_fifo[channel].wr.max_size - COMM_FIFO_COUNT(&athrill_serial_fifo[channel].wr);
+	if (len > sizeof(data)) {
+		len = sizeof(data);
+	}
+	if (len > 0U) {
+		(void)comm_fifo_buffer_get(&athrill_serial_fifo[channel].wr_dev_buffer, data, len, &res);
+		(void)comm_fifo_buffer_add(&athrill_serial_fifo[channel].wr, data, res, &wr_res);
 	}
 
-	//printf("do_serial_fifo_cpu_write_tx:err=%d\n", err);
 	//printf("do_serial_fifo_cpu_write_tx:wr.count=%d\n", athrill_serial_fifo[channel].wr.count);
 	//printf("do_serial_fifo_cpu_write_tx:A:wr_dev_buffer.count=%d\n", athrill_serial_fifo[channel].wr_dev_buffer.count);
+	serial_fifo_io_notify(channel);
 	mpthread_unlock(athrill_serial_fifo[channel].tx_thread);
 	if (athrill_serial_fifo[channel].wr_dev_buffer.count <= athrill_serial_fifo[channel].wr_intoff) {
 		//printf("do_serial_fifo_cpu_write_tx:raise interrupt\n");
 		//device_raise_int(athrill_serial_fifo[channel].wr_intno);
-		athrill_serial_fifo[channel].wr_raise_delay_count = serial_fifo_counter.fd;
-		athrill_serial_fifo[channel].wr_raise_intr = TRUE;
+		serial_fifo_set_intr(channel, FALSE, serial_fifo_counter.fd);
 	}
 	if (athrill_serial_fifo[channel].wr_dev_buffer.count == 0) {
 		mpu_put_data8(0U, SERIAL_FIFO_WRITE_CMD_ADDR(serial_fifo_base_addr, channel), SERIAL_FIFO_WRITE_CMD_NONE);
 	}
-	return;
+	/*
+	 * wr is full if nothing is moved: host I/O thread sets active bit when it gets wr data.
+	 */
+	return (res > 0U);
 }
 
-static void do_serial_fifo_cpu_write(uint32 channel)
+static std_bool do_serial_fifo_cpu_write(uint32 channel)
 {
 	uint8 data;
 	uint8 cmd;
@@ -207,57 +323,333 @@ static void do_serial_fifo_cpu_write(uint32 channel)
 		//printf("do_serial_fifo_cpu_write:%c\n", data);
 		(void)comm_fifo_buffer_add(&athrill_serial_fifo[channel].wr_dev_buffer, (const char*)&data, 1, &res);
 		mpu_put_data8(0U, SERIAL_FIFO_WRITE_CMD_ADDR(serial_fifo_base_addr, channel), SERIAL_FIFO_WRITE_CMD_NONE);
+		return TRUE;
 	}
 	else if (cmd == SERIAL_FIFO_WRITE_CMD_TX) {
-		do_serial_fifo_cpu_write_tx(channel);
+		return do_serial_fifo_cpu_write_tx(channel);
 	}
+	return FALSE;
+}
+static void do_serial_fifo_cpu_dma_done(uint32 channel, uint32 dir, uint32 cmd, uint32 addr, uint32 len, Std_ReturnType err)
+{
+	mpu_put_data32(0U, SERIAL_FIFO_DMA_ADDR_ADDR(serial_fifo_base_addr, channel, dir), addr);
+	mpu_put_data32(0U, SERIAL_FIFO_DMA_LEN_ADDR(serial_fifo_base_addr, channel, dir), len);
+	mpu_put_data32(0U, SERIAL_FIFO_DMA_CMD_ADDR(serial_fifo_base_addr, channel, dir),
+			(err == STD_E_OK) ? SERIAL_FIFO_DMA_CMD_NONE : SERIAL_FIFO_DMA_CMD_ERROR);
+	if ((cmd & SERIAL_FIFO_DMA_CMD_INTR) == 0U) {
+		return;
+	}
+	serial_fifo_set_intr(channel, (dir == SERIAL_FIFO_DMA_READ), serial_fifo_counter.fd);
 	return;
 }
-static void do_serial_fifo_cpu_intr(uint32 channel)
+static std_bool do_serial_fifo_cpu_dma_write(uint32 channel)
 {
-	if (athrill_serial_fifo[channel].rd_raise_intr == TRUE) {
-		if (athrill_serial_fifo[channel].rd_raise_delay_count == 0) {
-			device_raise_int(athrill_serial_fifo[channel].rd_intno);
-			athrill_serial_fifo[channel].rd_raise_intr = FALSE;
-			//printf("do_serial_fifo_cpu_intr:RX raise interrupt(%d)\n", athrill_serial_fifo[channel].rd_intno);
+	AthrillSerialFifoType *fifo = &athrill_serial_fifo[channel];
+	Std_ReturnType err = STD_E_OK;
+	uint32 cmd;
+	uint32 addr;
+	uint32 len;
+	uint32 size;
+	uint32 res;
+	std_bool is_moved = FALSE;
+
+	mpu_get_data32(0U, SERIAL_FIFO_DMA_CMD_ADDR(serial_fifo_base_addr, channel, SERIAL_FIFO_DMA_WRITE), &cmd);
+	if ((cmd & SERIAL_FIFO_DMA_CMD_START) == 0U) {
+		return FALSE;
+	}
+	mpu_get_data32(0U, SERIAL_FIFO_DMA_ADDR_ADDR(serial_fifo_base_addr, channel, SERIAL_FIFO_DMA_WRITE), &addr);
+	mpu_get_data32(0U, SERIAL_FIFO_DMA_LEN_ADDR(serial_fifo_base_addr, channel, SERIAL_FIFO_DMA_WRITE), &len);
+
+	mpthread_lock(fifo->tx_thread);
+	while (len > 0U) {
+		size = fifo->wr.max_size - COMM_FIFO_COUNT(&fifo->wr);
+		if (size > len) {
+			size = len;
 		}
-		else {
-			athrill_serial_fifo[channel].rd_raise_delay_count--;
-			//printf("do_serial_fifo_cpu_intr:RX rd_raise_delay_count(%d)\n", athrill_serial_fifo[channel].rd_raise_delay_count);
+		if (size > SERIAL_FIFO_DMA_BUFFER_LEN) {
+			size = SERIAL_FIFO_DMA_BUFFER_LEN;
+		}
+		if (size == 0U) {
+			break;
+		}
+		err = mpu_get_block(0U, addr, serial_fifo_dma_buffer, size);
+		if (err != STD_E_OK) {
+			break;
 		}
+		res = 0U;
+		(void)comm_fifo_buffer_add(&fifo->wr, (const char*)serial_fifo_dma_buffer, size, &res);
+		addr += res;
+		len -= res;
+		is_moved = TRUE;
+	}
+	serial_fifo_io_notify(channel);
+	mpthread_unlock(fifo->tx_thread);
+
+	if ((err != STD_E_OK) || (len == 0U)) {
+		do_serial_fifo_cpu_dma_done(channel, SERIAL_FIFO_DMA_WRITE, cmd, addr, len, err);
+	}
+	else {
+		/*
+		 * fifo buffer is full: rest is moved on next clocks.
+		 */
+		mpu_put_data32(0U, SERIAL_FIFO_DMA_ADDR_ADDR(serial_fifo_base_addr, channel, SERIAL_FIFO_DMA_WRITE), addr);
+		mpu_put_data32(0U, SERIAL_FIFO_DMA_LEN_ADDR(serial_fifo_base_addr, channel, SERIAL_FIFO_DMA_WRITE), len);
+	}
+	return is_moved;
+}
+static std_bool do_serial_fifo_cpu_dma_read(uint32 channel)
+{
+	AthrillSerialFifoType *fifo = &athrill_serial_fifo[channel];
+	Std_ReturnType err = STD_E_OK;
+	uint32 cmd;
+	uint32 addr;
+	uint32 len;
+	uint32 size;
+	uint32 res;
+	std_bool is_moved = FALSE;
+
+	mpu_get_data32(0U, SERIAL_FIFO_DMA_CMD_ADDR(serial_fifo_base_addr, channel, SERIAL_FIFO_DMA_READ), &cmd);
+	if ((cmd & SERIAL_FIFO_DMA_CMD_START) == 0U) {
+		return FALSE;
 	}
-	if (athrill_serial_fifo[channel].wr_raise_intr == TRUE) {
-		if (athrill_serial_fifo[channel].wr_raise_delay_count == 0) {
-			device_raise_int(athrill_serial_fifo[channel].wr_intno);
-			athrill_serial_fifo[channel].wr_raise_intr = FALSE;
-			//printf("do_serial_fifo_cpu_intr:TX raise interrupt(%d)\n", athrill_serial_fifo[channel].wr_intno);
+	mpu_get_data32(0U, SERIAL_FIFO_DMA_LEN_ADDR(serial_fifo_base_addr, channel, SERIAL_FIFO_DMA_READ), &len);
+	if ((len > 0U) && COMM_FIFO_IS_EMPTY(&fifo->rd)) {
+		/*
+		 * host I/O thread sets active bit when it adds rd data.
+		 */
+		return FALSE;
+	}
+	mpu_get_data32(0U, SERIAL_FIFO_DMA_ADDR_ADDR(serial_fifo_base_addr, channel, SERIAL_FIFO_DMA_READ), &addr);
+
+	mpthread_lock(fifo->rx_thread);
+	while (len > 0U) {
+		size = COMM_FIFO_COUNT(&fifo->rd);
+		if (size > len) {
+			size = len;
 		}
-		else {
-			athrill_serial_fifo[channel].wr_raise_delay_count--;
+		if (size > SERIAL_FIFO_DMA_BUFFER_LEN) {
+			size = SERIAL_FIFO_DMA_BUFFER_LEN;
 		}
+		if (size == 0U) {
+			break;
+		}
+		/*
+		 * data is removed from rd after it is stored: it is kept on fault.
+		 */
+		res = 0U;
+		(void)comm_fifo_buffer_peek(&fifo->rd, (char*)serial_fifo_dma_buffer, size, &res);
+		err = mpu_put_block(0U, addr, serial_fifo_dma_buffer, res);
+		if (err != STD_E_OK) {
+			break;
+		}
+		comm_fifo_buffer_consume(&fifo->rd, res);
+		addr += res;
+		len -= res;
+		is_moved = TRUE;
 	}
-	return;
+	serial_fifo_io_notify(channel);
+	mpthread_unlock(fifo->rx_thread);
+
+	if ((err != STD_E_OK) || (is_moved == TRUE) || (len == 0U)) {
+		do_serial_fifo_cpu_dma_done(channel, SERIAL_FIFO_DMA_READ, cmd, addr, len, err);
+	}
+	return is_moved;
 }
+
 void athrill_device_supply_clock_serial_fifo(DeviceClockType *dev_clock)
 {
 	uint32 i;
-	if (serial_fifo_base_addr == 0x0) {
+	uint32 active;
+	uint32 next_active = 0U;
+	std_bool is_moved;
+
+	active = __atomic_load_n(&serial_fifo_active, __ATOMIC_RELAXED) | __atomic_load_n(&serial_fifo_poll, __ATOMIC_RELAXED);
+	if (active == 0U) {
 		return;
 	}
+	active = __atomic_exchange_n(&serial_fifo_active, 0U, __ATOMIC_ACQUIRE) | __atomic_load_n(&serial_fifo_poll, __ATOMIC_RELAXED);
+	active &= serial_fifo_enabled;
+	serial_fifo_is_device_write = TRUE;
 	for (i = 0; i < SERIAL_FIFO_MAX_CHANNEL_NUM; i++) {
-		if (athrill_serial_fifo[i].rd.data == NULL) {
+		if ((active & SERIAL_FIFO_CH_BIT(i)) == 0U) {
 			continue;
 		}
-		else if (athrill_serial_fifo[i].disable_cpu_io == TRUE) {
-			continue;
+		is_moved = do_serial_fifo_cpu_read(i);
+		is_moved |= do_serial_fifo_cpu_write(i);
+		if (serial_fifo_dma_enable[i] == TRUE) {
+			is_moved |= do_serial_fifo_cpu_dma_read(i);
+			is_moved |= do_serial_fifo_cpu_dma_write(i);
+		}
+		if (is_moved == TRUE) {
+			next_active |= SERIAL_FIFO_CH_BIT(i);
 		}
-		do_serial_fifo_cpu_read(i);
-		do_serial_fifo_cpu_write(i);
-		do_serial_fifo_cpu_intr(i);
+	}
+	serial_fifo_is_device_write = FALSE;
+	if (next_active != 0U) {
+		serial_fifo_set_active(next_active);
 	}
 	return;
 }
 
+/*
+ * snapshot: fifo contents and pending interrupts of enabled channels.
+ * fifo configuration must be same on restore.
+ */
+static Std_ReturnType serial_fifo_snapshot_save_fifo(SnapshotStreamType *stream, CommFifoBufferType *fifop)
+{
+	Std_ReturnType err;
+
+	err = snapshot_write(stream, &fifop->max_size, sizeof(fifop->max_size));
+	if (err == STD_E_OK) {
+		err = snapshot_write(stream, &fifop->count, sizeof(fifop->count));
+	}
+	if (err == STD_E_OK) {
+		err = snapshot_write(stream, &fifop->rx_off, sizeof(fifop->rx_off));
+	}
+	if (err == STD_E_OK) {
+		err = snapshot_write(stream, &fifop->tx_off, sizeof(fifop->tx_off));
+	}
+	if (err == STD_E_OK) {
+		err = snapshot_write(stream, fifop->data, fifop->max_size);
+	}
+	return err;
+}
+static Std_ReturnType serial_fifo_snapshot_restore_fifo(SnapshotStreamType *stream, CommFifoBufferType *fifop)
+{
+	Std_ReturnType err;
+	uint32 max_size;
+
+	err = snapshot_read(stream, &max_size, sizeof(max_size));
+	if ((err != STD_E_OK) || (max_size != fifop->max_size)) {
+		printf("ERROR: snapshot serial fifo size is not matched\n");
+		return STD_E_INVALID;
+	}
+	err = snapshot_read(stream, &fifop->count, sizeof(fifop->count));
+	if (err == STD_E_OK) {
+		err = snapshot_read(stream, &fifop->rx_off, sizeof(fifop->rx_off));
+	}
+	if (err == STD_E_OK) {
+		err = snapshot_read(stream, &fifop->tx_off, sizeof(fifop->tx_off));
+	}
+	if (err == STD_E_OK) {
+		err = snapshot_read(stream, fifop->data, fifop->max_size);
+	}
+	return err;
+}
+static uint32 serial_fifo_snapshot_delay(const DeviceEventType *event)
+{
+	uint64 clock = cpuemu_get_total_clocks();
+
+	if ((device_event_is_set(event) == FALSE) || (event->clock <= clock)) {
+		return 0U;
+	}
+	return (uint32)(event->clock - clock);
+}
+static Std_ReturnType serial_fifo_snapshot_channel(SnapshotStreamType *stream, uint32 channel, bool is_save)
+{
+	Std_ReturnType err = STD_E_OK;
+	AthrillSerialFifoType *fifo = &athrill_serial_fifo[channel];
+	Std_ReturnType (*func) (SnapshotStreamType *, CommFifoBufferType *) =
+			(is_save == TRUE) ? serial_fifo_snapshot_save_fifo : serial_fifo_snapshot_restore_fifo;
+
+	if (fifo->is_extdev == FALSE) {
+		mpthread_lock(fifo->rx_thread);
+	}
+	err = func(stream, &fifo->rd);
+	if (err == STD_E_OK) {
+		err = func(stream, &fifo->rd_dev_buffer);
+	}
+	if (fifo->is_extdev == FALSE) {
+		mpthread_unlock(fifo->rx_thread);
+		mpthread_lock(fifo->tx_thread);
+	}
+	if (err == STD_E_OK) {
+		err = func(stream, &fifo->wr);
+	}
+	if (err == STD_E_OK) {
+		err = func(stream, &fifo->wr_dev_buffer);
+	}
+	if (fifo->is_extdev == FALSE) {
+		serial_fifo_io_notify(channel);
+		mpthread_unlock(fifo->tx_thread);
+	}
+	if (err != STD_E_OK) {
+		return err;
+	}
+	if (is_save == TRUE) {
+		/*
+		 * delay counts are remaining clocks of interrupt events.
+		 */
+		fifo->rd_raise_delay_count = serial_fifo_snapshot_delay(&serial_fifo_rd_intr_event[channel]);
+		fifo->wr_raise_delay_count = serial_fifo_snapshot_delay(&serial_fifo_wr_intr_event[channel]);
+		err = snapshot_write(stream, &fifo->rd_raise_delay_count, sizeof(fifo->rd_raise_delay_count));
+		if (err == STD_E_OK) {
+			err = snapshot_write(stream, &fifo->rd_raise_intr, sizeof(fifo->rd_raise_intr));
+		}
+		if (err == STD_E_OK) {
+			err = snapshot_write(stream, &fifo->wr_raise_delay_count, sizeof(fifo->wr_raise_delay_count));
+		}
+		if (err == STD_E_OK) {
+			err = snapshot_write(stream, &fifo->wr_raise_intr, sizeof(fifo->wr_raise_intr));
+		}
+	}
+	else {
+		err = snapshot_read(stream, &fifo->rd_raise_delay_count, sizeof(fifo->rd_raise_delay_count));
+		if (err == STD_E_OK) {
+			err = snapshot_read(stream, &fifo->rd_raise_intr, sizeof(fifo->rd_raise_intr));
+		}
+		if (err == STD_E_OK) {
+			err = snapshot_read(stream, &fifo->wr_raise_delay_count, sizeof(fifo->wr_raise_delay_count));
+		}
+		if (err == STD_E_OK) {
+			err = snapshot_read(stream, &fifo->wr_raise_intr, sizeof(fifo->wr_raise_intr));
+		}
+		if (err == STD_E_OK) {
+			device_event_cancel(&serial_fifo_rd_intr_event[channel]);
+			device_event_cancel(&serial_fifo_wr_intr_event[channel]);
+			if (fifo->rd_raise_intr == TRUE) {
+				serial_fifo_set_intr(channel, TRUE, fifo->rd_raise_delay_count);
+			}
+			if (fifo->wr_raise_intr == TRUE) {
+				serial_fifo_set_intr(channel, FALSE, fifo->wr_raise_delay_count);
+			}
+		}
+	}
+	return err;
+}
+static Std_ReturnType serial_fifo_snapshot_save(SnapshotStreamType *stream, void *arg)
+{
+	uint32 i;
+	Std_ReturnType err = STD_E_OK;
+
+	for (i = 0; (err == STD_E_OK) && (i < SERIAL_FIFO_MAX_CHANNEL_NUM); i++) {
+		if (athrill_serial_fifo[i].rd.data != NULL) {
+			err = serial_fifo_snapshot_channel(stream, i, TRUE);
+		}
+	}
+	return err;
+}
+static Std_ReturnType serial_fifo_snapshot_restore(SnapshotStreamType *stream, void *arg)
+{
+	uint32 i;
+	Std_ReturnType err = STD_E_OK;
+
+	for (i = 0; (err == STD_E_OK) && (i < SERIAL_FIFO_MAX_CHANNEL_NUM); i++) {
+		if (athrill_serial_fifo[i].rd.data != NULL) {
+			err = serial_fifo_snapshot_channel(stream, i, FALSE);
+		}
+	}
+	/*
+	 * status registers are updated on the next clock.
+	 */
+	serial_fifo_set_active(serial_fifo_enabled);
+	return err;
+}
+static const SnapshotOperationType serial_fifo_snapshot_operation = {
+	.save = serial_fifo_snapshot_save,
+	.restore = serial_fifo_snapshot_restore,
+};
+
 void athrill_device_get_serial_fifo_buffer(uint32 channel, AthrillSerialFifoType **serial_fifop)
 {
 	*serial_fifop = NULL;
@@ -270,155 +662,779 @@ void athrill_device_get_serial_fifo_buffer(uint32 channel, AthrillSerialFifoType
 	if (athrill_serial_fifo[channel].rd.data == NULL) {
 		return;
 	}
+	/*
+	 * caller accesses the buffers directly: channel is handled on every clock.
+	 */
+	(void)__atomic_fetch_or(&serial_fifo_poll, serial_fifo_enabled & SERIAL_FIFO_CH_BIT(channel), __ATOMIC_RELAXED);
 	*serial_fifop = &athrill_serial_fifo[channel];
 	return;
 }
 
 /*
- * Thread Common
+ * Host I/O thread
+ *
+ * one thread serves the host side of all default(not external device) channels.
+ * host fds are non-blocking and waited by epoll, and data is moved in bulk.
+ * rx_thread and tx_thread of these channels are this thread: its lock protects rd and wr.
+ * cpu wakes up the thread by eventfd when it adds tx data or makes space of rx data.
+ *
+ * backend(DEVICE_CONFIG_SERIAL_FILFO_<ch>_BACKEND):
+ *  fifo(default): named fifos of RD_FIFO/WR_FIFO.
+ *  tcp          : TCP_PORT, and TCP_ADDR(default 127.0.0.1) on connect mode.
+ *  unix         : unix domain socket of UNIX_PATH.
+ * socket backend listens(MODE=listen, default) or connects(MODE=connect),
+ * and one socket is used for both directions.
+ * listen mode serves one connection at a time, and accepts next one after it is closed.
+ * connect mode connects again every SERIAL_FIFO_IO_RETRY_MSEC until it succeeds.
+ * connect is non-blocking and completes on EPOLLOUT, so other channels are served meanwhile,
+ * and the failure is logged once until the channel is connected.
+ *
+ * overflow policy(OVERFLOW) when the other side can not take data:
+ *  block(default): data is kept. host fd is not read while rd is full,
+ *                  and wr is kept while the peer is not connected.
+ *  drop          : rx data which does not fit in rd is dropped, and wr data is dropped
+ *                  while the peer is not connected or its socket buffer is full.
  */
+#define SERIAL_FIFO_IO_BUFFER_LEN		4096U
+#define SERIAL_FIFO_IO_EVENT_NUM		((SERIAL_FIFO_MAX_CHANNEL_NUM * 3U) + 1U)
+#define SERIAL_FIFO_IO_RETRY_MSEC		1000U
+#define SERIAL_FIFO_IO_KEY_WAKEUP		0xFFFFFFFFU
+#define SERIAL_FIFO_IO_KEY_RX			0U
+#define SERIAL_FIFO_IO_KEY_TX			1U
+#define SERIAL_FIFO_IO_KEY_SOCKET		2U
+#define SERIAL_FIFO_IO_KEY_LISTEN		3U
+#define SERIAL_FIFO_IO_KEY(ch, kind)	(((ch) << 2U) | (kind))
+
+typedef enum {
+	SERIAL_FIFO_IO_BACKEND_FIFO = 0,
+	SERIAL_FIFO_IO_BACKEND_TCP,
+	SERIAL_FIFO_IO_BACKEND_UNIX,
+} SerialFifoIoBackendType;
+
+typedef struct {
+	std_bool				is_enabled;
+	SerialFifoIoBackendType	backend;
+	std_bool				is_listen;
+	std_bool				is_drop;
+	/*
+	 * socket backend
+	 */
+	char					*unix_path;
+	TcpClientConfigType		tcp_config;
+	char					tcp_addr[INET_ADDRSTRLEN];
+	TcpServerType			server;
+	TcpConnectionType		connection;
+	std_bool				is_connecting;
+	std_bool				is_connect_logged;
+	/*
+	 * rx_fd and tx_fd are the same fd on socket backend.
+	 */
+	int						rx_fd;
+	/*
+	 * writer of rx fifo held by athrill: rx fifo does not hang up when the peer closes.
+	 */
+	int						rx_hold_fd;
+	uint32					rx_events;
+	int						tx_fd;
+	uint32					tx_events;
+	uint64					rx_drop;
+	uint64					tx_drop;
+	/*
+	 * data got from wr, but not written to host fd yet.
+	 */
+	uint32					tx_len;
+	uint32					tx_off;
+	char					tx_buffer[SERIAL_FIFO_IO_BUFFER_LEN];
+} SerialFifoIoChannelType;
 
-static Std_ReturnType serial_fifo_thread_do_init(MpthrIdType id)
+typedef struct {
+	std_bool				is_started;
+	MpthrIdType				thread;
+	int						epfd;
+	int						wakeup_fd;
+	std_bool				is_wakeup;
+	/*
+	 * monotonic msec to retry opening host fds, 0 if all fds are opened.
+	 */
+	uint64					retry_msec;
+	char					rx_buffer[SERIAL_FIFO_IO_BUFFER_LEN];
+	SerialFifoIoChannelType	channel[SERIAL_FIFO_MAX_CHANNEL_NUM];
+} SerialFifoIoType;
+
+static SerialFifoIoType serial_fifo_io = {
+	.is_started = FALSE,
+	.epfd = -1,
+	.wakeup_fd = -1,
+};
+
+static uint64 serial_fifo_io_now_msec(void)
 {
-	return STD_E_OK;
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (((uint64)ts.tv_sec) * 1000ULL) + (((uint64)ts.tv_nsec) / 1000000ULL);
 }
 
-static Std_ReturnType serial_fifo_tx_thread_do_proc(MpthrIdType id)
+static void serial_fifo_io_ctl(int op, int fd, uint32 events, uint32 key)
 {
-	uint32 ch;
+	struct epoll_event event;
+
+	memset(&event, 0, sizeof(event));
+	event.events = events;
+	event.data.u32 = key;
+	if (epoll_ctl(serial_fifo_io.epfd, op, fd, &event) < 0) {
+		printf("ERROR: serial fifo epoll_ctl op=%d fd=%d errno=%d\n", op, fd, errno);
+	}
+	return;
+}
+
+/*
+ * functions below are called with lock of serial_fifo_io.thread.
+ */
+static void serial_fifo_io_notify(uint32 channel)
+{
+	SerialFifoIoChannelType *iop = &serial_fifo_io.channel[channel];
+	uint64 value = 1U;
+	std_bool can_rx;
+	std_bool can_tx;
+
+	if ((iop->is_enabled == FALSE) || (serial_fifo_io.is_wakeup == TRUE)) {
+		return;
+	}
+	can_rx = (iop->rx_fd >= 0) && (iop->rx_events == 0U) && !COMM_FIFO_IS_FULL(&athrill_serial_fifo[channel].rd);
+	can_tx = ((iop->tx_fd >= 0) || (iop->is_drop == TRUE)) && (iop->tx_events == 0U)
+			&& !COMM_FIFO_IS_EMPTY(&athrill_serial_fifo[channel].wr);
+	if ((can_rx == TRUE) || (can_tx == TRUE)) {
+		serial_fifo_io.is_wakeup = TRUE;
+		(void)write(serial_fifo_io.wakeup_fd, &value, sizeof(value));
+	}
+	return;
+}
+static void serial_fifo_io_arm(uint32 channel)
+{
+	SerialFifoIoChannelType *iop = &serial_fifo_io.channel[channel];
+	uint32 rx_events = 0U;
+	uint32 tx_events = 0U;
+
+	if ((iop->rx_fd >= 0) && ((iop->is_drop == TRUE) || !COMM_FIFO_IS_FULL(&athrill_serial_fifo[channel].rd))) {
+		rx_events = EPOLLIN;
+	}
+	if ((iop->tx_fd >= 0) && ((iop->tx_len > 0U) || !COMM_FIFO_IS_EMPTY(&athrill_serial_fifo[channel].wr))) {
+		tx_events = EPOLLOUT;
+	}
+	if (iop->backend == SERIAL_FIFO_IO_BACKEND_FIFO) {
+		if ((iop->rx_fd >= 0) && (rx_events != iop->rx_events)) {
+			serial_fifo_io_ctl(EPOLL_CTL_MOD, iop->rx_fd, rx_events, SERIAL_FIFO_IO_KEY(channel, SERIAL_FIFO_IO_KEY_RX));
+		}
+		if ((iop->tx_fd >= 0) && (tx_events != iop->tx_events)) {
+			serial_fifo_io_ctl(EPOLL_CTL_MOD, iop->tx_fd, tx_events, SERIAL_FIFO_IO_KEY(channel, SERIAL_FIFO_IO_KEY_TX));
+		}
+	}
+	else if ((iop->rx_fd >= 0) && ((rx_events != iop->rx_events) || (tx_events != iop->tx_events))) {
+		/*
+		 * peer close is reported as EPOLLRDHUP only while rx is waited.
+		 */
+		serial_fifo_io_ctl(EPOLL_CTL_MOD, iop->rx_fd,
+				rx_events | tx_events | ((rx_events != 0U) ? EPOLLRDHUP : 0U),
+				SERIAL_FIFO_IO_KEY(channel, SERIAL_FIFO_IO_KEY_SOCKET));
+	}
+	iop->rx_events = rx_events;
+	iop->tx_events = tx_events;
+	return;
+}
+static void serial_fifo_io_drop_tx(uint32 channel)
+{
+	SerialFifoIoChannelType *iop = &serial_fifo_io.channel[channel];
+	CommFifoBufferType *fifop = &athrill_serial_fifo[channel].wr;
 	uint32 res;
-	uint8 data;
-	int fd;
-	ssize_t ret;
+
+	iop->tx_drop += (iop->tx_len - iop->tx_off);
+	iop->tx_len = 0U;
+	iop->tx_off = 0U;
+	while (!COMM_FIFO_IS_EMPTY(fifop)) {
+		res = 0U;
+		(void)comm_fifo_buffer_get(fifop, iop->tx_buffer, SERIAL_FIFO_IO_BUFFER_LEN, &res);
+		iop->tx_drop += res;
+		serial_fifo_set_active(SERIAL_FIFO_CH_BIT(channel));
+	}
+	return;
+}
+static void serial_fifo_io_close(uint32 channel, std_bool is_tx)
+{
+	SerialFifoIoChannelType *iop = &serial_fifo_io.channel[channel];
+
+	if (iop->backend != SERIAL_FIFO_IO_BACKEND_FIFO) {
+		(void)epoll_ctl(serial_fifo_io.epfd, EPOLL_CTL_DEL, iop->connection.socket.fd, NULL);
+		tcp_connection_close(&iop->connection);
+		iop->connection.connected = FALSE;
+		iop->rx_fd = -1;
+		iop->tx_fd = -1;
+		iop->rx_events = 0U;
+		iop->tx_events = 0U;
+		printf("WARNING: serial socket is closed(%s) rx_drop=%"FMT_UINT64" tx_drop=%"FMT_UINT64"\n",
+				athrill_serial_fifo[channel].rx_serial_fifopath, iop->rx_drop, iop->tx_drop);
+		if (iop->is_drop == TRUE) {
+			serial_fifo_io_drop_tx(channel);
+		}
+		if (iop->is_listen == TRUE) {
+			return;
+		}
+	}
+	else if (is_tx == FALSE) {
+		(void)epoll_ctl(serial_fifo_io.epfd, EPOLL_CTL_DEL, iop->rx_fd, NULL);
+		(void)close(iop->rx_fd);
+		if (iop->rx_hold_fd >= 0) {
+			(void)close(iop->rx_hold_fd);
+		}
+		iop->rx_fd = -1;
+		iop->rx_hold_fd = -1;
+		iop->rx_events = 0U;
+	}
+	else {
+		(void)epoll_ctl(serial_fifo_io.epfd, EPOLL_CTL_DEL, iop->tx_fd, NULL);
+		(void)close(iop->tx_fd);
+		iop->tx_fd = -1;
+		iop->tx_events = 0U;
+		printf("WARNING: serial fifo is closed by peer(%s)\n", athrill_serial_fifo[channel].tx_serial_fifopath);
+	}
+	serial_fifo_io.retry_msec = serial_fifo_io_now_msec() + SERIAL_FIFO_IO_RETRY_MSEC;
+	return;
+}
+static void serial_fifo_io_attach(uint32 channel, int fd)
+{
+	SerialFifoIoChannelType *iop = &serial_fifo_io.channel[channel];
+	int on = 1;
+
+	(void)fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	if (iop->backend == SERIAL_FIFO_IO_BACKEND_TCP) {
+		(void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+	}
+	iop->rx_fd = fd;
+	iop->tx_fd = fd;
+	iop->rx_events = 0U;
+	iop->tx_events = 0U;
+	iop->is_connect_logged = FALSE;
+	serial_fifo_io_ctl(EPOLL_CTL_ADD, fd, 0U, SERIAL_FIFO_IO_KEY(channel, SERIAL_FIFO_IO_KEY_SOCKET));
+	printf("OK: connected ch=%d socket(%s)\n", channel, athrill_serial_fifo[channel].rx_serial_fifopath);
+	return;
+}
+static void serial_fifo_io_accept(uint32 channel)
+{
+	SerialFifoIoChannelType *iop = &serial_fifo_io.channel[channel];
+	TcpConnectionType connection;
+
+	if (tcp_server_accept(&iop->server, &connection) != STD_E_OK) {
+		return;
+	}
+	if (iop->connection.socket.fd >= 0) {
+		printf("WARNING: serial socket is busy(%s): new connection is closed\n",
+				athrill_serial_fifo[channel].rx_serial_fifopath);
+		tcp_connection_close(&connection);
+		return;
+	}
+	iop->connection = connection;
+	serial_fifo_io_attach(channel, iop->connection.socket.fd);
+	return;
+}
+static void serial_fifo_io_connect_failed(uint32 channel, int errnum)
+{
+	SerialFifoIoChannelType *iop = &serial_fifo_io.channel[channel];
+
+	if (iop->is_connect_logged == FALSE) {
+		printf("WARNING: serial can not connect socket(%s) errno=%d: retrying\n",
+				athrill_serial_fifo[channel].rx_serial_fifopath, errnum);
+		iop->is_connect_logged = TRUE;
+	}
+	return;
+}
+/*
+ * socket of non-blocking connect is writable(or has an error).
+ */
+static void serial_fifo_io_connect_done(uint32 channel)
+{
+	SerialFifoIoChannelType *iop = &serial_fifo_io.channel[channel];
+	int errnum;
+
+	iop->is_connecting = FALSE;
+	(void)epoll_ctl(serial_fifo_io.epfd, EPOLL_CTL_DEL, iop->connection.socket.fd, NULL);
+	if (tcp_client_connect_result(&iop->connection, &errnum) != STD_E_OK) {
+		tcp_connection_close(&iop->connection);
+		serial_fifo_io_connect_failed(channel, errnum);
+		serial_fifo_io.retry_msec = serial_fifo_io_now_msec() + SERIAL_FIFO_IO_RETRY_MSEC;
+		return;
+	}
+	serial_fifo_io_attach(channel, iop->connection.socket.fd);
+	return;
+}
+static std_bool serial_fifo_io_open_socket(uint32 channel)
+{
+	SerialFifoIoChannelType *iop = &serial_fifo_io.channel[channel];
+	TcpServerConfigType server_config;
+	TcpClientType client;
+	TcpConnectionType connection;
 	Std_ReturnType err;
+	int errnum = 0;
 
-	mpthread_lock(id);
-	for (ch = 0; ch < SERIAL_FIFO_MAX_CHANNEL_NUM; ch++) {
-		if (athrill_serial_fifo[ch].wr.data == NULL) {
-			continue;
+	if (iop->is_listen == TRUE) {
+		if (iop->server.socket.fd >= 0) {
+			return TRUE;
 		}
-		if (athrill_serial_fifo[ch].is_extdev == TRUE) {
-			continue;
+		if (iop->backend == SERIAL_FIFO_IO_BACKEND_TCP) {
+			server_config.server_port = iop->tcp_config.server_port;
+			err = tcp_server_create(&server_config, &iop->server);
 		}
-		if (athrill_serial_fifo[ch].tx_thread == id) {
-			break;
+		else {
+			err = tcp_server_create_unix(iop->unix_path, &iop->server);
+		}
+		if (err != STD_E_OK) {
+			printf("ERROR: serial can not listen socket(%s)\n", athrill_serial_fifo[channel].rx_serial_fifopath);
+			tcp_server_close(&iop->server);
+			return FALSE;
 		}
+		(void)fcntl(iop->server.socket.fd, F_SETFL, fcntl(iop->server.socket.fd, F_GETFL) | O_NONBLOCK);
+		serial_fifo_io_ctl(EPOLL_CTL_ADD, iop->server.socket.fd, EPOLLIN, SERIAL_FIFO_IO_KEY(channel, SERIAL_FIFO_IO_KEY_LISTEN));
+		printf("OK: listen ch=%d socket(%s)\n", channel, athrill_serial_fifo[channel].rx_serial_fifopath);
+		return TRUE;
 	}
-	mpthread_unlock(id);
-	ASSERT(ch != SERIAL_FIFO_MAX_CHANNEL_NUM);
+	/*
+	 * connected, or connecting: serial_fifo_io_connect_done() retries on failure.
+	 */
+	if (iop->connection.socket.fd >= 0) {
+		return TRUE;
+	}
+	if (iop->backend == SERIAL_FIFO_IO_BACKEND_TCP) {
+		err = tcp_client_create(&iop->tcp_config, &client);
+		if (err == STD_E_OK) {
+			err = tcp_client_connect_nblk(&client, &errnum);
+		}
+		connection = client.connection;
+	}
+	else {
+		err = tcp_client_connect_unix_nblk(iop->unix_path, &connection, &errnum);
+	}
+	if (err != STD_E_OK) {
+		tcp_connection_close(&connection);
+		serial_fifo_io_connect_failed(channel, errnum);
+		return FALSE;
+	}
+	iop->connection = connection;
+	if (connection.connected == TRUE) {
+		serial_fifo_io_attach(channel, iop->connection.socket.fd);
+	}
+	else {
+		iop->is_connecting = TRUE;
+		serial_fifo_io_ctl(EPOLL_CTL_ADD, iop->connection.socket.fd, EPOLLOUT, SERIAL_FIFO_IO_KEY(channel, SERIAL_FIFO_IO_KEY_SOCKET));
+	}
+	return TRUE;
+}
+/*
+ * tx fifo can not be opened until the peer opens it for reading(ENXIO).
+ */
+static std_bool serial_fifo_io_open_fifo(uint32 channel)
+{
+	SerialFifoIoChannelType *iop = &serial_fifo_io.channel[channel];
+	struct stat st;
 
-	fd = -1;
-	while (fd < 0) {
-		fd = open(athrill_serial_fifo[ch].tx_serial_fifopath, O_WRONLY);
-		if (fd < 0) {
-			target_os_api_sleep(1000);// 1000msec
-			printf("ERROR: can not open fifo(%s)\n", athrill_serial_fifo[ch].tx_serial_fifopath);
+	if (iop->rx_fd < 0) {
+		iop->rx_fd = open(athrill_serial_fifo[channel].rx_serial_fifopath, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+		if (iop->rx_fd < 0) {
+			printf("ERROR: serial can not open fifo(%s)\n", athrill_serial_fifo[channel].rx_serial_fifopath);
+		}
+		else {
+			if ((fstat(iop->rx_fd, &st) == 0) && S_ISFIFO(st.st_mode)) {
+				iop->rx_hold_fd = open(athrill_serial_fifo[channel].rx_serial_fifopath, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+			}
+			serial_fifo_io_ctl(EPOLL_CTL_ADD, iop->rx_fd, 0U, SERIAL_FIFO_IO_KEY(channel, SERIAL_FIFO_IO_KEY_RX));
+			iop->rx_events = 0U;
+			printf("OK: open ch=%d rx_fifo(%s)\n", channel, athrill_serial_fifo[channel].rx_serial_fifopath);
 		}
 	}
-	ASSERT(fd >= 0);
-	printf("id=%d OK: open ch=%d tx_fifo(%s)\n", id, ch, athrill_serial_fifo[ch].tx_serial_fifopath);
-	while (TRUE) {
-		if (athrill_serial_fifo[ch].wr.count == 0) {
-			target_os_api_sleep(100);// 100msec
-			continue;
+	if (iop->tx_fd < 0) {
+		iop->tx_fd = open(athrill_serial_fifo[channel].tx_serial_fifopath, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+		if (iop->tx_fd < 0) {
+			printf("ERROR: can not open fifo(%s)\n", athrill_serial_fifo[channel].tx_serial_fifopath);
 		}
-		mpthread_lock(athrill_serial_fifo[ch].tx_thread);
-		err = comm_fifo_buffer_get(&athrill_serial_fifo[ch].wr, (char*)&data, 1, &res);
-		ASSERT(err == STD_E_OK);
-		mpthread_unlock(athrill_serial_fifo[ch].tx_thread);
+		else {
+			serial_fifo_io_ctl(EPOLL_CTL_ADD, iop->tx_fd, 0U, SERIAL_FIFO_IO_KEY(channel, SERIAL_FIFO_IO_KEY_TX));
+			iop->tx_events = 0U;
+			printf("OK: open ch=%d tx_fifo(%s)\n", channel, athrill_serial_fifo[channel].tx_serial_fifopath);
+		}
+	}
+	return ((iop->rx_fd >= 0) && (iop->tx_fd >= 0));
+}
 
-		ret = write(fd, (void*)&data, 1);
-		if (ret <= 0) {
-			printf("ERROR: can not put data on fifo(%s)\n", athrill_serial_fifo[ch].tx_serial_fifopath);
+/*
+ * functions below are called without lock: only this thread adds rd and gets wr.
+ */
+static void serial_fifo_io_rx(uint32 channel)
+{
+	SerialFifoIoChannelType *iop = &serial_fifo_io.channel[channel];
+	CommFifoBufferType *fifop = &athrill_serial_fifo[channel].rd;
+	uint32 len;
+	uint32 res = 0U;
+	ssize_t ret;
+
+	len = fifop->max_size - COMM_FIFO_COUNT(fifop);
+	if ((len > SERIAL_FIFO_IO_BUFFER_LEN) || (iop->is_drop == TRUE)) {
+		len = SERIAL_FIFO_IO_BUFFER_LEN;
+	}
+	if (len == 0U) {
+		return;
+	}
+	ret = read(iop->rx_fd, serial_fifo_io.rx_buffer, len);
+	if (ret > 0) {
+		mpthread_lock(serial_fifo_io.thread);
+		(void)comm_fifo_buffer_add(fifop, serial_fifo_io.rx_buffer, (uint32)ret, &res);
+		mpthread_unlock(serial_fifo_io.thread);
+		iop->rx_drop += ((uint32)ret - res);
+		if (res > 0U) {
+			serial_fifo_set_active(SERIAL_FIFO_CH_BIT(channel));
 		}
 	}
+	else if ((ret == 0) || ((errno != EAGAIN) && (errno != EINTR))) {
+		/*
+		 * end of file: rx is not a fifo, or socket peer is closed.
+		 */
+		mpthread_lock(serial_fifo_io.thread);
+		serial_fifo_io_close(channel, FALSE);
+		mpthread_unlock(serial_fifo_io.thread);
+	}
+	return;
+}
+static void serial_fifo_io_tx(uint32 channel, uint32 events)
+{
+	SerialFifoIoChannelType *iop = &serial_fifo_io.channel[channel];
+	CommFifoBufferType *fifop = &athrill_serial_fifo[channel].wr;
+	uint32 len;
+	uint32 res = 0U;
+	ssize_t ret;
+
+	if (iop->tx_len == 0U) {
+		mpthread_lock(serial_fifo_io.thread);
+		len = COMM_FIFO_COUNT(fifop);
+		if (len > SERIAL_FIFO_IO_BUFFER_LEN) {
+			len = SERIAL_FIFO_IO_BUFFER_LEN;
+		}
+		if (len > 0U) {
+			(void)comm_fifo_buffer_get(fifop, iop->tx_buffer, len, &res);
+		}
+		mpthread_unlock(serial_fifo_io.thread);
+		iop->tx_len = res;
+		iop->tx_off = 0U;
+		if (res > 0U) {
+			serial_fifo_set_active(SERIAL_FIFO_CH_BIT(channel));
+		}
+	}
+	if (iop->tx_len > 0U) {
+		ret = write(iop->tx_fd, &iop->tx_buffer[iop->tx_off], iop->tx_len - iop->tx_off);
+		if (ret > 0) {
+			iop->tx_off += (uint32)ret;
+			if ((iop->tx_off < iop->tx_len) && (iop->is_drop == TRUE)) {
+				iop->tx_drop += (iop->tx_len - iop->tx_off);
+				iop->tx_off = iop->tx_len;
+			}
+			if (iop->tx_off >= iop->tx_len) {
+				iop->tx_len = 0U;
+				iop->tx_off = 0U;
+			}
+			return;
+		}
+		if ((ret < 0) && ((errno == EAGAIN) || (errno == EINTR))) {
+			return;
+		}
+	}
+	else if ((events & (EPOLLERR | EPOLLHUP)) == 0U) {
+		return;
+	}
+	/*
+	 * peer is closed: data not written is kept until the peer is opened again(block policy).
+	 */
+	mpthread_lock(serial_fifo_io.thread);
+	serial_fifo_io_close(channel, TRUE);
+	mpthread_unlock(serial_fifo_io.thread);
+	return;
+}
+static void serial_fifo_io_socket(uint32 channel, uint32 events)
+{
+	SerialFifoIoChannelType *iop = &serial_fifo_io.channel[channel];
+
+	if ((events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0U) {
+		serial_fifo_io_rx(channel);
+	}
+	if ((iop->tx_fd >= 0) && ((events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) != 0U)) {
+		serial_fifo_io_tx(channel, events);
+	}
+	if ((iop->rx_fd >= 0) && ((events & (EPOLLHUP | EPOLLERR)) != 0U)) {
+		mpthread_lock(serial_fifo_io.thread);
+		serial_fifo_io_close(channel, FALSE);
+		mpthread_unlock(serial_fifo_io.thread);
+	}
+	return;
+}
+
+static Std_ReturnType serial_fifo_io_thread_do_init(MpthrIdType id)
+{
 	return STD_E_OK;
 }
-static Std_ReturnType serial_fifo_rx_thread_do_proc(MpthrIdType id)
+static Std_ReturnType serial_fifo_io_thread_do_proc(MpthrIdType id)
 {
+	struct epoll_event events[SERIAL_FIFO_IO_EVENT_NUM];
+	SerialFifoIoChannelType *iop;
 	uint32 ch;
-	uint32 res;
-	uint8 data;
-	int fd;
-	ssize_t ret;
-	Std_ReturnType err;
+	uint32 key;
+	uint64 now;
+	uint64 value;
+	int timeout = -1;
+	int num;
+	int i;
+	std_bool is_opened = TRUE;
 
 	mpthread_lock(id);
-	for (ch = 0; ch < SERIAL_FIFO_MAX_CHANNEL_NUM; ch++) {
-		if (athrill_serial_fifo[ch].rd.data == NULL) {
-			continue;
+	now = serial_fifo_io_now_msec();
+	if ((serial_fifo_io.retry_msec != 0U) && (now >= serial_fifo_io.retry_msec)) {
+		for (ch = 0; ch < SERIAL_FIFO_MAX_CHANNEL_NUM; ch++) {
+			iop = &serial_fifo_io.channel[ch];
+			if (iop->is_enabled == FALSE) {
+				continue;
+			}
+			if (iop->backend == SERIAL_FIFO_IO_BACKEND_FIFO) {
+				is_opened &= serial_fifo_io_open_fifo(ch);
+			}
+			else {
+				is_opened &= serial_fifo_io_open_socket(ch);
+			}
 		}
-		if (athrill_serial_fifo[ch].is_extdev == TRUE) {
+		serial_fifo_io.retry_msec = (is_opened == TRUE) ? 0U : (now + SERIAL_FIFO_IO_RETRY_MSEC);
+	}
+	if (serial_fifo_io.retry_msec != 0U) {
+		timeout = (now >= serial_fifo_io.retry_msec) ? 0 : (int)(serial_fifo_io.retry_msec - now);
+	}
+	for (ch = 0; ch < SERIAL_FIFO_MAX_CHANNEL_NUM; ch++) {
+		iop = &serial_fifo_io.channel[ch];
+		if (iop->is_enabled == FALSE) {
 			continue;
 		}
-		if (athrill_serial_fifo[ch].rx_thread == id) {
-			break;
+		if ((iop->is_drop == TRUE) && (iop->tx_fd < 0)) {
+			serial_fifo_io_drop_tx(ch);
 		}
+		serial_fifo_io_arm(ch);
 	}
 	mpthread_unlock(id);
-	ASSERT(ch != SERIAL_FIFO_MAX_CHANNEL_NUM);
-	printf("id=%d OK: open ch=%d rx_fifo(%s)\n", id, ch, athrill_serial_fifo[ch].rx_serial_fifopath);
 
-	fd = -1;
-	while (fd < 0) {
-		fd = open(athrill_serial_fifo[ch].rx_serial_fifopath, O_RDONLY);
-		if (fd < 0) {
-			target_os_api_sleep(1000);// 1000msec
-			printf("ERROR: serial can not open fifo(%s)\n", athrill_serial_fifo[ch].rx_serial_fifopath);
+	num = epoll_wait(serial_fifo_io.epfd, events, SERIAL_FIFO_IO_EVENT_NUM, timeout);
+	if (num < 0) {
+		if (errno != EINTR) {
+			printf("ERROR: serial fifo epoll_wait errno=%d\n", errno);
 		}
+		return STD_E_OK;
 	}
-	ASSERT(fd >= 0);
-
-	while (TRUE) {
-		if (COMM_FIFO_IS_FULL(&athrill_serial_fifo[ch].rd)) {
-			target_os_api_sleep(500);// 500msec
+	for (i = 0; i < num; i++) {
+		key = events[i].data.u32;
+		if (key == SERIAL_FIFO_IO_KEY_WAKEUP) {
+			mpthread_lock(id);
+			(void)read(serial_fifo_io.wakeup_fd, &value, sizeof(value));
+			serial_fifo_io.is_wakeup = FALSE;
+			mpthread_unlock(id);
 			continue;
 		}
-		ret = read(fd, (void*)&data, 1);
-		if (ret <= 0) {
-			target_os_api_sleep(500);// 500msec
-			//printf("ERROR: can not get data from fifo(%s)\n", athrill_serial_fifo[ch].rx_serial_fifopath);
-			continue;
+		ch = (key >> 2U);
+		switch (key & 0x3U) {
+		case SERIAL_FIFO_IO_KEY_RX:
+			serial_fifo_io_rx(ch);
+			break;
+		case SERIAL_FIFO_IO_KEY_TX:
+			serial_fifo_io_tx(ch, events[i].events);
+			break;
+		case SERIAL_FIFO_IO_KEY_SOCKET:
+			/*
+			 * socket may be closed by a previous event of the same channel.
+			 */
+			if (serial_fifo_io.channel[ch].rx_fd >= 0) {
+				serial_fifo_io_socket(ch, events[i].events);
+			}
+			else if (serial_fifo_io.channel[ch].is_connecting == TRUE) {
+				mpthread_lock(id);
+				serial_fifo_io_connect_done(ch);
+				mpthread_unlock(id);
+			}
+			break;
+		default:
+			mpthread_lock(id);
+			serial_fifo_io_accept(ch);
+			mpthread_unlock(id);
+			break;
 		}
-		mpthread_lock(athrill_serial_fifo[ch].rx_thread);
-		err = comm_fifo_buffer_add(&athrill_serial_fifo[ch].rd, (const char*)&data, 1, &res);
-		ASSERT(err == STD_E_OK);
-		mpthread_unlock(athrill_serial_fifo[ch].rx_thread);
 	}
 	return STD_E_OK;
 }
-static MpthrOperationType	rx_thread_ops = {
-	.do_init = serial_fifo_thread_do_init,
-	.do_proc = serial_fifo_rx_thread_do_proc,
-};
-static MpthrOperationType	tx_thread_ops = {
-	.do_init = serial_fifo_thread_do_init,
-	.do_proc = serial_fifo_tx_thread_do_proc,
+static MpthrOperationType	serial_fifo_io_thread_ops = {
+	.do_init = serial_fifo_io_thread_do_init,
+	.do_proc = serial_fifo_io_thread_do_proc,
 };
 
-static void serial_fifo_thread_start(uint32 channel)
+/*
+ * epoll instance and eventfd are shared with the parent after fork: forked variant uses its own.
+ * opened host fds are added again, and armed on the first proc.
+ */
+static void serial_fifo_io_fork_child(void)
 {
+	SerialFifoIoChannelType *iop;
+	uint32 ch;
+
+	(void)close(serial_fifo_io.epfd);
+	(void)close(serial_fifo_io.wakeup_fd);
+	serial_fifo_io.epfd = epoll_create1(EPOLL_CLOEXEC);
+	ASSERT(serial_fifo_io.epfd >= 0);
+	serial_fifo_io.wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	ASSERT(serial_fifo_io.wakeup_fd >= 0);
+	serial_fifo_io_ctl(EPOLL_CTL_ADD, serial_fifo_io.wakeup_fd, EPOLLIN, SERIAL_FIFO_IO_KEY_WAKEUP);
+	serial_fifo_io.is_wakeup = FALSE;
+	for (ch = 0; ch < SERIAL_FIFO_MAX_CHANNEL_NUM; ch++) {
+		iop = &serial_fifo_io.channel[ch];
+		if (iop->is_enabled == FALSE) {
+			continue;
+		}
+		if (iop->backend == SERIAL_FIFO_IO_BACKEND_FIFO) {
+			if (iop->rx_fd >= 0) {
+				serial_fifo_io_ctl(EPOLL_CTL_ADD, iop->rx_fd, 0U, SERIAL_FIFO_IO_KEY(ch, SERIAL_FIFO_IO_KEY_RX));
+			}
+			if (iop->tx_fd >= 0) {
+				serial_fifo_io_ctl(EPOLL_CTL_ADD, iop->tx_fd, 0U, SERIAL_FIFO_IO_KEY(ch, SERIAL_FIFO_IO_KEY_TX));
+			}
+		}
+		else {
+			if (iop->server.socket.fd >= 0) {
+				serial_fifo_io_ctl(EPOLL_CTL_ADD, iop->server.socket.fd, EPOLLIN, SERIAL_FIFO_IO_KEY(ch, SERIAL_FIFO_IO_KEY_LISTEN));
+			}
+			if (iop->connection.socket.fd >= 0) {
+				serial_fifo_io_ctl(EPOLL_CTL_ADD, iop->connection.socket.fd, (iop->is_connecting == TRUE) ? EPOLLOUT : 0U,
+						SERIAL_FIFO_IO_KEY(ch, SERIAL_FIFO_IO_KEY_SOCKET));
+			}
+		}
+		iop->rx_events = 0U;
+		iop->tx_events = 0U;
+	}
+	return;
+}
+
+static char *serial_fifo_io_config_string(uint32 channel, const char *name, char *default_value)
+{
+	char *value;
+
+	snprintf(serial_fifo_param_buffer, sizeof(serial_fifo_param_buffer), "DEVICE_CONFIG_SERIAL_FILFO_%d_%s", channel, name);
+	if (cpuemu_get_devcfg_string(serial_fifo_param_buffer, &value) != STD_E_OK) {
+		value = default_value;
+	}
+	printf("%s=%s\n", serial_fifo_param_buffer, (value != NULL) ? value : "");
+	return value;
+}
+static void serial_fifo_io_config(uint32 channel)
+{
+	SerialFifoIoChannelType *iop = &serial_fifo_io.channel[channel];
 	Std_ReturnType err;
+	char *backend;
+	char *value;
+	uint32 port = 0U;
+	char name[256];
+	struct in_addr in_addr;
+	struct addrinfo hints;
+	struct addrinfo *res;
+	int ret;
 
-	snprintf(serial_fifo_param_buffer, sizeof(serial_fifo_param_buffer), "DEVICE_CONFIG_SERIAL_FILFO_%d_RD_FIFO", channel);
-	err = cpuemu_get_devcfg_string(serial_fifo_param_buffer, &athrill_serial_fifo[channel].rx_serial_fifopath);
-	ASSERT(err == STD_E_OK);
+	backend = serial_fifo_io_config_string(channel, "BACKEND", "fifo");
+	value = serial_fifo_io_config_string(channel, "OVERFLOW", "block");
+	ASSERT((strcmp(value, "block") == 0) || (strcmp(value, "drop") == 0));
+	iop->is_drop = (strcmp(value, "drop") == 0);
 
-	snprintf(serial_fifo_param_buffer, sizeof(serial_fifo_param_buffer), "DEVICE_CONFIG_SERIAL_FILFO_%d_WR_FIFO", channel);
-	err = cpuemu_get_devcfg_string(serial_fifo_param_buffer, &athrill_serial_fifo[channel].tx_serial_fifopath);
-	ASSERT(err == STD_E_OK);
+	if (strcmp(backend, "fifo") == 0) {
+		iop->backend = SERIAL_FIFO_IO_BACKEND_FIFO;
+		athrill_serial_fifo[channel].rx_serial_fifopath = serial_fifo_io_config_string(channel, "RD_FIFO", NULL);
+		ASSERT(athrill_serial_fifo[channel].rx_serial_fifopath != NULL);
+		athrill_serial_fifo[channel].tx_serial_fifopath = serial_fifo_io_config_string(channel, "WR_FIFO", NULL);
+		ASSERT(athrill_serial_fifo[channel].tx_serial_fifopath != NULL);
+		return;
+	}
+	value = serial_fifo_io_config_string(channel, "MODE", "listen");
+	ASSERT((strcmp(value, "listen") == 0) || (strcmp(value, "connect") == 0));
+	iop->is_listen = (strcmp(value, "listen") == 0);
+	if (strcmp(backend, "tcp") == 0) {
+		iop->backend = SERIAL_FIFO_IO_BACKEND_TCP;
+		snprintf(serial_fifo_param_buffer, sizeof(serial_fifo_param_buffer), "DEVICE_CONFIG_SERIAL_FILFO_%d_TCP_PORT", channel);
+		err = cpuemu_get_devcfg_value(serial_fifo_param_buffer, &port);
+		ASSERT((err == STD_E_OK) && (port <= 0xFFFFU));
+		printf("%s=%u\n", serial_fifo_param_buffer, port);
+		iop->tcp_config.server_port = (uint16)port;
+		iop->tcp_config.ipaddr = serial_fifo_io_config_string(channel, "TCP_ADDR", "127.0.0.1");
+		if ((iop->is_listen == FALSE) && (inet_pton(AF_INET, iop->tcp_config.ipaddr, &in_addr) != 1)) {
+			/*
+			 * host name is resolved once here: lookup blocks, and connect is retried on the I/O thread.
+			 */
+			memset(&hints, 0, sizeof(hints));
+			hints.ai_family = AF_INET;
+			hints.ai_socktype = SOCK_STREAM;
+			ret = getaddrinfo(iop->tcp_config.ipaddr, NULL, &hints, &res);
+			ASSERT(ret == 0);
+			(void)inet_ntop(AF_INET, &((struct sockaddr_in *)res->ai_addr)->sin_addr, iop->tcp_addr, sizeof(iop->tcp_addr));
+			freeaddrinfo(res);
+			printf("DEVICE_CONFIG_SERIAL_FILFO_%d_TCP_ADDR: %s is %s\n", channel, iop->tcp_config.ipaddr, iop->tcp_addr);
+			iop->tcp_config.ipaddr = iop->tcp_addr;
+		}
+		snprintf(name, sizeof(name), "tcp:%s:%u", (iop->is_listen == TRUE) ? "*" : iop->tcp_config.ipaddr, port);
+	}
+	else {
+		ASSERT(strcmp(backend, "unix") == 0);
+		iop->backend = SERIAL_FIFO_IO_BACKEND_UNIX;
+		iop->unix_path = serial_fifo_io_config_string(channel, "UNIX_PATH", NULL);
+		ASSERT(iop->unix_path != NULL);
+		snprintf(name, sizeof(name), "unix:%s", iop->unix_path);
+	}
+	athrill_serial_fifo[channel].rx_serial_fifopath = strdup(name);
+	ASSERT(athrill_serial_fifo[channel].rx_serial_fifopath != NULL);
+	athrill_serial_fifo[channel].tx_serial_fifopath = athrill_serial_fifo[channel].rx_serial_fifopath;
+	return;
+}
 
-	err = mpthread_register(&athrill_serial_fifo[channel].rx_thread, &rx_thread_ops);
-	ASSERT(err == STD_E_OK);
-	err = mpthread_register(&athrill_serial_fifo[channel].tx_thread, &tx_thread_ops);
-	ASSERT(err == STD_E_OK);
-	//printf("ch=%d tx_thr_id=%d\n", channel, athrill_serial_fifo[channel].tx_thread);
-	//printf("ch=%d rx_thr_id=%d\n", channel, athrill_serial_fifo[channel].rx_thread);
+static void serial_fifo_thread_start(uint32 channel)
+{
+	Std_ReturnType err;
+	SerialFifoIoChannelType *iop = &serial_fifo_io.channel[channel];
 
-	err = mpthread_start_proc(athrill_serial_fifo[channel].rx_thread);
-	ASSERT(err == STD_E_OK);
-	err = mpthread_start_proc(athrill_serial_fifo[channel].tx_thread);
-	ASSERT(err == STD_E_OK);
+	serial_fifo_io_config(channel);
+	if (serial_fifo_io.is_started == FALSE) {
+		serial_fifo_io.epfd = epoll_create1(EPOLL_CLOEXEC);
+		ASSERT(serial_fifo_io.epfd >= 0);
+		serial_fifo_io.wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		ASSERT(serial_fifo_io.wakeup_fd >= 0);
+		serial_fifo_io_ctl(EPOLL_CTL_ADD, serial_fifo_io.wakeup_fd, EPOLLIN, SERIAL_FIFO_IO_KEY_WAKEUP);
+		err = mpthread_register(&serial_fifo_io.thread, &serial_fifo_io_thread_ops);
+		ASSERT(err == STD_E_OK);
+		serial_fifo_io.is_started = TRUE;
+		(void)snapshot_register_fork_child(serial_fifo_io_fork_child);
+	}
+	/*
+	 * host fds are opened by the thread on the first proc.
+	 */
+	iop->is_enabled = TRUE;
+	iop->rx_fd = -1;
+	iop->rx_hold_fd = -1;
+	iop->tx_fd = -1;
+	iop->server.socket.fd = -1;
+	iop->connection.socket.fd = -1;
+	iop->is_connecting = FALSE;
+	iop->is_connect_logged = FALSE;
+	serial_fifo_io.retry_msec = 1U;
+	athrill_serial_fifo[channel].rx_thread = serial_fifo_io.thread;
+	athrill_serial_fifo[channel].tx_thread = serial_fifo_io.thread;
 	return;
 }
+static void serial_fifo_io_start(void)
+{
+	Std_ReturnType err;
 
+	if (serial_fifo_io.is_started == FALSE) {
+		return;
+	}
+	err = mpthread_start_proc(serial_fifo_io.thread);
+	ASSERT(err == STD_E_OK);
+	return;
+}
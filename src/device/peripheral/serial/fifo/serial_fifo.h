@@ -86,6 +86,53 @@
  * 		}
  */
 
+/*
+ * DMA registers(DEVICE_CONFIG_SERIAL_FILFO_<ch>_DMA_ENABLE=1)
+ *
+ * each channel has 32bit registers of write(cpu -> fifo) and read(fifo -> cpu) direction:
+ *  addr: guest buffer address, advanced by transferred bytes.
+ *  len : remaining bytes, decreased by transferred bytes.
+ *  cmd : cpu writes START(with INTR if needed) to start transfer,
+ *        device writes NONE on completion, or ERROR if the buffer is not accessible.
+ * write completes when all data is moved into the fifo buffer.
+ * read completes when some data is moved(up to len), like read(2).
+ * on completion with INTR, wr_intno/rd_intno is raised.
+ * byte registers above can be used at the same time.
+ */
+#define SERIAL_FIFO_DMA_OFF							0x40U
+#define SERIAL_FIFO_DMA_CH_SIZE						0x20U
+#define SERIAL_FIFO_DMA_WRITE						0x00U
+#define SERIAL_FIFO_DMA_READ						0x10U
+#define SERIAL_FIFO_DMA_BASE(base, ch, dir)			((base) + SERIAL_FIFO_DMA_OFF + ((ch) * SERIAL_FIFO_DMA_CH_SIZE) + (dir))
+#define SERIAL_FIFO_DMA_ADDR_ADDR(base, ch, dir)	(SERIAL_FIFO_DMA_BASE(base, ch, dir) + 0x0U)
+#define SERIAL_FIFO_DMA_LEN_ADDR(base, ch, dir)		(SERIAL_FIFO_DMA_BASE(base, ch, dir) + 0x4U)
+#define SERIAL_FIFO_DMA_CMD_ADDR(base, ch, dir)		(SERIAL_FIFO_DMA_BASE(base, ch, dir) + 0x8U)
+
+/*
+ * size of all registers.
+ */
+#define SERIAL_FIFO_REG_SIZE						(SERIAL_FIFO_DMA_OFF + (SERIAL_FIFO_MAX_CHANNEL_NUM * SERIAL_FIFO_DMA_CH_SIZE))
+
+#define SERIAL_FIFO_DMA_CMD_NONE				0x0
+#define SERIAL_FIFO_DMA_CMD_START				0x1
+#define SERIAL_FIFO_DMA_CMD_INTR				0x2
+#define SERIAL_FIFO_DMA_CMD_ERROR				0x80
+
+/*
+ *  cpu dma write example:
+ *  	dev_write32(addr_addr, buf);
+ *  	dev_write32(len_addr, len);
+ *  	dev_write32(cmd_addr, 0x1 | 0x2);
+ *  	...wait interrupt or cmd == 0x0
+ *
+ *  cpu dma read example:
+ *  	dev_write32(addr_addr, buf);
+ *  	dev_write32(len_addr, len);
+ *  	dev_write32(cmd_addr, 0x1 | 0x2);
+ *  	...wait interrupt or cmd == 0x0
+ *  	received = len - dev_read32(len_addr);
+ */
+
 extern void athrill_device_init_serial_fifo(void);
 extern void athrill_device_supply_clock_serial_fifo(DeviceClockType *dev_clock);
 #define SERIAL_FIFO_RD_BUFFER_LEN	16U
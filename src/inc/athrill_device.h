@@ -8,7 +8,7 @@
 
 extern void device_init_athrill_device(void);
 extern void device_init_athrill_exdev(void);
-extern void device_add_athrill_exdev(void *devp, void *region);
+extern void device_add_athrill_exdev(void *devp, uint32 region_index);
 
 extern void device_supply_clock_athrill_device(void);
 extern void device_supply_clock_exdev(DeviceClockType *dev_clock);
@@ -21,5 +21,51 @@ typedef struct {
 extern void athrill_device_set_mmap_info(AthrillDeviceMmapInfoType *info);
 
 extern void athrill_syscall_device(uint32 addr);
+extern void athrill_syscall_device_init(void);
+/*
+ * must be called before threads are created.
+ */
+extern void athrill_system_helper_init(void);
+
+/*
+ * per api statistics of syscall device.
+ * hist[i] counts calls whose latency is less than (1 << (ATHRILL_SYSCALL_STAT_HIST_SHIFT + i)) ns,
+ * last bucket has no upper bound.
+ */
+#define ATHRILL_SYSCALL_STAT_HIST_SHIFT		10U
+#define ATHRILL_SYSCALL_STAT_HIST_NUM		16U
+typedef struct {
+	uint64	count;
+	uint64	bytes;
+	uint64	total_ns;
+	uint64	max_ns;
+	uint64	guest_clocks;
+	uint64	hist[ATHRILL_SYSCALL_STAT_HIST_NUM];
+} AthrillSyscallStatType;
+extern void athrill_syscall_stat_init(void);
+extern uint64 athrill_syscall_stat_start(void);
+extern void athrill_syscall_stat_end(uint32 api_id, uint64 start_ns, uint64 bytes);
+extern const char *athrill_syscall_stat_name(uint32 api_id);
+extern Std_ReturnType athrill_syscall_stat_get(uint32 api_id, AthrillSyscallStatType *stat);
+extern void athrill_syscall_stat_clear(void);
+extern Std_ReturnType athrill_syscall_stat_dump(const char *path);
+
+/*
+ * epoll reactor of guest sockets.
+ */
+extern sint32 athrill_syscall_epoll_setup(uint32 readfds, uint32 writefds, uint32 intno);
+extern void athrill_syscall_epoll_add(int fd);
+extern void athrill_syscall_epoll_clear(int fd, bool is_write);
+extern void athrill_syscall_epoll_remove(int fd);
+extern void athrill_syscall_epoll_supply_clock(void);
+
+/*
+ * doorbell region of athrill device(DEVICE_CONFIG_ATHRILL_DOORBELL_ADDR).
+ * syscall is dispatched on the store to the doorbell instead of polling every clock.
+ */
+#define ATHRILL_DEVICE_DOORBELL_FUNC_CALL_OFF			0x0U
+#define ATHRILL_DEVICE_DOORBELL_RAISE_INTERRUPT_OFF		0x4U
+#define ATHRILL_DEVICE_DOORBELL_SIZE					0x8U
+extern Std_ReturnType device_set_athrill_doorbell(void);
 
 #endif /* _ATHRILL_DEVICE_H_ */
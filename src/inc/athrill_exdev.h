@@ -10,6 +10,7 @@
 #include "udp/udp_comm.h"
 #include "athrill_mpthread.h"
 #include "serial_fifo.h"
+#include "snapshot.h"
 
 typedef struct {
 	Std_ReturnType (*get_devcfg_value) (const char* key, uint32 *value);
@@ -19,6 +20,9 @@ typedef struct {
 
 typedef struct {
 	Std_ReturnType (*add_intr) (const char* name, uint32 intno, uint32 priority); //TODO target dependent function
+	/*
+	 * cpu thread only(supply_clock and region operations). use async_intr from other threads.
+	 */
 	void (*raise_intr) (uint32 intno);
 } AthrillExDevIntrOperationType;
 
@@ -84,11 +88,59 @@ typedef struct {
 	void (*get_serial_fifo) (uint32 channel, AthrillSerialFifoType **serial_fifop);
 } AthrillExDevDeviceOperationType;
 
+typedef struct {
+	/*
+	 * must be called after device writes guest memory via get_memory pointer.
+	 */
+	void (*notify_write) (uint32 addr, uint32 size);
+} AthrillExDevMemoryOperationType;
+
+typedef struct {
+	Std_ReturnType (*write) (SnapshotStreamType *stream, const void *data, uint32 size);
+	Std_ReturnType (*read) (SnapshotStreamType *stream, void *data, uint32 size);
+} AthrillExDevSnapshotOperationType;
+
+typedef struct {
+	/*
+	 * can be called from any thread(e.g. device receiver threads).
+	 * interrupt is raised on the next device tick, and clock skip of halted cores is cut.
+	 * returns STD_E_LIMIT if request queue is full.
+	 */
+	Std_ReturnType (*request_intr) (uint32 intno);
+} AthrillExDevAsyncIntrOperationType;
+
+typedef struct {
+	/*
+	 * block transfer between device buffer and guest memory(cpu thread only).
+	 * memory regions are copied at once, device regions are accessed by register operations.
+	 */
+	Std_ReturnType (*read_block) (uint32 addr, uint8 *data, uint32 size);
+	Std_ReturnType (*write_block) (uint32 addr, const uint8 *data, uint32 size);
+	/*
+	 * raise intno after delay_clocks(modeled transfer time, cpu thread only).
+	 * returns STD_E_LIMIT if too many completions are pending.
+	 */
+	Std_ReturnType (*notify_complete) (uint32 intno, uint64 delay_clocks);
+} AthrillExDevDmaOperationType;
+
 typedef struct {
 	AthrillExDevParamOperationType	param;
 	AthrillExDevIntrOperationType	intr;
 	AthrillExDevDeviceOperationType	dev;
 	AthrillExDevLibOperationType	libs;
+	/*
+	 * new operations are added after here to keep compatibility.
+	 */
+	AthrillExDevMemoryOperationType	mem;
+	AthrillExDevSnapshotOperationType	snapshot;
+	/*
+	 * version 5 or later.
+	 */
+	AthrillExDevAsyncIntrOperationType	async_intr;
+	/*
+	 * version 6 or later.
+	 */
+	AthrillExDevDmaOperationType	dma;
 } AthrillExDevOperationType;
 
 extern AthrillExDevOperationType athrill_exdev_operation;
@@ -102,7 +154,28 @@ typedef struct {
 	char *datap;
 	MpuAddressRegionOperationType *ops;
 	void (*devinit) (MpuAddressRegionType *, AthrillExDevOperationType *);
+	/*
+	 * called on each device tick: dev_clock->supply_clocks clocks have elapsed since the previous call.
+	 * version 2 devices are called supply_clocks times with supply_clocks = 1.
+	 */
 	void (*supply_clock) (DeviceClockType *);
+	/*
+	 * version 3 or later(optional, NULL if not supported).
+	 * device state is saved/restored with ops->snapshot.
+	 */
+	Std_ReturnType (*save) (SnapshotStreamType *stream);
+	Std_ReturnType (*restore) (SnapshotStreamType *stream);
+	/*
+	 * version 4 or later(optional, NULL if not supported).
+	 * returns absolute clock when supply_clock must be called next,
+	 * or ATHRILL_EXDEV_NO_EVENT if device has nothing to do until its region is accessed.
+	 * if set, supply_clock is called only when the event is due, or on the next device tick
+	 * after guest accesses the device region, and next_event is called again after each supply_clock.
+	 * dev_clock->supply_clocks is the value of the last device tick: devices must use dev_clock->clock.
+	 * devices driven by host threads must keep returning polling clocks.
+	 */
+	uint64 (*next_event) (DeviceClockType *dev_clock);
 } AthrillExDeviceType;
+#define ATHRILL_EXDEV_NO_EVENT		((uint64)-1)
 
 #endif /* _ATHRILL_EXDEV_H_ */
@@ -2,7 +2,12 @@
 #define _ATHRILL_EXDEV_HEADER_H_
 
 #define ATHRILL_EXTERNAL_DEVICE_MAGICNO		0xBEAFDEAD
-#define ATHRILL_EXTERNAL_DEVICE_VERSION		0x00000002
+#define ATHRILL_EXTERNAL_DEVICE_VERSION		0x00000006
+/*
+ * oldest version which can be loaded.
+ * members added after this version must be checked by header.version.
+ */
+#define ATHRILL_EXTERNAL_DEVICE_VERSION_MIN	0x00000002
 typedef struct {
 	unsigned int magicno; /* ATHRILL_EXTERNAL_DEVICE_MAGICNO */
 	unsigned int version; /* ATHRILL_EXTERNAL_DEVICE_VERSION */
@@ -15,6 +15,11 @@ typedef struct {
  */
 extern Std_ReturnType mpthread_init(void);
 extern Std_ReturnType mpthread_register(MpthrIdType *id, MpthrOperationType *op);
+/*
+ * forked child has no mpthreads: creates all registered threads again.
+ * do_init is called again, and threads keep their status.
+ */
+extern void mpthread_fork_child(void);
 
 /*
  * Thread api
@@ -14,6 +14,9 @@ typedef struct {
 	uint64	intr_clocks;
 	int     core_id_num;
 	uint64  cpu_clocks[CPU_CONFIG_CORE_NUM];
+	uint32	cached_code_page_num;
+	uint32	cached_code_alloc_page_num;
+	uint64	cached_code_alloc_size; /* byte */
 #ifdef OS_LINUX
 	struct timeval elaps_tv;
 #endif /* OS_LINUX */
@@ -31,6 +34,7 @@ extern void cpuemu_get_register(CoreIdType core_id, TargetCoreType *cpu);
 extern void *cpuemu_thread_run(void* arg);
 extern uint64 cpuemu_get_cpu_end_clock(void);
 extern void cpuemu_set_cpu_end_clock(uint64 clock);
+extern uint64 cpuemu_get_total_clocks(void);
 
 
 extern Std_ReturnType cpuemu_set_comm_fifocfg(const char* fifocfg);
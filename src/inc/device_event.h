@@ -0,0 +1,56 @@
+#ifndef _DEVICE_EVENT_H_
+#define _DEVICE_EVENT_H_
+
+#include "std_types.h"
+#include "std_errno.h"
+#include "cpu.h"
+#include "std_device_ops.h"
+
+/*
+ * device event queue.
+ *
+ * devices register the absolute clock of their next event, and the main loop
+ * calls the handler only when the event is due instead of polling on every clock.
+ * events are ordered by a binary min-heap keyed on clock.
+ * must be used on cpu thread only.
+ */
+#define DEVICE_EVENT_INDEX_NONE		((uint32)-1)
+
+typedef struct device_event_type DeviceEventType;
+typedef void (*DeviceEventHandlerType) (DeviceEventType *event, DeviceClockType *dev_clock);
+
+struct device_event_type {
+	/*
+	 * absolute clock of the event.
+	 */
+	uint64					clock;
+	DeviceEventHandlerType	handler;
+	void					*arg;
+	/*
+	 * heap index(DEVICE_EVENT_INDEX_NONE when not queued).
+	 */
+	uint32					index;
+};
+
+extern void device_event_init(DeviceEventType *event, DeviceEventHandlerType handler, void *arg);
+/*
+ * queue event on clock. queued event is moved to the new clock.
+ */
+extern Std_ReturnType device_event_set(DeviceEventType *event, uint64 clock);
+extern void device_event_cancel(DeviceEventType *event);
+/*
+ * returns clock of the first event, or DEVICE_CLOCK_MAX_INTERVAL if no event is queued.
+ */
+extern uint64 device_event_next_clock(void);
+/*
+ * call handlers of events whose clock <= dev_clock->clock.
+ * handler may queue the event again on a later clock.
+ */
+extern void device_event_dispatch(DeviceClockType *dev_clock);
+
+static inline bool device_event_is_set(const DeviceEventType *event)
+{
+	return (event->index != DEVICE_EVENT_INDEX_NONE);
+}
+
+#endif /* _DEVICE_EVENT_H_ */
@@ -0,0 +1,32 @@
+#ifndef _DEVICE_INTR_QUEUE_H_
+#define _DEVICE_INTR_QUEUE_H_
+
+#include "std_types.h"
+#include "std_errno.h"
+
+/*
+ * asynchronous interrupt request queue.
+ *
+ * any host thread can request guest interrupts. requests are raised by the main loop
+ * on the next device tick, that is, at instruction boundary of all cores.
+ * queue is a bounded lock-free MPSC ring: producers never take a lock
+ * unless the main loop sleeps on device_intr_queue_wait().
+ */
+#define DEVICE_INTR_QUEUE_SIZE		256U	/* must be power of 2 */
+
+/*
+ * any thread. returns STD_E_LIMIT if queue is full.
+ */
+extern Std_ReturnType device_intr_queue_request(uint32 intno);
+
+/*
+ * main loop only.
+ */
+extern bool device_intr_queue_is_empty(void);
+extern void device_intr_queue_drain(void);
+/*
+ * sleep at most usec, returns early when an interrupt is requested.
+ */
+extern void device_intr_queue_wait(uint64 usec);
+
+#endif /* _DEVICE_INTR_QUEUE_H_ */
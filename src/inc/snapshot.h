@@ -0,0 +1,69 @@
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include "std_types.h"
+#include "std_errno.h"
+
+/*
+ * machine snapshot.
+ *
+ * snapshot file is a list of named sections. each module registers
+ * save/restore operations of its section, and the section is restored
+ * by the operation which has the same name.
+ * snapshot must be saved/loaded while cores are stopped(cpu thread or debugger).
+ *
+ * file format:
+ *   header  : magic(SNAPSHOT_MAGIC) version(uint32)
+ *   section : name(SNAPSHOT_NAME_LEN) size(uint32) data(size bytes)
+ *   ...
+ *   end     : name("") size(0)
+ */
+#define SNAPSHOT_MAGIC			"ATHRSNAP"
+#define SNAPSHOT_MAGIC_LEN		8U
+#define SNAPSHOT_VERSION		0x00000001
+#define SNAPSHOT_NAME_LEN		32U
+#define SNAPSHOT_SECTION_MAX	64U
+
+typedef struct snapshot_stream_type SnapshotStreamType;
+
+typedef struct {
+	Std_ReturnType (*save) (SnapshotStreamType *stream, void *arg);
+	/*
+	 * must read all data written by save.
+	 */
+	Std_ReturnType (*restore) (SnapshotStreamType *stream, void *arg);
+} SnapshotOperationType;
+
+extern Std_ReturnType snapshot_register(const char *name, const SnapshotOperationType *ops, void *arg);
+
+extern Std_ReturnType snapshot_write(SnapshotStreamType *stream, const void *data, uint32 size);
+extern Std_ReturnType snapshot_read(SnapshotStreamType *stream, void *data, uint32 size);
+
+extern Std_ReturnType snapshot_save(const char *path);
+extern Std_ReturnType snapshot_load(const char *path);
+
+#ifdef OS_LINUX
+/*
+ * fork based checkpoint.
+ *
+ * reads variant names from stdin line by line, and forks a child per line.
+ * child returns from this function with env SNAPSHOT_VARIANT_ENV set to the line,
+ * up to max_jobs children run at once, and parent exits when all children exit after EOF.
+ *
+ * host threads are not copied to the child: before the child returns, fork child
+ * handlers are called in registration order, and then mpthreads are created again.
+ * host fds(fifo, socket) opened before fork are shared with other variants.
+ */
+#define SNAPSHOT_VARIANT_ENV	"ATHRILL_SNAPSHOT_VARIANT"
+extern void snapshot_fork_server(uint32 max_jobs);
+
+/*
+ * fork child handler: recreates per process host resources(helper process, epoll, eventfd).
+ * it is called before mpthreads are created again.
+ */
+#define SNAPSHOT_FORK_CHILD_MAX		16U
+typedef void (*SnapshotForkChildType) (void);
+extern Std_ReturnType snapshot_register_fork_child(SnapshotForkChildType func);
+#endif /* OS_LINUX */
+
+#endif /* _SNAPSHOT_H_ */
@@ -10,6 +10,18 @@ extern void cpu_reset(CoreIdType core_id);
 extern void cpu_illegal_opcode_trap(CoreIdType core_id);
 extern void cpu_set_current_core(CoreIdType core_id);
 extern Std_ReturnType cpu_supply_clock(CoreIdType core_id);
+#ifdef CPU_CONFIG_BLOCK_EXEC_SUPPORT
+/*
+ * provided by targets which define CPU_CONFIG_BLOCK_EXEC_SUPPORT in cpu_config.h.
+ *
+ * execute instructions following the block chain(one instruction per clock).
+ * stops when max_clocks are consumed, when a block ends with a store on device
+ * visible memory, when the core halts, or on error.
+ * consumed clocks(>= 1) are set to clocks.
+ * cpuemu_get_total_clocks() returns the clock of block start while the block runs.
+ */
+extern Std_ReturnType cpu_supply_clock_block(CoreIdType core_id, uint32 max_clocks, uint32 *clocks);
+#endif /* CPU_CONFIG_BLOCK_EXEC_SUPPORT */
 extern bool cpu_is_halt(CoreIdType core_id);
 extern bool cpu_is_halt_all(void);
 extern void cpu_mpu_construct_containers(CoreIdType core_id);
@@ -139,6 +139,12 @@ typedef struct {
 	 * 全デバイス中で次の割り込みが発生するまでの時間の最小値
 	 */
 	uint64 	min_intr_interval;
+	/*
+	 * clocks elapsed since previous device tick(>= 1).
+	 * it is greater than 1 when cores run with clock quantum,
+	 * so devices which count clocks must add this value.
+	 */
+	uint64	supply_clocks;
 } DeviceClockType;
 
 #ifndef ATHRILL_EXT_DEVICE
@@ -154,5 +160,11 @@ extern void device_get_clock(DeviceClockType *dev_clock);
  */
 extern int intc_raise_intr(uint32 intno);
 
+/*
+ * provided by targets which define CPU_CONFIG_DEVICE_SNAPSHOT_SUPPORT in cpu_config.h:
+ * registers snapshot sections of target devices(timer, intc, ...).
+ */
+extern void device_snapshot_register(void);
+
 #endif /* ATHRILL_EXT_DEVICE */
 #endif /* _STD_DEVICE_OPS_H_ */
@@ -1,5 +1,6 @@
 #include "comm_buffer.h"
 #include <stdlib.h>
+#include <string.h>
 
 Std_ReturnType comm_fifo_buffer_create(uint32 size, CommFifoBufferType *fifop)
 {
@@ -17,67 +18,100 @@ Std_ReturnType comm_fifo_buffer_create(uint32 size, CommFifoBufferType *fifop)
 	return STD_E_OK;
 }
 
-static Std_ReturnType fifo_buffer_add(CommFifoBufferType *fifop, char data)
+/*
+ * copy to/from ring at off: wrap around needs at most two copies.
+ */
+static uint32 fifo_buffer_copy_in(CommFifoBufferType *fifop, uint32 off, const char* datap, uint32 len)
 {
-	if (fifop->count >= fifop->max_size) {
-		return STD_E_LIMIT;
+	uint32 first = fifop->max_size - off;
+
+	if (len < first) {
+		memcpy(&fifop->data[off], datap, len);
+		return off + len;
 	}
-	fifop->data[fifop->tx_off] = data;
-	fifop->tx_off++;
-	if (fifop->tx_off >= fifop->max_size) {
-		fifop->tx_off = 0;
+	memcpy(&fifop->data[off], datap, first);
+	memcpy(&fifop->data[0], &datap[first], len - first);
+	return len - first;
+}
+static uint32 fifo_buffer_copy_out(CommFifoBufferType *fifop, uint32 off, char* datap, uint32 len)
+{
+	uint32 first = fifop->max_size - off;
+
+	if (len < first) {
+		memcpy(datap, &fifop->data[off], len);
+		return off + len;
 	}
-	fifop->count++;
-	return STD_E_OK;
+	memcpy(datap, &fifop->data[off], first);
+	memcpy(&datap[first], &fifop->data[0], len - first);
+	return len - first;
 }
 
 Std_ReturnType comm_fifo_buffer_add(CommFifoBufferType *fifop, const char* datap, uint32 datalen, uint32 *res)
 {
-	uint32 i;
-	Std_ReturnType err;
+	uint32 count = __atomic_load_n(&fifop->count, __ATOMIC_ACQUIRE);
+	uint32 len;
 
-	if (fifop->count >= fifop->max_size) {
+	if (count >= fifop->max_size) {
 		return STD_E_LIMIT;
 	}
-	for (i = 0; i < datalen; i++) {
-		err = fifo_buffer_add(fifop, datap[i]);
-		if (err != STD_E_OK) {
-			return err;
-		}
-		(*res) = (*res) + 1;
+	len = fifop->max_size - count;
+	if (datalen < len) {
+		len = datalen;
 	}
-	return STD_E_OK;
+	if (len > 0U) {
+		fifop->tx_off = fifo_buffer_copy_in(fifop, fifop->tx_off, datap, len);
+		(void)__atomic_add_fetch(&fifop->count, len, __ATOMIC_RELEASE);
+		(*res) = (*res) + len;
+	}
+	return (len < datalen) ? STD_E_LIMIT : STD_E_OK;
 }
-static Std_ReturnType fifo_buffer_get(CommFifoBufferType *fifop, char* datap)
+
+Std_ReturnType comm_fifo_buffer_get(CommFifoBufferType *fifop, char* datap, uint32 datalen, uint32 *res)
 {
-	if (fifop->count == 0) {
+	uint32 len = __atomic_load_n(&fifop->count, __ATOMIC_ACQUIRE);
+
+	if (len == 0) {
 		return STD_E_NOENT;
 	}
-	*datap = fifop->data[fifop->rx_off];
-	fifop->rx_off++;
-	if (fifop->rx_off >= fifop->max_size) {
-		fifop->rx_off = 0;
+	if (datalen < len) {
+		len = datalen;
 	}
-	fifop->count--;
-	return STD_E_OK;
+	if (len > 0U) {
+		fifop->rx_off = fifo_buffer_copy_out(fifop, fifop->rx_off, datap, len);
+		(void)__atomic_sub_fetch(&fifop->count, len, __ATOMIC_RELEASE);
+		(*res) = (*res) + len;
+	}
+	return (len < datalen) ? STD_E_NOENT : STD_E_OK;
 }
 
-Std_ReturnType comm_fifo_buffer_get(CommFifoBufferType *fifop, char* datap, uint32 datalen, uint32 *res)
+Std_ReturnType comm_fifo_buffer_peek(CommFifoBufferType *fifop, char* datap, uint32 datalen, uint32 *res)
 {
-	uint32 i;
-	Std_ReturnType err;
+	uint32 len = __atomic_load_n(&fifop->count, __ATOMIC_ACQUIRE);
 
-	if (fifop->count == 0) {
+	if (len == 0) {
 		return STD_E_NOENT;
 	}
-	for (i = 0; i < datalen; i++) {
-		err = fifo_buffer_get(fifop, &datap[i]);
-		if (err != STD_E_OK) {
-			return err;
-		}
-		(*res) = (*res) + 1;
+	if (datalen < len) {
+		len = datalen;
 	}
-	return STD_E_OK;
+	if (len > 0U) {
+		(void)fifo_buffer_copy_out(fifop, fifop->rx_off, datap, len);
+		(*res) = (*res) + len;
+	}
+	return (len < datalen) ? STD_E_NOENT : STD_E_OK;
+}
+
+void comm_fifo_buffer_consume(CommFifoBufferType *fifop, uint32 len)
+{
+	if (len == 0U) {
+		return;
+	}
+	fifop->rx_off += len;
+	if (fifop->rx_off >= fifop->max_size) {
+		fifop->rx_off -= fifop->max_size;
+	}
+	(void)__atomic_sub_fetch(&fifop->count, len, __ATOMIC_RELEASE);
+	return;
 }
 
 void comm_fifo_buffer_close(CommFifoBufferType *fifop)
@@ -4,6 +4,17 @@
 #include "std_types.h"
 #include "std_errno.h"
 
+/*
+ * single producer/single consumer fifo.
+ *
+ * one thread adds and one thread gets concurrently without lock:
+ * producer owns tx_off, consumer owns rx_off, and count is shared by atomics.
+ * data is copied before count is added/subtracted with release,
+ * and count is read with acquire before data is copied.
+ * add/get copy data in bulk, and return partial result with STD_E_LIMIT/STD_E_NOENT.
+ * create/close/destroy and direct update of fields(e.g. snapshot restore)
+ * must be excluded from add/get by the user.
+ */
 typedef struct {
 	uint32	max_size;
 	uint32	count;
@@ -14,11 +25,18 @@ typedef struct {
 extern Std_ReturnType comm_fifo_buffer_create(uint32 size, CommFifoBufferType *fifop);
 extern Std_ReturnType comm_fifo_buffer_add(CommFifoBufferType *fifop, const char* datap, uint32 datalen, uint32 *res);
 extern Std_ReturnType comm_fifo_buffer_get(CommFifoBufferType *fifop, char* datap, uint32 datalen, uint32 *res);
+/*
+ * get split in two steps for consumers which may fail to store data:
+ * peek copies data without removing it, and consume removes len(<= peeked) bytes.
+ */
+extern Std_ReturnType comm_fifo_buffer_peek(CommFifoBufferType *fifop, char* datap, uint32 datalen, uint32 *res);
+extern void comm_fifo_buffer_consume(CommFifoBufferType *fifop, uint32 len);
 extern void comm_fifo_buffer_close(CommFifoBufferType *fifop);
 extern void comm_fifo_buffer_destroy(CommFifoBufferType *fifop);
 
-#define COMM_FIFO_IS_EMPTY(fifop)	((fifop)->count == 0)
-#define COMM_FIFO_IS_FULL(fifop)	((fifop)->count >= (fifop)->max_size)
+#define COMM_FIFO_COUNT(fifop)		__atomic_load_n(&(fifop)->count, __ATOMIC_ACQUIRE)
+#define COMM_FIFO_IS_EMPTY(fifop)	(COMM_FIFO_COUNT(fifop) == 0)
+#define COMM_FIFO_IS_FULL(fifop)	(COMM_FIFO_COUNT(fifop) >= (fifop)->max_size)
 
 typedef struct {
 	uint32	max_size;
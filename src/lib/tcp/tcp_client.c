@@ -1,7 +1,9 @@
 #include "tcp/tcp_client.h"
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <netinet/in.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <stdio.h>
 #include <string.h>
@@ -45,6 +47,117 @@ Std_ReturnType tcp_client_connect(TcpClientType *client)
     return STD_E_OK;
 }
 
+Std_ReturnType tcp_client_connect_unix(const char *path, TcpConnectionType *connection)
+{
+	int ret;
+	struct sockaddr_un addr;
+
+	connection->connected = FALSE;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		printf("%s %s() %u path is too long(%s)\n", __FILE__, __FUNCTION__, __LINE__, path);
+		return STD_E_INVALID;
+	}
+	connection->socket.fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (connection->socket.fd < 0) {
+		printf("%s %s() %u errno=%d\n", __FILE__, __FUNCTION__, __LINE__,  errno);
+		return STD_E_INVALID;
+	}
+
+	memset(&addr, 0, sizeof(struct sockaddr_un));
+	addr.sun_family = AF_UNIX;
+	memcpy(addr.sun_path, path, strlen(path));
+
+	ret = connect(connection->socket.fd, (struct sockaddr*)&addr, sizeof(struct sockaddr_un));
+	if (ret < 0) {
+		printf("%s %s() %u errno=%d\n", __FILE__, __FUNCTION__, __LINE__,  errno);
+		tcp_socket_close(&connection->socket);
+		return STD_E_NOENT;
+	}
+	connection->connected = TRUE;
+	return STD_E_OK;
+}
+
+Std_ReturnType tcp_client_connect_nblk(TcpClientType *client, int *errnum)
+{
+	uint32 ipaddr;
+	int ret;
+	struct sockaddr_in addr;
+
+	*errnum = 0;
+	ret = tcp_inet_get_ipaddr(client->config.ipaddr, &ipaddr);
+	if (ret != STD_E_OK) {
+		return ret;
+	}
+
+	memset(&addr, 0, sizeof(struct sockaddr_in));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(client->config.server_port);
+	addr.sin_addr.s_addr = htonl(ipaddr);
+
+	(void)fcntl(client->connection.socket.fd, F_SETFL, fcntl(client->connection.socket.fd, F_GETFL) | O_NONBLOCK);
+	ret = connect(client->connection.socket.fd, (struct sockaddr*)&addr, sizeof(struct sockaddr_in));
+	if (ret < 0) {
+		if (errno == EINPROGRESS) {
+			return STD_E_OK;
+		}
+		*errnum = errno;
+		return STD_E_NOENT;
+	}
+	client->connection.connected = TRUE;
+	return STD_E_OK;
+}
+
+Std_ReturnType tcp_client_connect_unix_nblk(const char *path, TcpConnectionType *connection, int *errnum)
+{
+	int ret;
+	struct sockaddr_un addr;
+
+	*errnum = 0;
+	connection->connected = FALSE;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		*errnum = ENAMETOOLONG;
+		connection->socket.fd = -1;
+		return STD_E_INVALID;
+	}
+	connection->socket.fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	if (connection->socket.fd < 0) {
+		*errnum = errno;
+		return STD_E_INVALID;
+	}
+
+	memset(&addr, 0, sizeof(struct sockaddr_un));
+	addr.sun_family = AF_UNIX;
+	memcpy(addr.sun_path, path, strlen(path));
+
+	ret = connect(connection->socket.fd, (struct sockaddr*)&addr, sizeof(struct sockaddr_un));
+	if (ret < 0) {
+		if (errno == EINPROGRESS) {
+			return STD_E_OK;
+		}
+		*errnum = errno;
+		tcp_socket_close(&connection->socket);
+		return STD_E_NOENT;
+	}
+	connection->connected = TRUE;
+	return STD_E_OK;
+}
+
+Std_ReturnType tcp_client_connect_result(TcpConnectionType *connection, int *errnum)
+{
+	int value = 0;
+	socklen_t len = sizeof(value);
+
+	if (getsockopt(connection->socket.fd, SOL_SOCKET, SO_ERROR, &value, &len) < 0) {
+		value = errno;
+	}
+	*errnum = value;
+	if (value != 0) {
+		return STD_E_NOENT;
+	}
+	connection->connected = TRUE;
+	return STD_E_OK;
+}
+
 void tcp_client_close(TcpClientType *client)
 {
 	if (client != NULL) {
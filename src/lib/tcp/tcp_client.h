@@ -16,6 +16,16 @@ typedef struct {
 
 extern Std_ReturnType tcp_client_create(const TcpClientConfigType *config, TcpClientType *client);
 extern Std_ReturnType tcp_client_connect(TcpClientType *client);
+extern Std_ReturnType tcp_client_connect_unix(const char *path, TcpConnectionType *connection);
+/*
+ * non-blocking connect: socket is left non-blocking.
+ * connection is connected on return, or completes when the socket is writable:
+ * tcp_client_connect_result() is called then.
+ * errors are not printed, and errno is returned on errnum: caller decides how often it is logged.
+ */
+extern Std_ReturnType tcp_client_connect_nblk(TcpClientType *client, int *errnum);
+extern Std_ReturnType tcp_client_connect_unix_nblk(const char *path, TcpConnectionType *connection, int *errnum);
+extern Std_ReturnType tcp_client_connect_result(TcpConnectionType *connection, int *errnum);
 extern void tcp_client_close(TcpClientType *server);
 
 #endif /* _TCP_CLIENT_H_ */
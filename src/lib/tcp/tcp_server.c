@@ -1,7 +1,10 @@
 #include "tcp/tcp_server.h"
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <netinet/in.h>
+#include <unistd.h>
 #include <errno.h>
 #include <stdio.h>
 #include <string.h>
@@ -9,12 +12,17 @@
 Std_ReturnType tcp_server_create(const TcpServerConfigType *config, TcpServerType *server)
 {
 	int ret;
+	int on = 1;
 	struct sockaddr_in addr;
 
     ret = tcp_socket_open(&server->socket);
     if (ret != STD_E_OK) {
     	return ret;
     }
+    /*
+     * port can be bound again while old connections are in TIME_WAIT.
+     */
+    (void)setsockopt(server->socket.fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
 
     memset(&addr, 0, sizeof(struct sockaddr_in));
     addr.sin_family = AF_INET;
@@ -36,6 +44,74 @@ Std_ReturnType tcp_server_create(const TcpServerConfigType *config, TcpServerTyp
 	return STD_E_OK;
 }
 
+/*
+ * socket file is stale when nobody listens on it: connect is refused.
+ * connect is non-blocking, so a listener with full backlog(EAGAIN) is alive.
+ */
+static bool tcp_server_unix_is_stale(const struct sockaddr_un *addr)
+{
+	int fd;
+	int ret;
+	bool is_stale;
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	if (fd < 0) {
+		return FALSE;
+	}
+	ret = connect(fd, (const struct sockaddr*)addr, sizeof(struct sockaddr_un));
+	is_stale = ((ret < 0) && (errno == ECONNREFUSED));
+	(void)close(fd);
+	return is_stale;
+}
+
+Std_ReturnType tcp_server_create_unix(const char *path, TcpServerType *server)
+{
+	int ret;
+	struct sockaddr_un addr;
+	struct stat st;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		printf("%s %s() %u path is too long(%s)\n", __FILE__, __FUNCTION__, __LINE__, path);
+		return STD_E_INVALID;
+	}
+	server->socket.fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server->socket.fd < 0) {
+		printf("%s %s() %u errno=%d\n", __FILE__, __FUNCTION__, __LINE__,  errno);
+		return STD_E_INVALID;
+	}
+	server->config.server_port = 0;
+
+	memset(&addr, 0, sizeof(struct sockaddr_un));
+	addr.sun_family = AF_UNIX;
+	memcpy(addr.sun_path, path, strlen(path));
+	/*
+	 * only stale socket file is removed: socket of a live listener and other files
+	 * are left to bind error.
+	 */
+	if ((lstat(path, &st) == 0) && S_ISSOCK(st.st_mode)) {
+		if (tcp_server_unix_is_stale(&addr) == TRUE) {
+			(void)unlink(path);
+		}
+		else {
+			printf("%s %s() %u socket is in use(%s)\n", __FILE__, __FUNCTION__, __LINE__, path);
+		}
+	}
+
+	ret = bind(server->socket.fd, (struct sockaddr*)&addr, sizeof(struct sockaddr_un));
+	if (ret < 0) {
+		printf("%s %s() %u errno=%d\n", __FILE__, __FUNCTION__, __LINE__,  errno);
+		tcp_socket_close(&server->socket);
+		return STD_E_NOENT;
+	}
+	ret = listen(server->socket.fd, 10);
+	if (ret < 0) {
+		printf("%s %s() %u errno=%d\n", __FILE__, __FUNCTION__, __LINE__,  errno);
+		tcp_socket_close(&server->socket);
+		return STD_E_NOENT;
+	}
+	return STD_E_OK;
+}
+
 Std_ReturnType tcp_server_accept(const TcpServerType *server, TcpConnectionType *connection)
 {
 	struct sockaddr_in addr;
@@ -14,6 +14,12 @@ typedef struct {
 
 
 extern Std_ReturnType tcp_server_create(const TcpServerConfigType *config, TcpServerType *server);
+/*
+ * unix domain stream socket bound on path: existing socket file is removed only when it is stale
+ * (connect is refused). socket of a live listener and other file types are not removed, and bind fails.
+ * connections are accepted by tcp_server_accept().
+ */
+extern Std_ReturnType tcp_server_create_unix(const char *path, TcpServerType *server);
 extern Std_ReturnType tcp_server_accept(const TcpServerType *server, TcpConnectionType *connection);
 extern void tcp_server_close(TcpServerType *server);
 
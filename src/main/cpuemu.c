@@ -26,8 +26,15 @@
 #include <unistd.h>
 #include "errno.h"
 #include <dlfcn.h>
+#include <pthread.h>
+#include <stdint.h>
 #endif /* OS_LINUX */
 #include "athrill_device.h"
+#include "device_event.h"
+#include "device_intr_queue.h"
+#include "snapshot.h"
+#include "mpu_ops.h"
+#include "mpu_malloc.h"
 #include "assert.h"
 #include "athrill_exdev_header.h"
 
@@ -35,6 +42,8 @@ static DeviceClockType cpuemu_dev_clock;
 std_bool private_cpuemu_is_cui_mode = FALSE;
 static uint64 cpuemu_cpu_end_clock = -1LLU;
 static void cpuemu_env_parse_devcfg_string(TokenStringType* strp);
+static void cpuemu_snapshot_register(void);
+static char *cpuemu_snapshot_restore_path = NULL;
 
 Std_ReturnType cpuemu_symbol_set(void)
 {
@@ -117,7 +126,12 @@ void cpuemu_init(void *(*cpu_run)(void *), void *opt)
 	memset(&cpuemu_dev_clock.elaps_tv, 0, sizeof(struct timeval));
 #endif /* OS_LINUX */
 
+#ifdef OS_LINUX
+	athrill_system_helper_init();
+#endif /* OS_LINUX */
 	cpu_init();
+	cpuemu_snapshot_register();
+	cpuemu_snapshot_restore_path = copt->restore_path;
 	device_init(&virtual_cpu, &cpuemu_dev_clock);
 	cputhr_control_init();
 	cpuctrl_init();
@@ -141,6 +155,16 @@ uint64 cpuemu_get_cpu_end_clock(void)
 {
 	return cpuemu_cpu_end_clock;
 }
+/*
+ * clocks which current core has executed since the last device tick.
+ * devices accessed during a quantum see the clock of the accessing instruction.
+ */
+static __thread uint32 cpuemu_quantum_clock = 0U;
+
+uint64 cpuemu_get_total_clocks(void)
+{
+	return cpuemu_dev_clock.clock + cpuemu_quantum_clock;
+}
 void cpuemu_set_cpu_end_clock(uint64 clock)
 {
 	cpuemu_cpu_end_clock = clock;
@@ -150,6 +174,7 @@ void cpuemu_set_cpu_end_clock(uint64 clock)
 void cpuemu_get_elaps(CpuEmuElapsType *elaps)
 {
 	int core_id;
+	CachedOperationCodeStatType stat;
 	elaps->core_id_num = cpu_config_get_core_id_num();
 	elaps->total_clocks = cpuemu_dev_clock.clock;
 	elaps->intr_clocks = cpuemu_dev_clock.intclock;
@@ -159,6 +184,10 @@ void cpuemu_get_elaps(CpuEmuElapsType *elaps)
 	for (core_id = 0; core_id < elaps->core_id_num; core_id++) {
 		elaps->cpu_clocks[core_id] = virtual_cpu.cores[core_id].elaps;
 	}
+	virtual_cpu_get_cached_code_stat(&stat);
+	elaps->cached_code_page_num = stat.page_num;
+	elaps->cached_code_alloc_page_num = stat.alloc_page_num;
+	elaps->cached_code_alloc_size = stat.alloc_size;
 	return;
 }
 
@@ -268,6 +297,7 @@ static void cpuemu_set_debug_romdata(void)
 				printf("can not set pointer because gl_size(%s:%u) > 4\n", gl_name, size);
 				break;
 			}
+			mpu_address_notify_host_write(addr, size);
 		}
 	}
 	return;
@@ -305,18 +335,141 @@ ProfStatType cpuemu_tool2_prof;
 
 static DbgCpuCallbackFuncEnableType enable_dbg;
 
+/*
+ * block execution(single core and no debugger only).
+ *
+ * target declares CPU_CONFIG_BLOCK_EXEC_SUPPORT in cpu_config.h when it provides
+ * cpu_supply_clock_block(), which stops on device visible stores.
+ * otherwise CPU_CONFIG_BLOCK_EXEC is ignored.
+ */
+#define CPUEMU_BLOCK_EXEC_MAX_CLOCKS	1024U
+static bool cpuemu_enable_block_exec = FALSE;
+
+/*
+ * clocks which cores run between device ticks(no debugger only).
+ * 1 keeps device polling on every clock.
+ */
+static uint32 cpuemu_clock_quantum = 1U;
+static bool cpuemu_enable_multi_thread = FALSE;
+static uint64 cpuemu_dev_last_clock = 0U;
+
+/*
+ * clocks which can be passed without device ticks: cut at next device event,
+ * or at once when an interrupt is requested from host threads.
+ */
+static inline uint64 cpuemu_get_skip_clocks(uint64 clocks)
+{
+	uint64 next_clock = device_event_next_clock();
+
+	if (next_clock <= cpuemu_dev_clock.clock) {
+		return 0U;
+	}
+#ifdef OS_LINUX
+	if (device_intr_queue_is_empty() == FALSE) {
+		return 0U;
+	}
+#endif /* OS_LINUX */
+	if ((next_clock - cpuemu_dev_clock.clock) < clocks) {
+		clocks = next_clock - cpuemu_dev_clock.clock;
+	}
+	return clocks;
+}
+
+/*
+ * clocks which can be executed without device ticks.
+ * device deadline is known only when devices can skip clock.
+ */
+static inline uint32 cpuemu_get_exec_clocks(uint32 max_clocks)
+{
+	uint64 clocks = cpuemu_clock_quantum;
+
+	if ((cpuemu_dev_clock.enable_skip == TRUE) && (cpuemu_dev_clock.can_skip_clock == TRUE)) {
+		if (cpuemu_dev_clock.min_intr_interval > 2U) {
+			clocks = cpuemu_dev_clock.min_intr_interval - 1U;
+		}
+		else {
+			clocks = 1U;
+		}
+	}
+	if (clocks > max_clocks) {
+		clocks = max_clocks;
+	}
+	clocks = cpuemu_get_skip_clocks(clocks);
+	/*
+	 * keep -t timeout exact.
+	 */
+	if ((cpuemu_cpu_end_clock - cpuemu_dev_clock.clock) < clocks) {
+		clocks = cpuemu_cpu_end_clock - cpuemu_dev_clock.clock;
+	}
+	if (clocks == 0U) {
+		clocks = 1U;
+	}
+	return (uint32)clocks;
+}
+
+/*
+ * quantum of clocks is executed: advance device clock.
+ * the last clock is counted by device_supply_clock() on the next device tick,
+ * or by main loop on CPUEMU_CLOCK_BUG_FIX.
+ */
+static inline void cpuemu_quantum_done(uint32 clocks)
+{
+	cpuemu_quantum_clock = 0U;
+	cpuemu_dev_clock.clock += (clocks - 1U);
+	return;
+}
+
+/*
+ * interval to the next device interrupt from current clock.
+ * min_intr_interval is counted from the last device tick, and the quantum
+ * has consumed clocks after the tick.
+ */
+static inline uint64 cpuemu_get_intr_interval(void)
+{
+	uint64 used = cpuemu_dev_clock.clock - cpuemu_dev_last_clock;
+
+	if (cpuemu_dev_clock.min_intr_interval == DEVICE_CLOCK_MAX_INTERVAL) {
+		return DEVICE_CLOCK_MAX_INTERVAL;
+	}
+	if (cpuemu_dev_clock.min_intr_interval <= used) {
+		return 0U;
+	}
+	return cpuemu_dev_clock.min_intr_interval - used;
+}
+
+static inline void cpuemu_device_supply_clock(void)
+{
+	/*
+	 * clocks elapsed since last device tick.
+	 */
+	cpuemu_dev_clock.supply_clocks = cpuemu_dev_clock.clock - cpuemu_dev_last_clock;
+	if (cpuemu_dev_clock.supply_clocks == 0U) {
+		cpuemu_dev_clock.supply_clocks = 1U;
+	}
+	cpuemu_dev_last_clock = cpuemu_dev_clock.clock;
+#ifdef OS_LINUX
+	device_intr_queue_drain();
+#endif /* OS_LINUX */
+	device_event_dispatch(&cpuemu_dev_clock);
+#ifdef OS_LINUX
+	device_supply_clock_athrill_device();
+#endif /* OS_LINUX */
+	device_supply_clock(&cpuemu_dev_clock);
+	return;
+}
+
 static inline bool cpuemu_thread_run_nodbg(int core_id_num)
 {
 	bool is_halt;
 	CoreIdType i;
+	uint32 clock;
+	uint32 clocks;
 	Std_ReturnType err;
 	/**
 	 * デバイス実行実行
 	 */
-#ifdef OS_LINUX
-	device_supply_clock_athrill_device();
-#endif /* OS_LINUX */
-	device_supply_clock(&cpuemu_dev_clock);
+	cpuemu_device_supply_clock();
+	clocks = cpuemu_get_exec_clocks(cpuemu_clock_quantum);
 
 	/**
 	 * CPU 実行
@@ -324,26 +477,283 @@ static inline bool cpuemu_thread_run_nodbg(int core_id_num)
 	is_halt = TRUE;
 	for (i = 0; i < core_id_num; i++) {
 		virtual_cpu.current_core = &virtual_cpu.cores[i];
+		for (clock = 0; clock < clocks; clock++) {
+			cpuemu_quantum_clock = clock;
+			/**
+			 * CPU 実行開始通知
+			 */
+			dbg_cpu_callback_start_nodbg(cpu_get_pc(&virtual_cpu.cores[i].core), cpu_get_sp(&virtual_cpu.cores[i].core));
+
+			err = cpu_supply_clock(i);
+			if ((err != STD_E_OK) && (cpu_illegal_access(i) == FALSE)) {
+				printf("CPU(pc=0x%x) Exception!!\n", cpu_get_pc(&virtual_cpu.cores[i].core));
+				fflush(stdout);
+				exit(1);
+			}
+			/*
+			 * halted core waits for interrupt raised by device tick.
+			 */
+			if (virtual_cpu.cores[i].core.is_halt == TRUE) {
+				break;
+			}
+		}
 		/**
-		 * CPU 実行開始通知
+		 * CPU 実行完了通知
 		 */
-		dbg_cpu_callback_start_nodbg(cpu_get_pc(&virtual_cpu.cores[i].core), cpu_get_sp(&virtual_cpu.cores[i].core));
+		if (virtual_cpu.cores[i].core.is_halt != TRUE) {
+			is_halt = FALSE;
+		}
+	}
+	cpuemu_quantum_done(clocks);
+	return is_halt;
+}
+#ifdef CPU_CONFIG_BLOCK_EXEC_SUPPORT
+static inline bool cpuemu_thread_run_nodbg_block(int core_id_num)
+{
+	uint32 clocks = 1U;
+	uint32 max_clocks = CPUEMU_BLOCK_EXEC_MAX_CLOCKS;
+	Std_ReturnType err;
+	CpuCoreType *core = &virtual_cpu.cores[CPU_CONFIG_CORE_ID_0];
+	(void)core_id_num;
+	/**
+	 * デバイス実行実行
+	 */
+	cpuemu_device_supply_clock();
 
-		err = cpu_supply_clock(i);
-		if ((err != STD_E_OK) && (cpu_illegal_access(i) == FALSE)) {
-			printf("CPU(pc=0x%x) Exception!!\n", cpu_get_pc(&virtual_cpu.cores[i].core));
-			fflush(stdout);
+	/**
+	 * CPU 実行
+	 */
+	virtual_cpu.current_core = core;
+	dbg_cpu_callback_start_nodbg(cpu_get_pc(&core->core), cpu_get_sp(&core->core));
+	if (core->core.is_halt == TRUE) {
+		err = cpu_supply_clock(CPU_CONFIG_CORE_ID_0);
+	}
+	else {
+		if (cpuemu_clock_quantum > max_clocks) {
+			max_clocks = cpuemu_clock_quantum;
+		}
+		err = cpu_supply_clock_block(CPU_CONFIG_CORE_ID_0, cpuemu_get_exec_clocks(max_clocks), &clocks);
+	}
+	if ((err != STD_E_OK) && (cpu_illegal_access(CPU_CONFIG_CORE_ID_0) == FALSE)) {
+		printf("CPU(pc=0x%x) Exception!!\n", cpu_get_pc(&core->core));
+		fflush(stdout);
+		exit(1);
+	}
+	cpuemu_quantum_done(clocks);
+	return (core->core.is_halt == TRUE);
+}
+#endif /* CPU_CONFIG_BLOCK_EXEC_SUPPORT */
+/*
+ * multi-thread execution(no debugger and multi core only).
+ *
+ * each core runs on its own host thread, and cores are synchronized
+ * at every quantum by barriers: devices are ticked by cpuemu thread
+ * while cores wait on the barrier.
+ * device accesses and shared state updates during the quantum are done
+ * in the exclusive section, which stops other cores at instruction boundary.
+ *
+ * target declares CPU_CONFIG_MULTI_THREAD_SUPPORT in cpu_config.h when:
+ * - cpu_supply_clock(core_id) uses virtual_cpu_get_current_core() instead of virtual_cpu.current_core.
+ * - guest atomic read-modify-write instructions are done in the exclusive section.
+ * otherwise CPU_CONFIG_MULTI_THREAD is ignored.
+ */
+__thread CpuCoreType *virtual_cpu_thread_core = NULL;
+
+#if defined(OS_LINUX) && defined(CPU_CONFIG_MULTI_THREAD_SUPPORT)
+#define CPUEMU_MT_ENABLE
+#endif
+
+#ifdef CPUEMU_MT_ENABLE
+typedef struct {
+	bool				enable;
+	pthread_t			thread[CPU_CONFIG_CORE_NUM];
+	pthread_barrier_t	start_barrier;
+	pthread_barrier_t	end_barrier;
+	pthread_mutex_t		mutex;
+	pthread_cond_t		cond;
+	/*
+	 * number of cores which are running instructions in the quantum.
+	 */
+	uint32				running_num;
+	/*
+	 * read by cores without lock at every instruction.
+	 */
+	volatile bool		exclusive_req;
+	uint32				clocks;
+} CpuEmuMtType;
+
+static CpuEmuMtType cpuemu_mt = {
+		.enable = FALSE,
+		.mutex = PTHREAD_MUTEX_INITIALIZER,
+		.cond = PTHREAD_COND_INITIALIZER,
+};
+static __thread uint32 cpuemu_mt_exclusive_nest = 0U;
+
+/*
+ * mutex must be locked.
+ */
+static void cpuemu_mt_wait_exclusive(void)
+{
+	cpuemu_mt.running_num--;
+	(void)pthread_cond_broadcast(&cpuemu_mt.cond);
+	while (cpuemu_mt.exclusive_req == TRUE) {
+		(void)pthread_cond_wait(&cpuemu_mt.cond, &cpuemu_mt.mutex);
+	}
+	cpuemu_mt.running_num++;
+	return;
+}
+
+static inline void cpuemu_mt_safepoint(void)
+{
+	if (cpuemu_mt.exclusive_req == FALSE) {
+		return;
+	}
+	(void)pthread_mutex_lock(&cpuemu_mt.mutex);
+	if (cpuemu_mt.exclusive_req == TRUE) {
+		cpuemu_mt_wait_exclusive();
+	}
+	(void)pthread_mutex_unlock(&cpuemu_mt.mutex);
+	return;
+}
+
+void cpuemu_mt_exclusive_enter(void)
+{
+	if ((cpuemu_mt.enable == FALSE) || (virtual_cpu_thread_core == NULL)) {
+		return;
+	}
+	if (cpuemu_mt_exclusive_nest > 0U) {
+		cpuemu_mt_exclusive_nest++;
+		return;
+	}
+	(void)pthread_mutex_lock(&cpuemu_mt.mutex);
+	while (cpuemu_mt.exclusive_req == TRUE) {
+		cpuemu_mt_wait_exclusive();
+	}
+	cpuemu_mt.exclusive_req = TRUE;
+	cpuemu_mt.running_num--;
+	while (cpuemu_mt.running_num > 0U) {
+		(void)pthread_cond_wait(&cpuemu_mt.cond, &cpuemu_mt.mutex);
+	}
+	(void)pthread_mutex_unlock(&cpuemu_mt.mutex);
+	cpuemu_mt_exclusive_nest = 1U;
+	return;
+}
+
+void cpuemu_mt_exclusive_leave(void)
+{
+	if (cpuemu_mt_exclusive_nest == 0U) {
+		return;
+	}
+	cpuemu_mt_exclusive_nest--;
+	if (cpuemu_mt_exclusive_nest > 0U) {
+		return;
+	}
+	(void)pthread_mutex_lock(&cpuemu_mt.mutex);
+	cpuemu_mt.exclusive_req = FALSE;
+	cpuemu_mt.running_num++;
+	(void)pthread_cond_broadcast(&cpuemu_mt.cond);
+	(void)pthread_mutex_unlock(&cpuemu_mt.mutex);
+	return;
+}
+
+static void *cpuemu_mt_core_run(void *arg)
+{
+	CoreIdType core_id = (CoreIdType)((uintptr_t)arg);
+	CpuCoreType *core = &virtual_cpu.cores[core_id];
+	uint32 clock;
+	Std_ReturnType err;
+
+	virtual_cpu_thread_core = core;
+	while (TRUE) {
+		(void)pthread_barrier_wait(&cpuemu_mt.start_barrier);
+		for (clock = 0; clock < cpuemu_mt.clocks; clock++) {
+			cpuemu_quantum_clock = clock;
+			cpuemu_mt_safepoint();
+			err = cpu_supply_clock(core_id);
+			if ((err != STD_E_OK) && (cpu_illegal_access(core_id) == FALSE)) {
+				printf("CPU(pc=0x%x) Exception!!\n", cpu_get_pc(&core->core));
+				fflush(stdout);
+				exit(1);
+			}
+			/*
+			 * halted core waits for interrupt raised by device tick.
+			 */
+			if (core->core.is_halt == TRUE) {
+				break;
+			}
+		}
+		cpuemu_quantum_clock = 0U;
+		(void)pthread_mutex_lock(&cpuemu_mt.mutex);
+		cpuemu_mt.running_num--;
+		(void)pthread_cond_broadcast(&cpuemu_mt.cond);
+		(void)pthread_mutex_unlock(&cpuemu_mt.mutex);
+		(void)pthread_barrier_wait(&cpuemu_mt.end_barrier);
+	}
+	return NULL;
+}
+
+static Std_ReturnType cpuemu_mt_init(int core_id_num)
+{
+	int i;
+	int err;
+
+	err = pthread_barrier_init(&cpuemu_mt.start_barrier, NULL, core_id_num + 1);
+	if (err != 0) {
+		printf("ERROR: can not create barrier err=%d\n", err);
+		return STD_E_INVALID;
+	}
+	err = pthread_barrier_init(&cpuemu_mt.end_barrier, NULL, core_id_num + 1);
+	if (err != 0) {
+		printf("ERROR: can not create barrier err=%d\n", err);
+		return STD_E_INVALID;
+	}
+	cpuemu_mt.enable = TRUE;
+	for (i = 0; i < core_id_num; i++) {
+		err = pthread_create(&cpuemu_mt.thread[i], NULL, cpuemu_mt_core_run, (void*)((uintptr_t)i));
+		if (err != 0) {
+			printf("ERROR: can not create core thread err=%d\n", err);
 			exit(1);
 		}
-		/**
-		 * CPU 実行完了通知
-		 */
+	}
+	return STD_E_OK;
+}
+
+static inline bool cpuemu_thread_run_nodbg_mt(int core_id_num)
+{
+	bool is_halt;
+	CoreIdType i;
+	/**
+	 * デバイス実行実行
+	 */
+	cpuemu_device_supply_clock();
+	cpuemu_mt.clocks = cpuemu_get_exec_clocks(cpuemu_clock_quantum);
+	cpuemu_mt.running_num = (uint32)core_id_num;
+
+	/**
+	 * CPU 実行
+	 */
+	(void)pthread_barrier_wait(&cpuemu_mt.start_barrier);
+	(void)pthread_barrier_wait(&cpuemu_mt.end_barrier);
+
+	is_halt = TRUE;
+	for (i = 0; i < core_id_num; i++) {
 		if (virtual_cpu.cores[i].core.is_halt != TRUE) {
 			is_halt = FALSE;
 		}
 	}
+	cpuemu_quantum_done(cpuemu_mt.clocks);
 	return is_halt;
 }
+#else
+void cpuemu_mt_exclusive_enter(void)
+{
+	return;
+}
+void cpuemu_mt_exclusive_leave(void)
+{
+	return;
+}
+#endif /* CPUEMU_MT_ENABLE */
 static inline bool cpuemu_thread_run_dbg(int core_id_num)
 {
 	bool is_halt;
@@ -359,10 +769,7 @@ static inline bool cpuemu_thread_run_dbg(int core_id_num)
 	 * デバイス実行実行
 	 */
 	CPUEMU_DEV_TOTAL_PROF_START();
-#ifdef OS_LINUX
-	device_supply_clock_athrill_device();
-#endif /* OS_LINUX */
-	device_supply_clock(&cpuemu_dev_clock);
+	cpuemu_device_supply_clock();
 	CPUEMU_DEV_TOTAL_PROF_END();
 
 	/**
@@ -377,7 +784,7 @@ static inline bool cpuemu_thread_run_dbg(int core_id_num)
 		 * バスのアクセスログをクリアする
 		 */
 		CPUEMU_DBG_TOTAL_PROF_START(0);
-		bus_access_set_log(BUS_ACCESS_TYPE_NONE, 8U, 0, 0);
+		bus_access_set_log(i, BUS_ACCESS_TYPE_NONE, 8U, 0, 0);
 		CPUEMU_DBG_TOTAL_PROF_END(0);
 
 		/**
@@ -414,11 +821,204 @@ static inline bool cpuemu_thread_run_dbg(int core_id_num)
 	return is_halt;
 }
 
+/*
+ * snapshot sections of cpu and clock.
+ * decoded code cache is not saved: it is rebuilt after restore.
+ */
+static Std_ReturnType cpuemu_snapshot_save_cpu(SnapshotStreamType *stream, void *arg)
+{
+	CoreIdType i;
+	Std_ReturnType err;
+	uint32 core_size = sizeof(TargetCoreType);
+
+	err = snapshot_write(stream, &virtual_cpu.core_id_num, sizeof(virtual_cpu.core_id_num));
+	if (err == STD_E_OK) {
+		err = snapshot_write(stream, &core_size, sizeof(core_size));
+	}
+	for (i = 0; (err == STD_E_OK) && (i < virtual_cpu.core_id_num); i++) {
+		err = snapshot_write(stream, &virtual_cpu.cores[i].core, sizeof(TargetCoreType));
+		if (err == STD_E_OK) {
+			err = snapshot_write(stream, &virtual_cpu.cores[i].elaps, sizeof(virtual_cpu.cores[i].elaps));
+		}
+	}
+	return err;
+}
+static Std_ReturnType cpuemu_snapshot_restore_cpu(SnapshotStreamType *stream, void *arg)
+{
+	CoreIdType i;
+	Std_ReturnType err;
+	uint32 core_id_num;
+	uint32 core_size;
+
+	err = snapshot_read(stream, &core_id_num, sizeof(core_id_num));
+	if (err == STD_E_OK) {
+		err = snapshot_read(stream, &core_size, sizeof(core_size));
+	}
+	if ((err != STD_E_OK) || (core_id_num != virtual_cpu.core_id_num) || (core_size != sizeof(TargetCoreType))) {
+		printf("ERROR: snapshot cpu(core_id_num=%u) is not matched\n", core_id_num);
+		return STD_E_INVALID;
+	}
+	for (i = 0; (err == STD_E_OK) && (i < virtual_cpu.core_id_num); i++) {
+		err = snapshot_read(stream, &virtual_cpu.cores[i].core, sizeof(TargetCoreType));
+		if (err == STD_E_OK) {
+			err = snapshot_read(stream, &virtual_cpu.cores[i].elaps, sizeof(virtual_cpu.cores[i].elaps));
+		}
+		virtual_cpu.cores[i].last_cached_code = NULL;
+	}
+	return err;
+}
+static const SnapshotOperationType cpuemu_snapshot_cpu_operation = {
+	.save = cpuemu_snapshot_save_cpu,
+	.restore = cpuemu_snapshot_restore_cpu,
+};
+
+typedef struct {
+	uint64	clock;
+	uint64	intclock;
+	uint64	min_intr_interval;
+	uint64	supply_clocks;
+	uint64	last_clock;
+	uint32	can_skip_clock;
+} CpuEmuSnapshotClockType;
+static Std_ReturnType cpuemu_snapshot_save_clock(SnapshotStreamType *stream, void *arg)
+{
+	CpuEmuSnapshotClockType clock;
+
+	memset(&clock, 0, sizeof(clock));
+	clock.clock = cpuemu_dev_clock.clock;
+	clock.intclock = cpuemu_dev_clock.intclock;
+	clock.min_intr_interval = cpuemu_dev_clock.min_intr_interval;
+	clock.supply_clocks = cpuemu_dev_clock.supply_clocks;
+	clock.last_clock = cpuemu_dev_last_clock;
+	clock.can_skip_clock = cpuemu_dev_clock.can_skip_clock;
+	return snapshot_write(stream, &clock, sizeof(clock));
+}
+static Std_ReturnType cpuemu_snapshot_restore_clock(SnapshotStreamType *stream, void *arg)
+{
+	Std_ReturnType err;
+	CpuEmuSnapshotClockType clock;
+
+	err = snapshot_read(stream, &clock, sizeof(clock));
+	if (err != STD_E_OK) {
+		return err;
+	}
+	cpuemu_dev_clock.clock = clock.clock;
+	cpuemu_dev_clock.intclock = clock.intclock;
+	cpuemu_dev_clock.min_intr_interval = clock.min_intr_interval;
+	cpuemu_dev_clock.supply_clocks = clock.supply_clocks;
+	cpuemu_dev_last_clock = clock.last_clock;
+	cpuemu_dev_clock.can_skip_clock = clock.can_skip_clock;
+	return STD_E_OK;
+}
+static const SnapshotOperationType cpuemu_snapshot_clock_operation = {
+	.save = cpuemu_snapshot_save_clock,
+	.restore = cpuemu_snapshot_restore_clock,
+};
+
+/*
+ * athrill devices register their sections on device_init().
+ * target devices(timer, intc, ...) are registered by device_snapshot_register() if supported.
+ */
+static void cpuemu_snapshot_register(void)
+{
+	(void)snapshot_register("cpu", &cpuemu_snapshot_cpu_operation, NULL);
+	(void)snapshot_register("clock", &cpuemu_snapshot_clock_operation, NULL);
+	(void)snapshot_register("mpu", &mpu_address_snapshot_operation, NULL);
+	(void)snapshot_register("mpu_malloc", &mpu_malloc_snapshot_operation, NULL);
+#ifdef CPU_CONFIG_DEVICE_SNAPSHOT_SUPPORT
+	device_snapshot_register();
+#endif /* CPU_CONFIG_DEVICE_SNAPSHOT_SUPPORT */
+	return;
+}
+static void cpuemu_snapshot_check_target(void)
+{
+#ifndef CPU_CONFIG_DEVICE_SNAPSHOT_SUPPORT
+	printf("WARNING: target device state(timer, intc) is not saved in snapshot\n");
+#endif /* CPU_CONFIG_DEVICE_SNAPSHOT_SUPPORT */
+	return;
+}
+
+/*
+ * snapshot point(devcfg):
+ *   DEBUG_FUNC_SNAPSHOT_SYMBOL: snapshot is taken when a core reaches the function.
+ *   DEBUG_FUNC_SNAPSHOT_PATH  : snapshot file.
+ *   DEBUG_FUNC_SNAPSHOT_FORK  : fork variants from stdin on the snapshot point
+ *                               (or just after --restore when no symbol is set).
+ *   DEBUG_FUNC_SNAPSHOT_FORK_JOBS: variants which run at once(default: online host cpus).
+ * cores run clock by clock until the snapshot point, so the pc is not passed over.
+ */
+typedef struct {
+	bool	is_armed;
+	uint32	addr;
+	char	*path;
+	bool	enable_fork;
+	uint32	fork_jobs;
+	uint32	clock_quantum;
+} CpuEmuSnapshotPointType;
+static CpuEmuSnapshotPointType cpuemu_snapshot_point;
+
+static void cpuemu_snapshot_point_init(void)
+{
+	char *symbol = NULL;
+	uint32 size;
+
+	cpuemu_snapshot_point.is_armed = FALSE;
+	cpuemu_snapshot_point.path = NULL;
+	cpuemu_snapshot_point.enable_fork = FALSE;
+	(void)cpuemu_get_devcfg_string("DEBUG_FUNC_SNAPSHOT_PATH", &cpuemu_snapshot_point.path);
+	(void)cpuemu_get_devcfg_value("DEBUG_FUNC_SNAPSHOT_FORK", (uint32*)&cpuemu_snapshot_point.enable_fork);
+#ifdef OS_LINUX
+	cpuemu_snapshot_point.fork_jobs = (uint32)sysconf(_SC_NPROCESSORS_ONLN);
+	(void)cpuemu_get_devcfg_value("DEBUG_FUNC_SNAPSHOT_FORK_JOBS", &cpuemu_snapshot_point.fork_jobs);
+#endif /* OS_LINUX */
+	if (cpuemu_get_devcfg_string("DEBUG_FUNC_SNAPSHOT_SYMBOL", &symbol) != STD_E_OK) {
+		return;
+	}
+	if (symbol_get_func(symbol, strlen(symbol), &cpuemu_snapshot_point.addr, &size) < 0) {
+		printf("WARNING: DEBUG_FUNC_SNAPSHOT_SYMBOL %s is not found\n", symbol);
+		return;
+	}
+	printf("DEBUG_FUNC_SNAPSHOT_SYMBOL=%s(0x%x)\n", symbol, cpuemu_snapshot_point.addr);
+	cpuemu_snapshot_point.is_armed = TRUE;
+	cpuemu_snapshot_point.clock_quantum = cpuemu_clock_quantum;
+	cpuemu_clock_quantum = 1U;
+	return;
+}
+
+static bool cpuemu_snapshot_point_is_hit(int core_id_num)
+{
+	CoreIdType i;
+
+	for (i = 0; i < core_id_num; i++) {
+		if (cpu_get_pc(&virtual_cpu.cores[i].core) == cpuemu_snapshot_point.addr) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static void cpuemu_snapshot_point_take(void)
+{
+	cpuemu_snapshot_check_target();
+	if (cpuemu_snapshot_point.path != NULL) {
+		if (snapshot_save(cpuemu_snapshot_point.path) != STD_E_OK) {
+			exit(1);
+		}
+	}
+#ifdef OS_LINUX
+	if (cpuemu_snapshot_point.enable_fork != FALSE) {
+		snapshot_fork_server(cpuemu_snapshot_point.fork_jobs);
+	}
+#endif /* OS_LINUX */
+	return;
+}
+
 void *cpuemu_thread_run(void* arg)
 {
 	bool is_halt;
 	int core_id_num = cpu_config_get_core_id_num();
 	static bool (*do_cpu_run) (int);
+	bool (*run_after_snapshot) (int);
 	int core_id;
 
 	enable_dbg.enable_bt = TRUE;
@@ -444,14 +1044,66 @@ void *cpuemu_thread_run(void* arg)
 	(void)cpuemu_get_devcfg_value("DEVICE_CPU_FREQ", &virtual_cpu.cpu_freq);
 
 	(void)cpuemu_get_devcfg_value("DEBUG_FUNC_ENABLE_SKIP_CLOCK", (uint32*)&cpuemu_dev_clock.enable_skip);
+	(void)cpuemu_get_devcfg_value("CPU_CONFIG_BLOCK_EXEC", (uint32*)&cpuemu_enable_block_exec);
+	(void)cpuemu_get_devcfg_value("DEVICE_CONFIG_CLOCK_QUANTUM", &cpuemu_clock_quantum);
+	(void)cpuemu_get_devcfg_value("CPU_CONFIG_MULTI_THREAD", (uint32*)&cpuemu_enable_multi_thread);
+	if (cpuemu_clock_quantum == 0U) {
+		cpuemu_clock_quantum = 1U;
+	}
 	cpuemu_set_debug_romdata();
+	cpuemu_snapshot_point_init();
+	if (cpuemu_snapshot_point.enable_fork != FALSE) {
+		/*
+		 * core threads are not copied to forked variants.
+		 */
+		cpuemu_enable_multi_thread = FALSE;
+	}
+#ifndef CPUEMU_MT_ENABLE
+	if (cpuemu_enable_multi_thread != FALSE) {
+		printf("WARNING: CPU_CONFIG_MULTI_THREAD is not supported by this target\n");
+		cpuemu_enable_multi_thread = FALSE;
+	}
+#endif /* CPUEMU_MT_ENABLE */
+#ifndef CPU_CONFIG_BLOCK_EXEC_SUPPORT
+	if (cpuemu_enable_block_exec != FALSE) {
+		printf("WARNING: CPU_CONFIG_BLOCK_EXEC is not supported by this target\n");
+		cpuemu_enable_block_exec = FALSE;
+	}
+#endif /* CPU_CONFIG_BLOCK_EXEC_SUPPORT */
 
 	if (cpuemu_cui_mode() == TRUE) {
 		do_cpu_run = cpuemu_thread_run_dbg;
 	}
+#ifdef CPU_CONFIG_BLOCK_EXEC_SUPPORT
+	else if ((cpuemu_enable_block_exec != FALSE) && (core_id_num == 1)) {
+		do_cpu_run = cpuemu_thread_run_nodbg_block;
+	}
+#endif /* CPU_CONFIG_BLOCK_EXEC_SUPPORT */
+#ifdef CPUEMU_MT_ENABLE
+	else if ((cpuemu_enable_multi_thread != FALSE) && (core_id_num > 1) &&
+			(cpuemu_mt_init(core_id_num) == STD_E_OK)) {
+		do_cpu_run = cpuemu_thread_run_nodbg_mt;
+	}
+#endif /* CPUEMU_MT_ENABLE */
 	else {
 		do_cpu_run = cpuemu_thread_run_nodbg;
 	}
+	run_after_snapshot = do_cpu_run;
+	if ((cpuemu_snapshot_point.is_armed == TRUE) && (cpuemu_cui_mode() == FALSE)) {
+		do_cpu_run = cpuemu_thread_run_nodbg;
+	}
+
+	if (cpuemu_snapshot_restore_path != NULL) {
+		cpuemu_snapshot_check_target();
+		if (snapshot_load(cpuemu_snapshot_restore_path) != STD_E_OK) {
+			exit(1);
+		}
+#ifdef OS_LINUX
+		if ((cpuemu_snapshot_point.is_armed == FALSE) && (cpuemu_snapshot_point.enable_fork != FALSE)) {
+			snapshot_fork_server(cpuemu_snapshot_point.fork_jobs);
+		}
+#endif /* OS_LINUX */
+	}
 	uint64 end_clock = cpuemu_get_cpu_end_clock();
 	uint64 *clockp = &cpuemu_dev_clock.clock;
 	bool enable_skip = cpuemu_dev_clock.enable_skip;
@@ -463,16 +1115,23 @@ void *cpuemu_thread_run(void* arg)
 			printf("EXIT for timeout("PRINT_FMT_UINT64").\n", cpuemu_dev_clock.clock);
 			exit(1);
 		}
+		if ((cpuemu_snapshot_point.is_armed == TRUE) && (cpuemu_snapshot_point_is_hit(core_id_num) == TRUE)) {
+			cpuemu_snapshot_point.is_armed = FALSE;
+			cpuemu_clock_quantum = cpuemu_snapshot_point.clock_quantum;
+			do_cpu_run = run_after_snapshot;
+			cpuemu_snapshot_point_take();
+		}
 		is_halt = do_cpu_run(core_id_num);
 
 		if (enable_skip == TRUE) {
 			if ((is_halt == TRUE) && (cpuemu_dev_clock.can_skip_clock == TRUE)) {
+				uint64 intr_interval = cpuemu_get_intr_interval();
 #ifdef OS_LINUX
 				uint64 skipc_usec = 0;
-				if (enable_dbg.enable_sync_time > 0) {
-					skipc_usec = ( (cpuemu_dev_clock.min_intr_interval - 1) / virtual_cpu.cpu_freq );
+				if ((enable_dbg.enable_sync_time > 0) && (intr_interval > 0U)) {
+					skipc_usec = ( (intr_interval - 1) / virtual_cpu.cpu_freq );
 					if (skipc_usec > ((uint64)enable_dbg.enable_sync_time)) {
-						(void)usleep((useconds_t)(skipc_usec - ((uint64)enable_dbg.enable_sync_time)));
+						device_intr_queue_wait(skipc_usec - ((uint64)enable_dbg.enable_sync_time));
 					}
 				}
 				if (enable_dbg.show_skip_time != 0) {
@@ -490,12 +1149,12 @@ void *cpuemu_thread_run(void* arg)
 				}
 #endif /* OS_LINUX */
 #ifndef CPUEMU_CLOCK_BUG_FIX
-				if (cpuemu_dev_clock.min_intr_interval > 2U) {
-					cpuemu_dev_clock.clock += (cpuemu_dev_clock.min_intr_interval - 1);
+				if (intr_interval > 2U) {
+					cpuemu_dev_clock.clock += cpuemu_get_skip_clocks(intr_interval - 1);
 				}
 #else
-				if (cpuemu_dev_clock.min_intr_interval != DEVICE_CLOCK_MAX_INTERVAL) {
-					cpuemu_dev_clock.clock += (cpuemu_dev_clock.min_intr_interval);
+				if (intr_interval != DEVICE_CLOCK_MAX_INTERVAL) {
+					cpuemu_dev_clock.clock += cpuemu_get_skip_clocks(intr_interval);
 				}
 #endif /* CPUEMU_CLOCK_BUG_FIX */
 				else {
@@ -905,7 +1564,8 @@ Std_ReturnType cpuemu_load_memmap(const char *path, MemoryAddressMapType *map)
 				printf("ERROR: magicno is invalid(0x%x) on %s\n", ext_dev_headr->magicno, filepath);
 				continue;
 			}
-			if (ext_dev_headr->version != ATHRILL_EXTERNAL_DEVICE_VERSION) {
+			if ((ext_dev_headr->version < ATHRILL_EXTERNAL_DEVICE_VERSION_MIN) ||
+					(ext_dev_headr->version > ATHRILL_EXTERNAL_DEVICE_VERSION)) {
 				printf("ERROR: version is invalid(0x%x) on %s\n", ext_dev_headr->version, filepath);
 				continue;
 			}
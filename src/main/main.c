@@ -150,6 +150,7 @@ int main(int argc, const char *argv[])
 		printf(" %-30s : set athrill memory configuration. rom, ram region is configured on your system.\n", "-m<memory config file>");
 		//printf(" %-30s : set communication path with an another emulator.\n", "-p<fifo config file>");
 		printf(" %-30s : set device parameter.\n", "-d<device config file>");
+		printf(" %-30s : restore machine state from <snapshot file> before execution.\n", "--restore <snapshot file>");
 		return -11;
 	}
 
@@ -5,9 +5,16 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <string.h>
+#include <getopt.h>
 
 static CmdOptionType cmd_option;
 
+#define CMD_OPTION_RESTORE	256
+static const struct option cmd_long_options[] = {
+	{ "restore", required_argument, NULL, CMD_OPTION_RESTORE },
+	{ NULL, 0, NULL, 0 },
+};
+
 static int cmd_atoi(char *arg, uint64 *out)
 {
 	char *endptr;
@@ -50,8 +57,9 @@ CmdOptionType *parse_args(int argc, const char* argv[])
 	  cmd_option.is_interaction = FALSE;
 	  cmd_option.is_remote = FALSE;
 	  cmd_option.timeout = 0;
+	  cmd_option.restore_path = NULL;
 
-	  while ((opt = getopt(argc, (char**)argv, "irbt:p:d:c:m:")) != -1) {
+	  while ((opt = getopt_long(argc, (char**)argv, "irbt:p:d:c:m:", cmd_long_options, NULL)) != -1) {
 		  switch (opt) {
 		  case 'i':
 	    	cmd_option.is_interaction = TRUE;
@@ -89,6 +97,11 @@ CmdOptionType *parse_args(int argc, const char* argv[])
 	    	cmd_option.buffer_devcfgpath[strlen(optarg)] = '\0';
 	        cmd_option.devcfgpath = cmd_option.buffer_devcfgpath;
 	        break;
+	      case CMD_OPTION_RESTORE:
+	    	memcpy(cmd_option.buffer_restore_path, optarg, strlen(optarg));
+	    	cmd_option.buffer_restore_path[strlen(optarg)] = '\0';
+	        cmd_option.restore_path = cmd_option.buffer_restore_path;
+	        break;
 	      default:
 	        printf("parse_args:error! \'%c\' \'%c\'\n", opt, optopt);
 	        return NULL;
@@ -125,6 +138,10 @@ CmdOptionType *parse_args(int argc, const char* argv[])
     	  printf("ERROR: not found memory.txt(%s)\n", cmd_option.memfilepath);
     	  return NULL;
       }
+      if ((cmd_option.restore_path != NULL) &&(file_exist(cmd_option.restore_path) == FALSE)) {
+    	  printf("ERROR: not found snapshot(%s)\n", cmd_option.restore_path);
+    	  return NULL;
+      }
 
 	  return &cmd_option;
 }
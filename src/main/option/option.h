@@ -22,6 +22,9 @@ typedef struct {
 
 	char*				memfilepath;
 	char				buffer_memfile[4096];
+
+	char	*restore_path;
+	char	buffer_restore_path[4096];
 } CmdOptionType;
 
 extern CmdOptionType *parse_args(int argc, const char* argv[]);
@@ -0,0 +1,354 @@
+#include "snapshot.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef OS_LINUX
+#include "athrill_mpthread.h"
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif /* OS_LINUX */
+
+struct snapshot_stream_type {
+	FILE	*fp;
+	/*
+	 * restore: bytes which are not read yet in the current section.
+	 */
+	uint32	remain;
+};
+
+typedef struct {
+	char							name[SNAPSHOT_NAME_LEN];
+	const SnapshotOperationType		*ops;
+	void							*arg;
+	bool							is_restored;
+} SnapshotSectionType;
+
+typedef struct {
+	uint32					section_num;
+	SnapshotSectionType		section[SNAPSHOT_SECTION_MAX];
+} SnapshotType;
+
+static SnapshotType snapshot;
+
+Std_ReturnType snapshot_register(const char *name, const SnapshotOperationType *ops, void *arg)
+{
+	uint32 i;
+	SnapshotSectionType *section;
+
+	if ((strlen(name) == 0U) || (strlen(name) >= SNAPSHOT_NAME_LEN)) {
+		printf("ERROR: snapshot section name is invalid(%s)\n", name);
+		return STD_E_INVALID;
+	}
+	for (i = 0; i < snapshot.section_num; i++) {
+		if (strcmp(snapshot.section[i].name, name) == 0) {
+			printf("ERROR: snapshot section %s is already registered\n", name);
+			return STD_E_INVALID;
+		}
+	}
+	if (snapshot.section_num >= SNAPSHOT_SECTION_MAX) {
+		printf("ERROR: snapshot section %s can not be registered(max=%u)\n", name, SNAPSHOT_SECTION_MAX);
+		return STD_E_LIMIT;
+	}
+	section = &snapshot.section[snapshot.section_num];
+	memset(section->name, 0, SNAPSHOT_NAME_LEN);
+	memcpy(section->name, name, strlen(name));
+	section->ops = ops;
+	section->arg = arg;
+	snapshot.section_num++;
+	return STD_E_OK;
+}
+
+Std_ReturnType snapshot_write(SnapshotStreamType *stream, const void *data, uint32 size)
+{
+	if (size == 0U) {
+		return STD_E_OK;
+	}
+	if (fwrite(data, size, 1, stream->fp) != 1) {
+		return STD_E_INVALID;
+	}
+	return STD_E_OK;
+}
+
+Std_ReturnType snapshot_read(SnapshotStreamType *stream, void *data, uint32 size)
+{
+	if (size == 0U) {
+		return STD_E_OK;
+	}
+	if (size > stream->remain) {
+		return STD_E_INVALID;
+	}
+	if (fread(data, size, 1, stream->fp) != 1) {
+		return STD_E_INVALID;
+	}
+	stream->remain -= size;
+	return STD_E_OK;
+}
+
+static Std_ReturnType snapshot_save_section(SnapshotStreamType *stream, SnapshotSectionType *section)
+{
+	Std_ReturnType err;
+	long head_off;
+	long data_off;
+	long end_off;
+	uint32 size = 0U;
+
+	head_off = ftell(stream->fp);
+	err = snapshot_write(stream, section->name, SNAPSHOT_NAME_LEN);
+	if (err == STD_E_OK) {
+		err = snapshot_write(stream, &size, sizeof(size));
+	}
+	if (err != STD_E_OK) {
+		return err;
+	}
+	data_off = ftell(stream->fp);
+	err = section->ops->save(stream, section->arg);
+	if (err != STD_E_OK) {
+		printf("ERROR: snapshot section %s can not be saved\n", section->name);
+		return err;
+	}
+	/*
+	 * size is known after save: rewrite section header.
+	 */
+	end_off = ftell(stream->fp);
+	size = (uint32)(end_off - data_off);
+	if (fseek(stream->fp, head_off + SNAPSHOT_NAME_LEN, SEEK_SET) != 0) {
+		return STD_E_INVALID;
+	}
+	err = snapshot_write(stream, &size, sizeof(size));
+	if (err != STD_E_OK) {
+		return err;
+	}
+	if (fseek(stream->fp, end_off, SEEK_SET) != 0) {
+		return STD_E_INVALID;
+	}
+	return STD_E_OK;
+}
+
+Std_ReturnType snapshot_save(const char *path)
+{
+	uint32 i;
+	Std_ReturnType err = STD_E_OK;
+	SnapshotStreamType stream;
+	uint32 version = SNAPSHOT_VERSION;
+	char end_name[SNAPSHOT_NAME_LEN];
+	uint32 end_size = 0U;
+
+	stream.fp = fopen(path, "wb");
+	if (stream.fp == NULL) {
+		printf("ERROR: can not open snapshot file(%s)\n", path);
+		return STD_E_NOENT;
+	}
+	stream.remain = 0U;
+	err = snapshot_write(&stream, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN);
+	if (err == STD_E_OK) {
+		err = snapshot_write(&stream, &version, sizeof(version));
+	}
+	for (i = 0; (err == STD_E_OK) && (i < snapshot.section_num); i++) {
+		err = snapshot_save_section(&stream, &snapshot.section[i]);
+	}
+	if (err == STD_E_OK) {
+		memset(end_name, 0, SNAPSHOT_NAME_LEN);
+		err = snapshot_write(&stream, end_name, SNAPSHOT_NAME_LEN);
+	}
+	if (err == STD_E_OK) {
+		err = snapshot_write(&stream, &end_size, sizeof(end_size));
+	}
+	if (fclose(stream.fp) != 0) {
+		err = STD_E_INVALID;
+	}
+	if (err != STD_E_OK) {
+		printf("ERROR: can not save snapshot(%s)\n", path);
+		return err;
+	}
+	printf("snapshot saved: %s sections=%u\n", path, snapshot.section_num);
+	return STD_E_OK;
+}
+
+static SnapshotSectionType *snapshot_search_section(const char *name)
+{
+	uint32 i;
+
+	for (i = 0; i < snapshot.section_num; i++) {
+		if (strncmp(snapshot.section[i].name, name, SNAPSHOT_NAME_LEN) == 0) {
+			return &snapshot.section[i];
+		}
+	}
+	return NULL;
+}
+
+static Std_ReturnType snapshot_load_sections(SnapshotStreamType *stream)
+{
+	Std_ReturnType err;
+	SnapshotSectionType *section;
+	char name[SNAPSHOT_NAME_LEN + 1];
+	uint32 size;
+
+	while (TRUE) {
+		stream->remain = SNAPSHOT_NAME_LEN + sizeof(size);
+		err = snapshot_read(stream, name, SNAPSHOT_NAME_LEN);
+		if (err == STD_E_OK) {
+			err = snapshot_read(stream, &size, sizeof(size));
+		}
+		if (err != STD_E_OK) {
+			printf("ERROR: snapshot file is truncated\n");
+			return err;
+		}
+		name[SNAPSHOT_NAME_LEN] = '\0';
+		if (name[0] == '\0') {
+			break;
+		}
+		section = snapshot_search_section(name);
+		if (section == NULL) {
+			printf("WARNING: snapshot section %s is not registered: skipped\n", name);
+			if (fseek(stream->fp, size, SEEK_CUR) != 0) {
+				return STD_E_INVALID;
+			}
+			continue;
+		}
+		stream->remain = size;
+		err = section->ops->restore(stream, section->arg);
+		if ((err != STD_E_OK) || (stream->remain != 0U)) {
+			printf("ERROR: snapshot section %s can not be restored\n", name);
+			return STD_E_INVALID;
+		}
+		section->is_restored = TRUE;
+	}
+	return STD_E_OK;
+}
+
+Std_ReturnType snapshot_load(const char *path)
+{
+	uint32 i;
+	Std_ReturnType err;
+	SnapshotStreamType stream;
+	char magic[SNAPSHOT_MAGIC_LEN];
+	uint32 version;
+
+	stream.fp = fopen(path, "rb");
+	if (stream.fp == NULL) {
+		printf("ERROR: can not open snapshot file(%s)\n", path);
+		return STD_E_NOENT;
+	}
+	stream.remain = SNAPSHOT_MAGIC_LEN + sizeof(version);
+	err = snapshot_read(&stream, magic, SNAPSHOT_MAGIC_LEN);
+	if (err == STD_E_OK) {
+		err = snapshot_read(&stream, &version, sizeof(version));
+	}
+	if ((err != STD_E_OK) || (memcmp(magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN) != 0)) {
+		printf("ERROR: %s is not snapshot file\n", path);
+		fclose(stream.fp);
+		return STD_E_INVALID;
+	}
+	if (version != SNAPSHOT_VERSION) {
+		printf("ERROR: snapshot version is invalid(0x%x) on %s\n", version, path);
+		fclose(stream.fp);
+		return STD_E_INVALID;
+	}
+	for (i = 0; i < snapshot.section_num; i++) {
+		snapshot.section[i].is_restored = FALSE;
+	}
+	err = snapshot_load_sections(&stream);
+	fclose(stream.fp);
+	if (err != STD_E_OK) {
+		return err;
+	}
+	for (i = 0; i < snapshot.section_num; i++) {
+		if (snapshot.section[i].is_restored == FALSE) {
+			printf("WARNING: snapshot section %s is not found on %s\n", snapshot.section[i].name, path);
+		}
+	}
+	printf("snapshot loaded: %s\n", path);
+	return STD_E_OK;
+}
+
+#ifdef OS_LINUX
+typedef struct {
+	uint32					num;
+	SnapshotForkChildType	func[SNAPSHOT_FORK_CHILD_MAX];
+} SnapshotForkChildTableType;
+
+static SnapshotForkChildTableType snapshot_fork_child;
+
+Std_ReturnType snapshot_register_fork_child(SnapshotForkChildType func)
+{
+	if (snapshot_fork_child.num >= SNAPSHOT_FORK_CHILD_MAX) {
+		printf("ERROR: snapshot fork child handler can not be registered(max=%u)\n", SNAPSHOT_FORK_CHILD_MAX);
+		return STD_E_LIMIT;
+	}
+	snapshot_fork_child.func[snapshot_fork_child.num] = func;
+	snapshot_fork_child.num++;
+	return STD_E_OK;
+}
+
+static void snapshot_fork_child_run(const char *variant)
+{
+	uint32 i;
+
+	(void)setenv(SNAPSHOT_VARIANT_ENV, variant, 1);
+	for (i = 0; i < snapshot_fork_child.num; i++) {
+		snapshot_fork_child.func[i]();
+	}
+	mpthread_fork_child();
+	return;
+}
+
+static void snapshot_fork_wait(uint32 *running)
+{
+	pid_t pid;
+	int status;
+
+	pid = waitpid(-1, &status, 0);
+	if (pid < 0) {
+		printf("ERROR: snapshot waitpid failed\n");
+		exit(1);
+	}
+	(*running)--;
+	fprintf(stderr, "snapshot variant pid=%d status=%d\n",
+			(int)pid, WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+	return;
+}
+
+void snapshot_fork_server(uint32 max_jobs)
+{
+	char line[4096];
+	size_t len;
+	pid_t pid;
+	uint32 count = 0U;
+	uint32 running = 0U;
+
+	if (max_jobs == 0U) {
+		max_jobs = 1U;
+	}
+	fflush(stdout);
+	while (fgets(line, sizeof(line), stdin) != NULL) {
+		len = strlen(line);
+		while ((len > 0U) && ((line[len - 1] == '\n') || (line[len - 1] == '\r'))) {
+			line[--len] = '\0';
+		}
+		if (len == 0U) {
+			continue;
+		}
+		while (running >= max_jobs) {
+			snapshot_fork_wait(&running);
+		}
+		pid = fork();
+		if (pid < 0) {
+			printf("ERROR: snapshot fork failed\n");
+			exit(1);
+		}
+		if (pid == 0) {
+			snapshot_fork_child_run(line);
+			return;
+		}
+		running++;
+		count++;
+		fprintf(stderr, "snapshot variant %s pid=%d started\n", line, (int)pid);
+	}
+	while (running > 0U) {
+		snapshot_fork_wait(&running);
+	}
+	fprintf(stderr, "snapshot variants done: %u\n", count);
+	exit(0);
+}
+#endif /* OS_LINUX */